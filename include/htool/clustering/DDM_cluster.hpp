@@ -315,12 +315,23 @@ public:
 };
 
 
+// Numbering of the sons from a numbering split in place
+inline std::vector<std::vector<int>> sons_numbering(const std::vector<int>& num, const std::vector<int>& sizes){
+	std::vector<std::vector<int>> numbering(sizes.size());
+	int count = 0;
+	for (int p=0;p<sizes.size();p++){
+		numbering[p].assign(num.begin()+count,num.begin()+count+sizes[p]);
+		count += sizes[p];
+	}
+	return numbering;
+}
+
 // Specialization of splitting
 template <>
-std::vector<std::vector<int>> DDM_Cluster<SplittingTypes::GeometricSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<DDM_Cluster<SplittingTypes::GeometricSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return geometric_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+std::vector<std::vector<int>> DDM_Cluster<SplittingTypes::GeometricSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<DDM_Cluster<SplittingTypes::GeometricSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return sons_numbering(num,geometric_splitting(x,tab,num.data(),curr_cluster,nb_sons,dir));}
 
 template <>
-std::vector<std::vector<int>> DDM_Cluster<SplittingTypes::RegularSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<DDM_Cluster<SplittingTypes::RegularSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return regular_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+std::vector<std::vector<int>> DDM_Cluster<SplittingTypes::RegularSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<DDM_Cluster<SplittingTypes::RegularSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return sons_numbering(num,regular_splitting(x,tab,num.data(),curr_cluster,nb_sons,dir));}
 
 
 // Typdef with specific splitting
@@ -132,6 +132,7 @@ public:
 	const std::vector<int>& get_perm() const{return *permutation;};
 	int get_perm(int i) const{return (*permutation)[i];};
 	std::vector<int>::const_iterator get_perm_start() const {return permutation->begin();}
+	std::shared_ptr<const std::vector<int>> get_perm_ptr() const {return permutation;}
 	const Derived& get_root() const {
 		return *(root);
 	}
@@ -301,6 +302,91 @@ public:
 		}
 	}
 
+	// Binary output of the whole tree, used by HMatrix checkpoints
+	void cluster_to_bytes(std::ostream& out) const{
+		int perm_size = this->permutation->size();
+		int nb_masteroffset = root->MasterOffset.size();
+		out.write((const char*) (&perm_size), sizeof(int));
+		out.write((const char*) permutation->data(), perm_size*sizeof(int));
+		out.write((const char*) (&nb_masteroffset), sizeof(int));
+		for (int i=0;i<nb_masteroffset;i++){
+			out.write((const char*) (&(root->MasterOffset[i].first)), sizeof(int));
+			out.write((const char*) (&(root->MasterOffset[i].second)), sizeof(int));
+		}
+		out.write((const char*) (&(root->max_depth)), sizeof(int));
+		out.write((const char*) (&(root->min_depth)), sizeof(int));
+
+		// Tree (depth-first, sons in order)
+		std::stack< Cluster<Derived> const *> s;
+		s.push(this);
+		while(!s.empty()){
+			Cluster<Derived> const * curr = s.top();
+			s.pop();
+
+			int nb_sons = curr->sons.size();
+			out.write((const char*) (&nb_sons), sizeof(int));
+			out.write((const char*) (&(curr->rank)), sizeof(int));
+			out.write((const char*) (&(curr->offset)), sizeof(int));
+			out.write((const char*) (&(curr->size)), sizeof(int));
+			out.write((const char*) (&(curr->rad)), sizeof(double));
+			out.write((const char*) (&(curr->ctr[0])), 3*sizeof(double));
+
+			for (int p=nb_sons-1;p!=-1;p--){
+				s.push((curr->sons[p]));
+			}
+		}
+	}
+
+	// Binary input of a tree written by cluster_to_bytes, has to be called on a root
+	void bytes_to_cluster(std::istream& in, MPI_Comm comm=MPI_COMM_WORLD){
+		int rankWorld,sizeWorld;
+		MPI_Comm_rank(comm, &rankWorld);
+		MPI_Comm_size(comm, &sizeWorld);
+
+		int perm_size = 0, nb_masteroffset = 0;
+		in.read((char*) (&perm_size), sizeof(int));
+		this->permutation->resize(perm_size);
+		in.read((char*) this->permutation->data(), perm_size*sizeof(int));
+		in.read((char*) (&nb_masteroffset), sizeof(int));
+		this->MasterOffset.resize(nb_masteroffset);
+		for (int i=0;i<nb_masteroffset;i++){
+			in.read((char*) (&(this->MasterOffset[i].first)), sizeof(int));
+			in.read((char*) (&(this->MasterOffset[i].second)), sizeof(int));
+		}
+		in.read((char*) (&(this->max_depth)), sizeof(int));
+		in.read((char*) (&(this->min_depth)), sizeof(int));
+
+		// Tree
+		this->local_cluster = nullptr;
+		std::stack< Derived *> s;
+		s.push(static_cast<Derived*>(this));
+		while(!s.empty()){
+			Derived * curr = s.top();
+			s.pop();
+
+			int nb_sons = 0;
+			in.read((char*) (&nb_sons), sizeof(int));
+			in.read((char*) (&(curr->rank)), sizeof(int));
+			in.read((char*) (&(curr->offset)), sizeof(int));
+			in.read((char*) (&(curr->size)), sizeof(int));
+			in.read((char*) (&(curr->rad)), sizeof(double));
+			in.read((char*) (&(curr->ctr[0])), 3*sizeof(double));
+
+			// First node owned by this process, i.e. the one at the level of parallelization
+			if (this->local_cluster==nullptr && curr->rank==rankWorld){
+				this->local_cluster = curr;
+			}
+
+			curr->sons.resize(nb_sons);
+			for (int p=0;p<nb_sons;p++){
+				curr->sons[p] = new Derived(static_cast<Derived*>(this),(curr->counter)*nb_sons+p,curr->depth+1,this->permutation);
+			}
+			for (int p=nb_sons-1;p!=-1;p--){
+				s.push((curr->sons[p]));
+			}
+		}
+	}
+
 	void read_cluster(std::string file_permutation,std::string file_tree, MPI_Comm comm=MPI_COMM_WORLD){
 		int rankWorld,sizeWorld;
 		MPI_Comm_rank(comm, &rankWorld);
@@ -7,6 +7,8 @@
 
 namespace htool {
 
+// Clusters with less points are split in the task of their father
+const int NCluster_task_min_size = 1000;
 
 template<SplittingTypes SplittingType>
 class NCluster: public Cluster<NCluster<SplittingType>>{
@@ -81,6 +83,17 @@ public:
 			this->MasterOffset.resize(nb_sons);
 		}
 
+		// Levels above the local clusters are computed by all processes together, each of them
+		// handling a part of the points, then each process only splits its local cluster
+		bool distributed = false;
+		if (Parametres::distributedclustering && sizeWorld>1){
+			int nb_clusters = 1;
+			while (nb_clusters<sizeWorld){
+				nb_clusters *= nb_sons;
+			}
+			distributed = (nb_clusters==sizeWorld);
+		}
+
 		// Initialisation
 		this->rad = 0;
 		this->size = tab.size();
@@ -93,209 +106,390 @@ public:
 		this->permutation->resize(tab.size());
 		std::iota(this->permutation->begin(),this->permutation->end(),0); // perm[i]=i
 
-		// Recursion
-		std::stack<NCluster*> s;
-		std::stack<std::vector<int>> n;
-		s.push(this);
-		n.push(*(this->permutation));
-
-		while(!s.empty()){
-			NCluster* curr = s.top();
-			std::vector<int> num = n.top();
-			s.pop();
-			n.pop();
-
-			// Mass of the cluster
-			int nb_pt = curr->size;
-			double G=0;
-			for(int j=0; j<nb_pt; j++){
-				G += g[tab[num[j]]];
-			}
-
-			// Center of the cluster
-			R3 xc;
-			xc.fill(0);
-			for(int j=0; j<nb_pt; j++){
-				xc += g[tab[num[j]]]*x[tab[num[j]]];
-			}
-			xc = (1./G)*xc;
-			curr->ctr=xc;
-
-			// Radius and covariance matrix
-			Matrix<double> cov(3,3);
-			double rad = 0;
-			for(int j=0; j<nb_pt; j++){
-				R3 u = x[tab[num[j]]] - xc;
-				rad=std::max(rad,norm2(u)+r[tab[num[j]]]);
-				for(int p=0; p<3; p++){
-					for(int q=0; q<3; q++){
-						cov(p,q) += g[tab[num[j]]]*u[p]*u[q];
+		// Collective levels
+		std::vector<NCluster*> subtrees;
+		if (distributed){
+			std::stack<NCluster*> s;
+			s.push(this);
+			while(!s.empty()){
+				NCluster* curr = s.top();
+				s.pop();
+
+				if (curr->rank>=0){
+					if (curr->rank==rankWorld){
+						subtrees.push_back(curr);
 					}
 				}
-			}
-			curr->rad=rad;
-
-			// Direction of largest extent
-			double p1 = pow(cov(0,1),2) + pow(cov(0,2),2) + pow(cov(1,2),2);
-			std::vector<double> eigs(3);
-			Matrix<double> I(3,3);I(0,0)=1;I(1,1)=1;I(2,2)=1;
-			R3 dir;
-			Matrix<double> prod(3,3);
-			if (p1 < 1e-16) {
-				dir[0]=0;dir[1]=0;dir[2]=0;
-				// cov is diagonal.
-				eigs[0] = cov(0,0);
-				eigs[1] = cov(1,1);
-				eigs[2] = cov(2,2);
-				std::vector<int> index_eigs={0,1,2};
-				std::sort(index_eigs.begin(), index_eigs.end(),[&eigs](size_t i1, size_t i2) {return eigs[i1] < eigs[i2];});
-				dir[index_eigs[0]]=1;
-				
-
-				if (eigs[index_eigs[1]]-1e-10< eigs[index_eigs[0]] < eigs[index_eigs[1]]+1e-10){
-					dir[index_eigs[0]]=1./std::sqrt(2);
-					dir[index_eigs[1]]=1./std::sqrt(2);
-				}
-				if (eigs[index_eigs[2]]-1e-10< eigs[index_eigs[0]] < eigs[index_eigs[2]]+1e-10){
-					dir[0]=1./std::sqrt(3);
-					dir[1]=1./std::sqrt(3);
-					dir[2]=1./std::sqrt(3);
-				}
-			}
-			else {
-				double q = (cov(0,0)+cov(1,1)+cov(2,2))/3.;
-				double p2 = pow(cov(0,0) - q,2) + pow(cov(1,1) - q,2) + pow(cov(2,2) - q,2) + 2. * p1;
-				double p = sqrt(p2 / 6.);
-				Matrix<double> B(3,3);
-				B = (1. / p) * (cov - q * I);
-				double detB = B(0,0)*(B(1,1)*B(2,2)-B(1,2)*B(2,1))
-							- B(0,1)*(B(1,0)*B(2,2)-B(1,2)*B(2,0))
-							+ B(0,2)*(B(1,0)*B(2,1)-B(1,1)*B(2,0));
-				double r = detB / 2.;
-
-				// In exact arithmetic for a symmetric matrix  -1 <= r <= 1
-				// but computation error can leave it slightly outside this range.
-				double phi;
-				if (r <= -1)
-					phi = M_PI / 3.;
-				else if (r >= 1)
-					phi = 0;
-				else
-					phi = acos(r) / 3.;
-
-				// the eigenvalues satisfy eig3 <= eig2 <= eig1
-				eigs[0] = q + 2. * p * cos(phi);
-				eigs[2] = q + 2. * p * cos(phi + (2.*M_PI/3.));
-				eigs[1] = 3. * q - eigs[0] - eigs[2];     // since trace(cov) = eig1 + eig2 + eig3
-
-				if (std::abs(eigs[0]) < 1.e-16)
-					dir *= 0.;
-				else {
-					prod = (cov - eigs[1] * I) * (cov - eigs[2] * I);
-					int ind = 0;
-					double dirnorm = 0;
-					do {
-						dir[0] = prod(0,ind);
-						dir[1] = prod(1,ind);
-						dir[2] = prod(2,ind);
-						dirnorm = sqrt(dir[0]*dir[0]+dir[1]*dir[1]+dir[2]*dir[2]);
-						ind++;
+				else if (this->split_cluster(x,r,tab,g,curr,nb_sons,rankWorld,sizeWorld,true,comm)){
+					for (int p=0;p<nb_sons;p++){
+						s.push((curr->sons[p]));
 					}
-					while ((dirnorm < 1.e-15) && (ind < 3));
-					assert(dirnorm >= 1.e-15);
-					dir[0] /= dirnorm;
-					dir[1] /= dirnorm;
-					dir[2] /= dirnorm;
 				}
-
 			}
+		}
+		else{
+			subtrees.push_back(this);
+		}
+
+		// Recursion, independent subtrees are built in parallel
+		#if _OPENMP
+		#pragma omp parallel
+		#pragma omp single
+		#endif
+		for (auto curr : subtrees){
+			this->build_subtree(x,r,tab,g,curr,nb_sons,rankWorld,sizeWorld,comm);
+		}
 
-			// Creating sons
-			curr->sons.resize(nb_sons);
+		if (distributed){
+			this->gather_subtrees(comm);
+		}
+	}
+
+	// Clusters are split recursively, subtrees with enough points are built in separate tasks
+	void build_subtree(const std::vector<R3>& x, const std::vector<double>& r,const std::vector<int>& tab, const std::vector<double>& g, NCluster* curr, int nb_sons, int rankWorld, int sizeWorld, MPI_Comm comm){
+		if (this->split_cluster(x,r,tab,g,curr,nb_sons,rankWorld,sizeWorld,false,comm)){
 			for (int p=0;p<nb_sons;p++){
-				curr->sons[p] = new NCluster(this,(curr->counter)*nb_sons+p,curr->depth+1,this->permutation);
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p,curr) if(curr->sons[p]->get_size()>=NCluster_task_min_size)
+				#endif
+				this->build_subtree(x,r,tab,g,curr->sons[p],nb_sons,rankWorld,sizeWorld,comm);
 			}
-			
-			// Compute numbering
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
+		}
+	}
 
-			
-			std::vector<std::vector<int>> numbering = this->splitting(x,tab,num,curr,nb_sons,dir);
-			
-			// Set offsets, size and rank of sons
-			int count = 0;
-			int sons_at_next_level = std::pow(nb_sons,curr->depth+1);
-			for (int p=0;p<nb_sons;p++){
-				curr->sons[p]->set_offset(curr->offset+count);
-				curr->sons[p]->set_size(numbering[p].size());
-				count+=numbering[p].size();
+	// Compute center, radius and sons of curr, returns false if curr is a leaf
+	// If cooperative, each process only handles a part of the points of curr
+	bool split_cluster(const std::vector<R3>& x, const std::vector<double>& r,const std::vector<int>& tab, const std::vector<double>& g, NCluster* curr, int nb_sons, int rankWorld, int sizeWorld, bool cooperative, MPI_Comm comm){
+		// Points of the cluster handled by this process
+		int* num = this->permutation->data()+curr->offset;
+		int nb_pt = curr->size;
+		std::pair<int,int> slice(0,nb_pt);
+		if (cooperative){
+			slice = distributed_slice(nb_pt,rankWorld,sizeWorld);
+		}
 
+		// Mass and center of the cluster
+		double G=0, xc0=0, xc1=0, xc2=0;
+		#if _OPENMP
+		#pragma omp simd reduction(+:G,xc0,xc1,xc2)
+		#endif
+		for(int j=slice.first; j<slice.second; j++){
+			int k = tab[num[j]];
+			G   += g[k];
+			xc0 += g[k]*x[k][0];
+			xc1 += g[k]*x[k][1];
+			xc2 += g[k]*x[k][2];
+		}
+		if (cooperative){
+			double sums[4] = {G,xc0,xc1,xc2};
+			MPI_Allreduce(MPI_IN_PLACE,sums,4,MPI_DOUBLE,MPI_SUM,comm);
+			G = sums[0]; xc0 = sums[1]; xc1 = sums[2]; xc2 = sums[3];
+		}
+		R3 xc;
+		xc[0] = xc0/G; xc[1] = xc1/G; xc[2] = xc2/G;
+		curr->ctr=xc;
+
+		// Radius and covariance matrix
+		double rad = 0;
+		double c00=0, c01=0, c02=0, c11=0, c12=0, c22=0;
+		#if _OPENMP
+		#pragma omp simd reduction(max:rad) reduction(+:c00,c01,c02,c11,c12,c22)
+		#endif
+		for(int j=slice.first; j<slice.second; j++){
+			int k = tab[num[j]];
+			double u0 = x[k][0]-xc[0];
+			double u1 = x[k][1]-xc[1];
+			double u2 = x[k][2]-xc[2];
+			rad  = std::max(rad,std::sqrt(u0*u0+u1*u1+u2*u2)+r[k]);
+			c00 += g[k]*u0*u0;
+			c01 += g[k]*u0*u1;
+			c02 += g[k]*u0*u2;
+			c11 += g[k]*u1*u1;
+			c12 += g[k]*u1*u2;
+			c22 += g[k]*u2*u2;
+		}
+		double cov_entries[6] = {c00,c01,c02,c11,c12,c22};
+		if (cooperative){
+			MPI_Allreduce(MPI_IN_PLACE,&rad,1,MPI_DOUBLE,MPI_MAX,comm);
+			MPI_Allreduce(MPI_IN_PLACE,cov_entries,6,MPI_DOUBLE,MPI_SUM,comm);
+		}
+		curr->rad=rad;
+		Matrix<double> cov(3,3);
+		cov(0,0) = cov_entries[0]; cov(0,1) = cov_entries[1]; cov(0,2) = cov_entries[2];
+		cov(1,0) = cov_entries[1]; cov(1,1) = cov_entries[3]; cov(1,2) = cov_entries[4];
+		cov(2,0) = cov_entries[2]; cov(2,1) = cov_entries[4]; cov(2,2) = cov_entries[5];
+
+		// Direction of largest extent
+		R3 dir = main_direction(cov);
+
+		// Creating sons
+		curr->sons.resize(nb_sons);
+		for (int p=0;p<nb_sons;p++){
+			curr->sons[p] = new NCluster(this,(curr->counter)*nb_sons+p,curr->depth+1,this->permutation);
+		}
 
-				if (sizeWorld>1){
-					// level of parallelization
-					if (sons_at_next_level==sizeWorld){
+		// Compute numbering
+		std::vector<int> sizes;
+		if (cooperative){
+			sizes = this->splitting(x,tab,num,curr,nb_sons,dir,comm);
+		}
+		else{
+			sizes = this->splitting(x,tab,num,curr,nb_sons,dir);
+		}
 
-						curr->sons[p]->set_rank(curr->sons[p]->get_counter());
-						if (rankWorld==curr->sons[p]->get_counter()){
-							this->local_cluster = (curr->sons[p]);
-						}
-						this->MasterOffset[curr->sons[p]->get_counter()] = std::pair<int,int>(curr->sons[p]->get_offset(),curr->sons[p]->get_size());
+		// Set offsets, size and rank of sons
+		int count = 0;
+		int sons_at_next_level = std::pow(nb_sons,curr->depth+1);
+		for (int p=0;p<nb_sons;p++){
+			curr->sons[p]->set_offset(curr->offset+count);
+			curr->sons[p]->set_size(sizes[p]);
+			count+=sizes[p];
 
-					}
-					// before level of parallelization
-					else if (sons_at_next_level<sizeWorld){
-						curr->sons[p]->set_rank(-1);
-					}
-					// after level of parallelization
-					else {
-						curr->sons[p]->set_rank(curr->rank);
-					}
-				}
-				else{
-					curr->sons[p]->set_rank(curr->rank);
-				}
-			} 
 
+			if (sizeWorld>1){
+				// level of parallelization
+				if (sons_at_next_level==sizeWorld){
 
+					curr->sons[p]->set_rank(curr->sons[p]->get_counter());
+					if (rankWorld==curr->sons[p]->get_counter()){
+						this->local_cluster = (curr->sons[p]);
+					}
+					this->MasterOffset[curr->sons[p]->get_counter()] = std::pair<int,int>(curr->sons[p]->get_offset(),curr->sons[p]->get_size());
 
-			// Recursivite
-			bool test_minclustersize=true;
-			for (int p=0;p<nb_sons;p++){
-				test_minclustersize= test_minclustersize && (numbering[p].size() >= Parametres::minclustersize);
-			}
-			if(test_minclustersize) {
-				for (int p=0;p<nb_sons;p++){
-					s.push((curr->sons[p]));
-					n.push(numbering[p]);
+				}
+				// before level of parallelization
+				else if (sons_at_next_level<sizeWorld){
+					curr->sons[p]->set_rank(-1);
+				}
+				// after level of parallelization
+				else {
+					curr->sons[p]->set_rank(curr->rank);
 				}
 			}
 			else{
+				curr->sons[p]->set_rank(curr->rank);
+			}
+		} 
+
+		// Recursivite
+		bool test_minclustersize=true;
+		for (int p=0;p<nb_sons;p++){
+			test_minclustersize= test_minclustersize && (sizes[p] >= Parametres::minclustersize);
+		}
+		if(!test_minclustersize) {
+			#if _OPENMP
+			#pragma omp critical
+			#endif
+			{
 				this->max_depth= std::max(this->max_depth,curr ->depth);
 				if (this->min_depth<0) {this->min_depth=curr->depth;}
 				else{
 				this->min_depth= std::min(this->min_depth,curr ->depth);}
+			}
+
+			for (auto & son : curr->sons){
+				delete son; son = nullptr;
+			}
+			curr->sons.resize(0);
+		}
+		return test_minclustersize;
+	}
+
+	// Eigenvector associated with the largest eigenvalue of a 3x3 covariance matrix
+	static R3 main_direction(Matrix<double> cov){
+		double p1 = pow(cov(0,1),2) + pow(cov(0,2),2) + pow(cov(1,2),2);
+		std::vector<double> eigs(3);
+		Matrix<double> I(3,3);I(0,0)=1;I(1,1)=1;I(2,2)=1;
+		R3 dir;
+		Matrix<double> prod(3,3);
+		if (p1 < 1e-16) {
+			dir[0]=0;dir[1]=0;dir[2]=0;
+			// cov is diagonal.
+			eigs[0] = cov(0,0);
+			eigs[1] = cov(1,1);
+			eigs[2] = cov(2,2);
+			std::vector<int> index_eigs={0,1,2};
+			std::sort(index_eigs.begin(), index_eigs.end(),[&eigs](size_t i1, size_t i2) {return eigs[i1] < eigs[i2];});
+			dir[index_eigs[0]]=1;
+			
 
-				for (auto & son : curr->sons){
-					delete son; son = nullptr;
+			if (eigs[index_eigs[1]]-1e-10< eigs[index_eigs[0]] < eigs[index_eigs[1]]+1e-10){
+				dir[index_eigs[0]]=1./std::sqrt(2);
+				dir[index_eigs[1]]=1./std::sqrt(2);
+			}
+			if (eigs[index_eigs[2]]-1e-10< eigs[index_eigs[0]] < eigs[index_eigs[2]]+1e-10){
+				dir[0]=1./std::sqrt(3);
+				dir[1]=1./std::sqrt(3);
+				dir[2]=1./std::sqrt(3);
+			}
+		}
+		else {
+			double q = (cov(0,0)+cov(1,1)+cov(2,2))/3.;
+			double p2 = pow(cov(0,0) - q,2) + pow(cov(1,1) - q,2) + pow(cov(2,2) - q,2) + 2. * p1;
+			double p = sqrt(p2 / 6.);
+			Matrix<double> B(3,3);
+			B = (1. / p) * (cov - q * I);
+			double detB = B(0,0)*(B(1,1)*B(2,2)-B(1,2)*B(2,1))
+						- B(0,1)*(B(1,0)*B(2,2)-B(1,2)*B(2,0))
+						+ B(0,2)*(B(1,0)*B(2,1)-B(1,1)*B(2,0));
+			double r = detB / 2.;
+
+			// In exact arithmetic for a symmetric matrix  -1 <= r <= 1
+			// but computation error can leave it slightly outside this range.
+			double phi;
+			if (r <= -1)
+				phi = M_PI / 3.;
+			else if (r >= 1)
+				phi = 0;
+			else
+				phi = acos(r) / 3.;
+
+			// the eigenvalues satisfy eig3 <= eig2 <= eig1
+			eigs[0] = q + 2. * p * cos(phi);
+			eigs[2] = q + 2. * p * cos(phi + (2.*M_PI/3.));
+			eigs[1] = 3. * q - eigs[0] - eigs[2];     // since trace(cov) = eig1 + eig2 + eig3
+
+			if (std::abs(eigs[0]) < 1.e-16)
+				dir *= 0.;
+			else {
+				prod = (cov - eigs[1] * I) * (cov - eigs[2] * I);
+				int ind = 0;
+				double dirnorm = 0;
+				do {
+					dir[0] = prod(0,ind);
+					dir[1] = prod(1,ind);
+					dir[2] = prod(2,ind);
+					dirnorm = sqrt(dir[0]*dir[0]+dir[1]*dir[1]+dir[2]*dir[2]);
+					ind++;
 				}
-				curr->sons.resize(0);
-				std::copy_n(num.begin(),num.size(),this->permutation->begin()+curr->offset);
+				while ((dirnorm < 1.e-15) && (ind < 3));
+				assert(dirnorm >= 1.e-15);
+				dir[0] /= dirnorm;
+				dir[1] /= dirnorm;
+				dir[2] /= dirnorm;
+			}
 
+		}
+		return dir;
+	}
+
+	// Subtrees of local clusters are sent to every process with their part of the permutation
+	void gather_subtrees(MPI_Comm comm){
+		int rankWorld, sizeWorld;
+		MPI_Comm_size(comm, &sizeWorld);
+		MPI_Comm_rank(comm, &rankWorld);
+
+		// Clusters of the level of parallelization
+		std::vector<NCluster*> rank_clusters(sizeWorld,nullptr);
+		std::stack<NCluster*> s;
+		s.push(this);
+		while(!s.empty()){
+			NCluster* curr = s.top();
+			s.pop();
+			if (curr->rank>=0){
+				rank_clusters[curr->rank] = curr;
+			}
+			else{
+				for (auto son : curr->sons){
+					s.push(son);
+				}
+			}
+		}
+
+		// Nodes in preorder: number of sons, offset and size, then radius and center
+		std::vector<int> local_ints;
+		std::vector<double> local_doubles;
+		if (rank_clusters[rankWorld]!=nullptr){
+			rank_clusters[rankWorld]->pack_subtree(local_ints,local_doubles);
+		}
+		int local_counts[2] = {int(local_ints.size()),int(local_doubles.size())};
+		std::vector<int> all_counts(2*sizeWorld);
+		MPI_Allgather(local_counts,2,MPI_INT,all_counts.data(),2,MPI_INT,comm);
+
+		std::vector<int> int_counts(sizeWorld), int_displs(sizeWorld,0), double_counts(sizeWorld), double_displs(sizeWorld,0);
+		std::vector<int> perm_counts(sizeWorld,0), perm_displs(sizeWorld,0);
+		for (int i=0;i<sizeWorld;i++){
+			int_counts[i]    = all_counts[2*i];
+			double_counts[i] = all_counts[2*i+1];
+			if (i>0){
+				int_displs[i]    = int_displs[i-1]+int_counts[i-1];
+				double_displs[i] = double_displs[i-1]+double_counts[i-1];
+			}
+			if (rank_clusters[i]!=nullptr){
+				perm_counts[i] = rank_clusters[i]->get_size();
+				perm_displs[i] = rank_clusters[i]->get_offset();
+			}
+		}
+		std::vector<int> ints(int_displs.back()+int_counts.back());
+		std::vector<double> doubles(double_displs.back()+double_counts.back());
+		MPI_Allgatherv(local_ints.data(),local_ints.size(),MPI_INT,ints.data(),int_counts.data(),int_displs.data(),MPI_INT,comm);
+		MPI_Allgatherv(local_doubles.data(),local_doubles.size(),MPI_DOUBLE,doubles.data(),double_counts.data(),double_displs.data(),MPI_DOUBLE,comm);
+		MPI_Allgatherv(MPI_IN_PLACE,0,MPI_INT,this->permutation->data(),perm_counts.data(),perm_displs.data(),MPI_INT,comm);
+
+		for (int i=0;i<sizeWorld;i++){
+			if (i!=rankWorld && rank_clusters[i]!=nullptr){
+				const int* curr_ints = ints.data()+int_displs[i];
+				const double* curr_doubles = doubles.data()+double_displs[i];
+				rank_clusters[i]->unpack_subtree(curr_ints,curr_doubles);
 			}
 		}
+
+		// Depths of leaves
+		int depths[2] = {this->max_depth,(this->min_depth<0 ? std::numeric_limits<int>::max() : this->min_depth)};
+		MPI_Allreduce(MPI_IN_PLACE,&(depths[0]),1,MPI_INT,MPI_MAX,comm);
+		MPI_Allreduce(MPI_IN_PLACE,&(depths[1]),1,MPI_INT,MPI_MIN,comm);
+		this->max_depth = depths[0];
+		this->min_depth = (depths[1]==std::numeric_limits<int>::max() ? -1 : depths[1]);
 	}
 
+	void pack_subtree(std::vector<int>& ints, std::vector<double>& doubles) const{
+		ints.push_back(this->sons.size());
+		ints.push_back(this->offset);
+		ints.push_back(this->size);
+		doubles.push_back(this->rad);
+		doubles.insert(doubles.end(),this->ctr.begin(),this->ctr.end());
+		for (auto son : this->sons){
+			son->pack_subtree(ints,doubles);
+		}
+	}
 
-	std::vector<std::vector<int>> splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<NCluster<SplittingType>> const * const curr_cluster, int nb_sons, R3 dir);
+	void unpack_subtree(const int*& ints, const double*& doubles){
+		int nb_sons  = *(ints++);
+		this->offset = *(ints++);
+		this->size   = *(ints++);
+		this->rad    = *(doubles++);
+		std::copy_n(doubles,3,this->ctr.begin());
+		doubles += 3;
+		this->sons.resize(nb_sons);
+		for (int p=0;p<nb_sons;p++){
+			this->sons[p] = new NCluster(this->root,(this->counter)*nb_sons+p,this->depth+1,this->permutation);
+			this->sons[p]->set_rank(this->rank);
+			this->sons[p]->unpack_subtree(ints,doubles);
+		}
+	}
+
+
+	std::vector<int> splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingType>> const * const curr_cluster, int nb_sons, R3 dir);
+	std::vector<int> splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingType>> const * const curr_cluster, int nb_sons, R3 dir, MPI_Comm comm);
 
 };
 
 
 // Specialization of splitting
 template <>
-std::vector<std::vector<int>> NCluster<SplittingTypes::GeometricSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<NCluster<SplittingTypes::GeometricSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return geometric_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+std::vector<int> NCluster<SplittingTypes::GeometricSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingTypes::GeometricSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return geometric_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+
+template <>
+std::vector<int> NCluster<SplittingTypes::RegularSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingTypes::RegularSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return regular_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+
+template <>
+std::vector<int> NCluster<SplittingTypes::GeometricSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingTypes::GeometricSplitting>> const * const curr_cluster, int nb_sons, R3 dir, MPI_Comm comm){ return geometric_splitting(x,tab,num,curr_cluster,nb_sons,dir,comm);}
 
 template <>
-std::vector<std::vector<int>> NCluster<SplittingTypes::RegularSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num, Cluster<NCluster<SplittingTypes::RegularSplitting>> const * const curr_cluster, int nb_sons, R3 dir){ return regular_splitting(x,tab,num,curr_cluster,nb_sons,dir);}
+std::vector<int> NCluster<SplittingTypes::RegularSplitting>::splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num, Cluster<NCluster<SplittingTypes::RegularSplitting>> const * const curr_cluster, int nb_sons, R3 dir, MPI_Comm comm){ return regular_splitting(x,tab,num,curr_cluster,nb_sons,dir,comm);}
 
 
 // Typdef with specific splitting
@@ -1,6 +1,9 @@
 #ifndef HTOOL_CLUSTERING_SPLITTING_HPP
 #define HTOOL_CLUSTERING_SPLITTING_HPP
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include "cluster.hpp"
 
 namespace htool {
@@ -9,9 +12,22 @@ namespace htool {
 enum class SplittingTypes {GeometricSplitting, RegularSplitting};
 
 
+// Splittings reorder in place the numbering of the points of the current cluster, so that the points
+// of each son are contiguous and keep their relative order, and they return the sizes of the sons
+template<typename SonIndex>
+std::vector<int> partition_sons(int* first, int* last, int nb_sons, SonIndex son_index){
+	std::vector<int> sizes(nb_sons,0);
+	for (int p=0;p<nb_sons-1;p++){
+		int* middle = std::stable_partition(first,last,[&](int a){return son_index(a)==p;});
+		sizes[p] = middle-first;
+		first = middle;
+	}
+	sizes.back() = last-first;
+	return sizes;
+}
+
 template<typename ClusterImpl> 
-std::vector<std::vector<int>> geometric_splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir){
-	std::vector<std::vector<int>> numbering(nb_sons);
+std::vector<int> geometric_splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir){
 
 	// Geometry of current cluster
 	int nb_pt = curr_cluster->get_size();
@@ -19,58 +35,147 @@ std::vector<std::vector<int>> geometric_splitting(const std::vector<R3>& x, cons
 
 	// For 2 sons, we can use the center of the cluster
 	if (nb_sons==2){
-		for(int j=0; j<nb_pt; j++){
-			R3 dx = x[tab[num[j]]] - xc;
-
-			if( (dir,dx)>0 ){
-				numbering[0].push_back(num[j]);
-			}
-			else{
-				numbering[1].push_back(num[j]);
-			}
-		}
-
+		return partition_sons(num,num+nb_pt,nb_sons,[&](int a){return ((dir,x[tab[a]] - xc)>0) ? 0 : 1;});
 	}
 	// Otherwise we have to something more
-	else if (num.size()>1){
-		const auto minmax  = std::minmax_element(num.begin(),num.end(),[&](int a, int b){ return (x[tab[a]] - xc,dir)<(x[tab[b]] - xc,dir)  ;});
+	else if (nb_pt>1){
+		const auto minmax  = std::minmax_element(num,num+nb_pt,[&](int a, int b){ return (x[tab[a]] - xc,dir)<(x[tab[b]] - xc,dir)  ;});
 		R3 min = x[tab[*(minmax.first)]];
 		R3 max = x[tab[*(minmax.second)]];
 		double length = (max-min,dir)/(double)nb_sons;
-		for(int j=0; j<nb_pt; j++){
-			R3 dx = x[tab[num[j]]] ;
-			
-			int index = ((dx-min,dir))/length;
-			index = (index==nb_sons) ? index-1 : index; // for max
-			numbering[index].push_back(num[j]);
-		}
+		return partition_sons(num,num+nb_pt,nb_sons,[&](int a){
+			int index = ((x[tab[a]]-min,dir))/length;
+			return (index==nb_sons) ? index-1 : index; // for max
+		});
 	}
 
-	return numbering;
+	return std::vector<int>(nb_sons,0);
 }
 
 template<typename ClusterImpl> 
-std::vector<std::vector<int>> regular_splitting(const std::vector<R3>& x, const std::vector<int>& tab, std::vector<int>& num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir){
+std::vector<int> regular_splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir){
 
-	std::vector<std::vector<int>> numbering(nb_sons);
+	int nb_pt = curr_cluster->get_size();
 	R3 xc = curr_cluster->get_ctr();
 
-	std::sort(num.begin(),num.end(),[&](int a, int b){return (x[tab[a]] - xc,dir)<(x[tab[b]] - xc,dir);});
+	// Projections are computed once, ties are broken with the numbering so that the order is unique
+	std::vector<std::pair<double,int>> keys(nb_pt);
+	for (int j=0;j<nb_pt;j++){
+		keys[j] = std::pair<double,int>((x[tab[num[j]]] - xc,dir),num[j]);
+	}
+	std::sort(keys.begin(),keys.end());
+	for (int j=0;j<nb_pt;j++){
+		num[j] = keys[j].second;
+	}
 
-	int size_numbering = num.size()/nb_sons;
-	int count_size = 0;
-	for (int p=0;p<nb_sons-1;p++){
-		numbering[p].resize(size_numbering);
-		std::copy_n(num.begin()+count_size,size_numbering,numbering[p].begin());
-		count_size+=size_numbering;
+	std::vector<int> sizes(nb_sons,nb_pt/nb_sons);
+	sizes.back() = nb_pt-(nb_sons-1)*(nb_pt/nb_sons);
+
+	return sizes;
+}
+
+
+// Distributed versions: each process handles the part [begin,end) of the points of the current cluster,
+// the numbering of the sons is then gathered on every process, following the order of processes
+inline std::pair<int,int> distributed_slice(int nb_pt, int rankWorld, int sizeWorld){
+	return std::pair<int,int>((long long)(nb_pt)*rankWorld/sizeWorld,(long long)(nb_pt)*(rankWorld+1)/sizeWorld);
+}
+
+inline void gather_numbering(int* num, const int* local_num, std::vector<int>& sizes, MPI_Comm comm){
+	int sizeWorld;
+	MPI_Comm_size(comm, &sizeWorld);
+	int nb_sons = sizes.size();
+
+	std::vector<int> all_sizes(nb_sons*sizeWorld);
+	MPI_Allgather(sizes.data(),nb_sons,MPI_INT,all_sizes.data(),nb_sons,MPI_INT,comm);
+
+	std::vector<int> counts(sizeWorld,0), displs(sizeWorld,0);
+	for (int i=0;i<sizeWorld;i++){
+		counts[i] = std::accumulate(all_sizes.begin()+i*nb_sons,all_sizes.begin()+(i+1)*nb_sons,0);
+		if (i>0) displs[i] = displs[i-1]+counts[i-1];
 	}
+	std::vector<int> all(displs.back()+counts.back());
+	MPI_Allgatherv(local_num,std::accumulate(sizes.begin(),sizes.end(),0),MPI_INT,all.data(),counts.data(),displs.data(),MPI_INT,comm);
+
+	std::fill(sizes.begin(),sizes.end(),0);
+	for (int p=0;p<nb_sons;p++){
+		for (int i=0;i<sizeWorld;i++){
+			int position = displs[i]+std::accumulate(all_sizes.begin()+i*nb_sons,all_sizes.begin()+i*nb_sons+p,0);
+			num = std::copy_n(all.begin()+position,all_sizes[i*nb_sons+p],num);
+			sizes[p] += all_sizes[i*nb_sons+p];
+		}
+	}
+}
 
-	numbering.back().resize(num.size()-count_size);
-	std::copy(num.begin()+count_size,num.end(),numbering.back().begin());
+template<typename ClusterImpl>
+std::vector<int> geometric_splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir, MPI_Comm comm){
+	int rankWorld, sizeWorld;
+	MPI_Comm_size(comm, &sizeWorld);
+	MPI_Comm_rank(comm, &rankWorld);
+	int nb_pt = curr_cluster->get_size();
+	R3 xc = curr_cluster->get_ctr();
+	std::pair<int,int> slice = distributed_slice(nb_pt,rankWorld,sizeWorld);
+	int* first = num+slice.first;
+	int* last  = num+slice.second;
+
+	std::vector<int> sizes(nb_sons,0);
+	if (nb_sons==2){
+		sizes = partition_sons(first,last,nb_sons,[&](int a){return ((dir,x[tab[a]] - xc)>0) ? 0 : 1;});
+	}
+	else if (nb_pt>1){
+		// Extent of the whole cluster along dir: min of (dx,dir) and min of -(dx,dir)
+		double bounds[2] = {std::numeric_limits<double>::max(),std::numeric_limits<double>::max()};
+		for(int* j=first; j<last; j++){
+			double projection = (x[tab[*j]] - xc,dir);
+			bounds[0] = std::min(bounds[0],projection);
+			bounds[1] = std::min(bounds[1],-projection);
+		}
+		MPI_Allreduce(MPI_IN_PLACE,bounds,2,MPI_DOUBLE,MPI_MIN,comm);
+		double length = (-bounds[1]-bounds[0])/(double)nb_sons;
+		sizes = partition_sons(first,last,nb_sons,[&](int a){
+			int index = ((x[tab[a]] - xc,dir)-bounds[0])/length;
+			return std::min(index,nb_sons-1); // for max
+		});
+	}
 
-	return numbering;
+	gather_numbering(num,first,sizes,comm);
+	return sizes;
 }
 
+template<typename ClusterImpl>
+std::vector<int> regular_splitting(const std::vector<R3>& x, const std::vector<int>& tab, int* num,  Cluster<ClusterImpl> const * const curr_cluster, int nb_sons, R3 dir, MPI_Comm comm){
+	int rankWorld, sizeWorld;
+	MPI_Comm_size(comm, &sizeWorld);
+	MPI_Comm_rank(comm, &rankWorld);
+	int nb_pt = curr_cluster->get_size();
+	R3 xc = curr_cluster->get_ctr();
+	auto comp = [&](int a, int b){
+		double projection_a = (x[tab[a]] - xc,dir);
+		double projection_b = (x[tab[b]] - xc,dir);
+		return projection_a<projection_b || (projection_a==projection_b && a<b);
+	};
+
+	// Each process sorts its points, sorted parts are then merged pairwise
+	std::vector<int> counts(sizeWorld), displs(sizeWorld+1,0);
+	for (int i=0;i<sizeWorld;i++){
+		std::pair<int,int> slice = distributed_slice(nb_pt,i,sizeWorld);
+		displs[i]   = slice.first;
+		counts[i]   = slice.second-slice.first;
+	}
+	displs[sizeWorld] = nb_pt;
+	std::sort(num+displs[rankWorld],num+displs[rankWorld+1],comp);
+	MPI_Allgatherv(MPI_IN_PLACE,0,MPI_INT,num,counts.data(),displs.data(),MPI_INT,comm);
+	for (int width=1;width<sizeWorld;width*=2){
+		for (int i=0;i+width<sizeWorld;i+=2*width){
+			std::inplace_merge(num+displs[i],num+displs[i+width],num+displs[std::min(i+2*width,sizeWorld)],comp);
+		}
+	}
+
+	std::vector<int> sizes(nb_sons,nb_pt/nb_sons);
+	sizes.back() = nb_pt-(nb_sons-1)*(nb_pt/nb_sons);
+
+	return sizes;
+}
 
 }
 
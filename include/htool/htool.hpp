@@ -15,11 +15,17 @@
 #include "clustering/cluster.hpp"
 #include "clustering/ncluster.hpp"
 
+#include "kernels/kernel.hpp"
+#include "kernels/laplace.hpp"
+#include "kernels/helmholtz.hpp"
+
 #include "input_output/geometry.hpp"
 #include "input_output/output.hpp"
 
 #include "lrmat/lrmat.hpp"
+#include "lrmat/recompression.hpp"
 #include "lrmat/SVD.hpp"
+#include "lrmat/randomizedSVD.hpp"
 #include "lrmat/fullACA.hpp"
 #include "lrmat/partialACA.hpp"
 #include "lrmat/sympartialACA.hpp"
@@ -31,6 +37,8 @@
 #include "misc/parametres.hpp"
 #include "misc/user.hpp"
 
+#include "types/half.hpp"
+#include "types/hblock.hpp"
 #include "types/hmatrix.hpp"
 #include "types/matrix.hpp"
 #include "types/multihmatrix.hpp"
@@ -44,6 +52,7 @@
 #include "wrappers/wrapper_blas.hpp"
 #include "wrappers/wrapper_mpi.hpp"
 
+#include "solvers/hlu.hpp"
 #ifdef WITH_HPDDM
     #include "solvers/ddm.hpp"
     #include "solvers/proto_ddm.hpp"
@@ -0,0 +1,72 @@
+#ifndef HTOOL_KERNELS_HELMHOLTZ_HPP
+#define HTOOL_KERNELS_HELMHOLTZ_HPP
+
+#include <cmath>
+#include <complex>
+#include "kernel.hpp"
+
+namespace htool {
+
+// Single layer kernel of the Helmholtz equation G(x,y) = exp(i k |x-y|)/(4 pi |x-y|), with G(x,x) = 0
+// Rows and columns are computed in two passes: amplitudes 1/(4 pi r) and phases k r in a loop that can
+// be vectorized, then cos and sin in a scalar loop, since they are not vectorized without vector math libraries
+class HelmholtzSingleLayer: public PointKernel<std::complex<double>>{
+	double wavenumber;
+
+	static inline void amplitude_phase(double dx, double dy, double dz, double k, double& g, double& phase){
+		double r2 = dx*dx+dy*dy+dz*dz;
+		double r  = std::sqrt(r2);
+		double inv = 1./(4*M_PI*r);
+		g     = (r2>0) ? inv : 0.;
+		phase = k*r;
+	}
+
+	// out holds (g,phase) pairs, replaced by g exp(i phase)
+	static inline void exp_phase(double* const out, int n){
+		for (int k=0; k<n; k++){
+			double g = out[2*k], phase = out[2*k+1];
+			out[2*k]   = g*std::cos(phase);
+			out[2*k+1] = g*std::sin(phase);
+		}
+	}
+
+public:
+	HelmholtzSingleLayer(const std::vector<R3>& p1, const std::vector<R3>& p2, double wavenumber0): PointKernel<std::complex<double>>(p1,p2), wavenumber(wavenumber0){}
+
+	std::complex<double> get_coef(const int& i, const int& j) const{
+		double g, phase;
+		amplitude_phase(x1[i]-x2[j],y1[i]-y2[j],z1[i]-z2[j],wavenumber,g,phase);
+		return std::polar(g,phase);
+	}
+
+	// std::complex<double> has the layout of double[2]
+	void copy_row(const int& i, const int* const cols, const int& nb_cols, std::complex<double>* const out) const{
+		const double xi = x1[i], yi = y1[i], zi = z1[i];
+		double* const out_d = reinterpret_cast<double*>(out);
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_cols; k++){
+			int j = cols[k];
+			amplitude_phase(xi-x2[j],yi-y2[j],zi-z2[j],wavenumber,out_d[2*k],out_d[2*k+1]);
+		}
+		exp_phase(out_d,nb_cols);
+	}
+
+	void copy_col(const int& j, const int* const rows, const int& nb_rows, std::complex<double>* const out) const{
+		const double xj = x2[j], yj = y2[j], zj = z2[j];
+		double* const out_d = reinterpret_cast<double*>(out);
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_rows; k++){
+			int i = rows[k];
+			amplitude_phase(x1[i]-xj,y1[i]-yj,z1[i]-zj,wavenumber,out_d[2*k],out_d[2*k+1]);
+		}
+		exp_phase(out_d,nb_rows);
+	}
+};
+
+}
+
+#endif
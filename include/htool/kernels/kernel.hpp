@@ -0,0 +1,41 @@
+#ifndef HTOOL_KERNELS_KERNEL_HPP
+#define HTOOL_KERNELS_KERNEL_HPP
+
+#include <vector>
+#include "../types/matrix.hpp"
+#include "../types/point.hpp"
+
+namespace htool {
+
+// Base class of kernels between two sets of points. Coordinates are stored by component, so that loops
+// over a row or a column in copy_row and copy_col can be vectorized. Loops calling std::sqrt are only vectorized
+// with -fno-math-errno, which Release_native adds to -march=native.
+template<typename T>
+class PointKernel: public IMatrix<T>{
+protected:
+	std::vector<double> x1, y1, z1;
+	std::vector<double> x2, y2, z2;
+
+	PointKernel(const std::vector<R3>& p1, const std::vector<R3>& p2): IMatrix<T>(p1.size(),p2.size()), x1(p1.size()), y1(p1.size()), z1(p1.size()), x2(p2.size()), y2(p2.size()), z2(p2.size()){
+		for (int i=0;i<p1.size();i++){
+			x1[i] = p1[i][0]; y1[i] = p1[i][1]; z1[i] = p1[i][2];
+		}
+		for (int j=0;j<p2.size();j++){
+			x2[j] = p2[j][0]; y2[j] = p2[j][1]; z2[j] = p2[j][2];
+		}
+	}
+
+public:
+	// Sub-blocks are computed column by column
+	SubMatrix<T> get_submatrix(const std::vector<int>& J, const std::vector<int>& K) const{
+		SubMatrix<T> mat(J,K);
+		for (int k=0; k<K.size(); k++){
+			this->copy_col(K[k],J.data(),J.size(),mat.data()+k*J.size());
+		}
+		return mat;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef HTOOL_KERNELS_LAPLACE_HPP
+#define HTOOL_KERNELS_LAPLACE_HPP
+
+#include <cmath>
+#include "kernel.hpp"
+
+namespace htool {
+
+// Single layer kernel of the Laplace equation G(x,y) = 1/(4 pi |x-y|), with G(x,x) = 0
+// Kernels are evaluated without branches (x=y is handled by a select), so that loops can be vectorized
+class LaplaceSingleLayer: public PointKernel<double>{
+
+	static inline double kernel(double dx, double dy, double dz){
+		double r2 = dx*dx+dy*dy+dz*dz;
+		double inv = 1./(4*M_PI*std::sqrt(r2));
+		return (r2>0) ? inv : 0.;
+	}
+
+public:
+	LaplaceSingleLayer(const std::vector<R3>& p1, const std::vector<R3>& p2): PointKernel<double>(p1,p2){}
+
+	double get_coef(const int& i, const int& j) const{
+		return kernel(x1[i]-x2[j],y1[i]-y2[j],z1[i]-z2[j]);
+	}
+
+	void copy_row(const int& i, const int* const cols, const int& nb_cols, double* const out) const{
+		const double xi = x1[i], yi = y1[i], zi = z1[i];
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_cols; k++){
+			int j = cols[k];
+			out[k] = kernel(xi-x2[j],yi-y2[j],zi-z2[j]);
+		}
+	}
+
+	void copy_col(const int& j, const int* const rows, const int& nb_rows, double* const out) const{
+		const double xj = x2[j], yj = y2[j], zj = z2[j];
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_rows; k++){
+			int i = rows[k];
+			out[k] = kernel(x1[i]-xj,y1[i]-yj,z1[i]-zj);
+		}
+	}
+};
+
+// Double layer kernel of the Laplace equation, normal derivative of G with respect to y:
+// (x-y).n(y)/(4 pi |x-y|^3), with n(y) the normals given at the points of the second set, 0 when x=y
+class LaplaceDoubleLayer: public PointKernel<double>{
+	std::vector<double> nx2, ny2, nz2;
+
+	static inline double kernel(double dx, double dy, double dz, double nx, double ny, double nz){
+		double r2 = dx*dx+dy*dy+dz*dz;
+		double value = (dx*nx+dy*ny+dz*nz)/(4*M_PI*r2*std::sqrt(r2));
+		return (r2>0) ? value : 0.;
+	}
+
+public:
+	LaplaceDoubleLayer(const std::vector<R3>& p1, const std::vector<R3>& p2, const std::vector<R3>& n2): PointKernel<double>(p1,p2), nx2(n2.size()), ny2(n2.size()), nz2(n2.size()){
+		assert(n2.size()==p2.size());
+		for (int j=0;j<n2.size();j++){
+			nx2[j] = n2[j][0]; ny2[j] = n2[j][1]; nz2[j] = n2[j][2];
+		}
+	}
+
+	double get_coef(const int& i, const int& j) const{
+		return kernel(x1[i]-x2[j],y1[i]-y2[j],z1[i]-z2[j],nx2[j],ny2[j],nz2[j]);
+	}
+
+	void copy_row(const int& i, const int* const cols, const int& nb_cols, double* const out) const{
+		const double xi = x1[i], yi = y1[i], zi = z1[i];
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_cols; k++){
+			int j = cols[k];
+			out[k] = kernel(xi-x2[j],yi-y2[j],zi-z2[j],nx2[j],ny2[j],nz2[j]);
+		}
+	}
+
+	void copy_col(const int& j, const int* const rows, const int& nb_rows, double* const out) const{
+		const double xj = x2[j], yj = y2[j], zj = z2[j];
+		const double nxj = nx2[j], nyj = ny2[j], nzj = nz2[j];
+		#if _OPENMP
+		#pragma omp simd
+		#endif
+		for (int k=0; k<nb_rows; k++){
+			int i = rows[k];
+			out[k] = kernel(x1[i]-xj,y1[i]-yj,z1[i]-zj,nxj,nyj,nzj);
+		}
+	}
+};
+
+}
+
+#endif
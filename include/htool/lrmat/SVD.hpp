@@ -3,6 +3,8 @@
 
 #include "lrmat.hpp"
 #include <cassert>
+#include <algorithm>
+#include <type_traits>
 #include "../wrappers/wrapper_lapack.hpp"
 
 namespace htool{
@@ -28,7 +30,7 @@ public:
     else {
       //// Matrix assembling
       double Norm = 0;
-      SubMatrix<T> submat = A.get_submatrix(this->ir,this->ic);
+      SubMatrix<T> submat = A.get_submatrix(std::vector<int>(this->get_ir(),this->get_ir()+this->nr),std::vector<int>(this->get_ic(),this->get_ic()+this->nc));
       for (int i=0; i<submat.nb_rows(); i++){
         for (int j=0; j<submat.nb_cols(); j++){
           Norm+= std::pow(std::abs(submat(i,j)),2);
@@ -37,24 +39,28 @@ public:
       Norm=sqrt(Norm);
 
       //// SVD
+      // Economy-size decomposition with divide and conquer: u is m x min(m,n) and vt is min(m,n) x n,
+      // tall or wide blocks are first reduced by a QR factorization inside gesdd
       int m = submat.nb_rows();
       int n = submat.nb_cols();
+      int k = std::min(m,n);
       int lda = m;
       int ldu = m;
-      int ldvt = n;
+      int ldvt = k;
       int lwork =-1;
       int info;
-      singular_values.resize(std::min(m,n));
-      Matrix<T> u(m,m);
-      // std::vector<T> vt (n*n);
-      Matrix<T> vt(n,n);
-      std::vector<T> work(std::min(m,n));
-      std::vector<underlying_type<T>> rwork(5*std::min(m,n));
-
-      Lapack<T>::gesvd("A","A",&m,&n,submat.data(),&lda,singular_values.data(),u.data(),&ldu,vt.data(),&ldvt,work.data(),&lwork,rwork.data(),&info);
+      singular_values.resize(k);
+      Matrix<T> u(m,k);
+      Matrix<T> vt(k,n);
+      std::vector<T> work(1);
+      // real workspace only used in the complex case
+      std::vector<underlying_type<T>> rwork(std::is_same<T,underlying_type<T>>::value ? 1 : std::max(5*k*k+7*k,2*std::max(m,n)*k+2*k*k+k));
+      std::vector<int> iwork(8*k);
+
+      Lapack<T>::gesdd("S",&m,&n,submat.data(),&lda,singular_values.data(),u.data(),&ldu,vt.data(),&ldvt,work.data(),&lwork,rwork.data(),iwork.data(),&info);
       lwork = (int)std::real(work[0]);
       work.resize(lwork);
-      Lapack<T>::gesvd("A","A",&m,&n,submat.data(),&lda,singular_values.data(),u.data(),&ldu,vt.data(),&ldvt,work.data(),&lwork,rwork.data(),&info);
+      Lapack<T>::gesdd("S",&m,&n,submat.data(),&lda,singular_values.data(),u.data(),&ldu,vt.data(),&ldvt,work.data(),&lwork,rwork.data(),iwork.data(),&info);
 
       if (this->rank==-1){
 
@@ -81,18 +87,15 @@ public:
       }
 
       if (this->rank>0){
-        this->U.resize(submat.nb_rows(),reqrank);
-        this->V.resize(reqrank,submat.nb_cols());
+        this->U.resize(m,reqrank);
+        this->V.resize(reqrank,n);
 
-        for (int i=0;i<submat.nb_rows();i++){
-          for (int j=0;j<reqrank;j++){
-            this->U(i,j)=u(i,j)*singular_values[j];
-          }
+        std::copy_n(u.data(),m*reqrank,this->U.data());
+        for (int j=0;j<reqrank;j++){
+          std::transform(this->U.data()+j*m,this->U.data()+(j+1)*m,this->U.data()+j*m,[&](T a){return a*singular_values[j];});
         }
-        for (int i=0;i<reqrank;i++){
-          for (int j=0;j<submat.nb_cols();j++){
-              this->V(i,j)=vt(i,j);
-            }
+        for (int j=0;j<n;j++){
+          std::copy_n(vt.data()+j*k,reqrank,this->V.data()+j*reqrank);
         }
       }
     }
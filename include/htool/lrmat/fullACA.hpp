@@ -48,7 +48,7 @@ public:
 		else{
 
 			// Matrix assembling
-			Matrix<T> M=A.get_submatrix(this->ir,this->ic);
+			Matrix<T> M=A.get_submatrix(std::vector<int>(this->get_ir(),this->get_ir()+this->nr),std::vector<int>(this->get_ic(),this->get_ic()+this->nc));
 
 			// Full pivot
 			int q=0;
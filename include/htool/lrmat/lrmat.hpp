@@ -2,10 +2,17 @@
 #define HTOOL_LRMAT_HPP
 
 #include <vector>
+#include <memory>
+#include <type_traits>
+#include <limits>
+#include <algorithm>
 #include "../clustering/cluster.hpp"
 #include <htool/clustering/ncluster.hpp>
 #include "../types/matrix.hpp"
 #include "../types/multimatrix.hpp"
+#include "../types/half.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+#include "recompression.hpp"
 namespace htool{
 
 template<typename T, typename ClusterImpl=GeometricClustering>
@@ -15,16 +22,35 @@ protected:
     // Data member
     int rank, nr, nc;
     Matrix<T>  U,V;
-    std::vector<int> ir;
-    std::vector<int> ic;
+    // Factors in reduced precision, used instead of U and V depending on the precision of the block: in single precision,
+    // or in half precision with one scale per column of U and per row of V, rows of V being stored one after the other
+    Precision precision = Precision::WorkingPrecision;
+    Matrix<single_precision_type<T>> U_single,V_single;
+    std::vector<std::uint16_t> U_half,V_half;
+    std::vector<float> U_scales,V_scales;
+    static const int nb_parts = sizeof(T)/sizeof(underlying_type<T>);
+    // Row and column indices are ranges [ir_start,ir_start+nr) and [ic_start,ic_start+nc) of shared index vectors (e.g. cluster permutations)
+    std::shared_ptr<const std::vector<int>> ir;
+    std::shared_ptr<const std::vector<int>> ic;
+    int ir_start;
+    int ic_start;
     int offset_i;
     int offset_j;
 public:
 
     // Constructors
     LowRankMatrix() = delete;
-    LowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), U(ir0.size(),1),V(1,ic0.size()), ir(ir0), ic(ic0), offset_i(0), offset_j(0){}
-    LowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int offset_i0, int offset_j0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), U(ir0.size(),1),V(1,ic0.size()), ir(ir0),ic(ic0),offset_i(offset_i0), offset_j(offset_j0){}
+    LowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), U(ir0.size(),1),V(1,ic0.size()), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(0), offset_j(0){}
+    LowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int offset_i0, int offset_j0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), U(ir0.size(),1),V(1,ic0.size()), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(offset_i0), offset_j(offset_j0){}
+    // Indices given by nr0 (resp. nc0) entries of ir0 (resp. ic0) starting from ir_start0 (resp. ic_start0), without copy
+    LowRankMatrix(const std::shared_ptr<const std::vector<int>>& ir0, int ir_start0, int nr0, const std::shared_ptr<const std::vector<int>>& ic0, int ic_start0, int nc0, int offset_i0, int offset_j0, int rank0=-1):rank(rank0), nr(nr0), nc(nc0), U(nr0,1),V(1,nc0), ir(ir0), ic(ic0), ir_start(ir_start0), ic_start(ic_start0), offset_i(offset_i0), offset_j(offset_j0){}
+
+    // Blocks are deleted through pointers to the compression classes deriving from LowRankMatrix
+    LowRankMatrix(const LowRankMatrix&) = default;
+    LowRankMatrix(LowRankMatrix&&) = default;
+    LowRankMatrix& operator=(const LowRankMatrix&) = default;
+    LowRankMatrix& operator=(LowRankMatrix&&) = default;
+    virtual ~LowRankMatrix() {};
 
     // VIrtual function
     virtual void build(const IMatrix<T>& A, const Cluster<ClusterImpl>& t, const std::vector<R3>& xt,const std::vector<int>& tabt, const Cluster<ClusterImpl>& s, const std::vector<R3>& xs, const std::vector<int>& tabs) = 0;
@@ -33,24 +59,53 @@ public:
     int nb_rows() const {return this->nr;}
     int nb_cols() const{return this->nc;}
     int rank_of() const {return this->rank;}
-    std::vector<int> get_ir() const {return this->ir;}
-    std::vector<int> get_ic() const {return this->ic;}
+    const int* get_ir() const {return this->ir->data()+this->ir_start;}
+    const int* get_ic() const {return this->ic->data()+this->ic_start;}
     int get_offset_i() const {return this->offset_i;}
     int get_offset_j() const {return this->offset_j;}
-    T get_U(int i, int j) const {return this->U(i,j);}
-    T get_V(int i, int j) const {return this->V(i,j);}
+    T get_U(int i, int j) const {
+        if (this->precision==Precision::HalfPrecision){
+            single_precision_type<T> a;
+            unpack_half(this->U_half.data()+(i+j*this->nr)*nb_parts,1,this->U_scales[j],&a);
+            return T(a);
+        }
+        return this->is_single_precision() ? T(this->U_single(i,j)) : this->U(i,j);
+    }
+    T get_V(int i, int j) const {
+        if (this->precision==Precision::HalfPrecision){
+            single_precision_type<T> a;
+            unpack_half(this->V_half.data()+(j+i*this->nc)*nb_parts,1,this->V_scales[i],&a);
+            return T(a);
+        }
+        return this->is_single_precision() ? T(this->V_single(i,j)) : this->V(i,j);
+    }
+    const Matrix<T>& get_U() const {return this->U;}
+    const Matrix<T>& get_V() const {return this->V;}
+    Precision get_precision() const {return this->precision;}
+    bool is_single_precision() const {return this->precision==Precision::SinglePrecision;}
+    const Matrix<single_precision_type<T>>& get_U_single() const {return this->U_single;}
+    const Matrix<single_precision_type<T>>& get_V_single() const {return this->V_single;}
     std::vector<int> get_xr() const {return this->xr;}
     std::vector<int> get_xc() const {return this->xc;}
     std::vector<int> get_tabr() const {return this->tabr;}
     std::vector<int> get_tabc() const {return this->tabc;}
 
     std::vector<T> operator*(const std::vector<T>& a) const{
+        if (precision!=Precision::WorkingPrecision){
+          std::vector<T> b(nr);
+          mvprod(a.data(),b.data());
+          return b;
+        }
         return this->U*(this->V*a);
     }
     void mvprod(const T* const in,  T* const out) const{
         if (rank==0){
           std::fill(out,out+nr,0);
         }
+        else if (precision!=Precision::WorkingPrecision){
+          std::fill(out,out+nr,0);
+          add_mvprod_row_major(in,out,1);
+        }
         else{
           std::vector<T> a(this->rank);
           V.mvprod(in,a.data());
@@ -60,21 +115,91 @@ public:
 
     void add_mvprod_row_major(const T* const in,  T* const out, const int& mu, char trans = 'N') const{
         if (rank!=0){
-            std::vector<T> a(this->rank*mu);
+            std::vector<T> a(this->workspace_size()*mu);
+            add_mvprod_row_major(in,out,mu,trans,a.data());
+        }
+    }
+
+    // Size of the workspace needed by products with one vector: the rank, and with complex entries room for the
+    // conjugated input of products with A^H (see Matrix::mvprod_row_major), or, with factors in reduced precision,
+    // room for the input, the output and the intermediate vector in single precision, and for the factors
+    // unpacked in single precision if they are stored in half precision
+    int workspace_size() const {
+        switch (precision){
+            case Precision::SinglePrecision:
+                return single_precision_workspace_size<T>(nr+nc+rank);
+            case Precision::HalfPrecision:
+                return single_precision_workspace_size<T>((nr+nc)*(rank+1)+rank);
+            default:
+                return rank+(std::is_same<T,underlying_type<T>>::value ? 0 : std::max(nr,rank));
+        }
+    }
+
+    // Same with a workspace of size at least workspace_size()*mu provided by the caller, trans being 'N', 'T' or 'C';
+    // with factors in reduced precision, the product of each block is computed in single precision and added to out
+    void add_mvprod_row_major(const T* const in,  T* const out, const int& mu, char trans, T* const work) const{
+        if (rank!=0 && precision!=Precision::WorkingPrecision){
+            int size_in  = (trans=='N') ? nc : nr;
+            int size_out = (trans=='N') ? nr : nc;
+            single_precision_type<T>* buffer = reinterpret_cast<single_precision_type<T>*>(work);
+            const Matrix<single_precision_type<T>>* U_reduced = &U_single;
+            const Matrix<single_precision_type<T>>* V_reduced = &V_single;
+            Matrix<single_precision_type<T>> U_unpacked, V_unpacked;
+            if (precision==Precision::HalfPrecision){
+                unpack_half_factors(buffer,buffer+nr*rank);
+                U_unpacked.assign(nr,rank,buffer);
+                V_unpacked.assign(rank,nc,buffer+nr*rank);
+                U_reduced = &U_unpacked;
+                V_reduced = &V_unpacked;
+                buffer += (nr+nc)*rank;
+            }
+            single_precision_type<T>* const in_single   = buffer;
+            single_precision_type<T>* const work_single = in_single+size_in*mu;
+            single_precision_type<T>* const out_single  = work_single+rank*mu;
             if (trans == 'N'){
-                V.mvprod_row_major(in,a.data(),mu);
-                U.add_mvprod_row_major(a.data(),out,mu);
+                std::transform(in,in+size_in*mu,in_single,[](const T& a){return single_precision_type<T>(a);});
+                V_reduced->mvprod_row_major(in_single,work_single,mu);
+                U_reduced->mvprod_row_major(work_single,out_single,mu);
+                for (int i=0;i<size_out*mu;i++){
+                    out[i] += T(out_single[i]);
+                }
             }
-            else if (trans == 'C'){
-                U.mvprod_row_major(in,a.data(),mu,trans);
-                V.add_mvprod_row_major(a.data(),out,mu,trans);
+            else{
+                // A^H in = conj(A^T conj(in)), without workspace in the products
+                bool conjugate = (trans=='C');
+                std::transform(in,in+size_in*mu,in_single,[conjugate](const T& a){return single_precision_type<T>(conjugate ? conj_if_complex(a) : a);});
+                U_reduced->mvprod_row_major(in_single,work_single,mu,'T');
+                V_reduced->mvprod_row_major(work_single,out_single,mu,'T');
+                for (int i=0;i<size_out*mu;i++){
+                    out[i] += conjugate ? T(conj_if_complex(out_single[i])) : T(out_single[i]);
+                }
+            }
+        }
+        else if (rank!=0){
+            if (trans == 'N'){
+                V.mvprod_row_major(in,work,mu);
+                U.add_mvprod_row_major(work,out,mu);
+            }
+            else{
+                U.mvprod_row_major(in,work,mu,trans,work+rank*mu);
+                V.add_mvprod_row_major(work,out,mu,trans,work+rank*mu);
             }
-
-
         }
     }
 
     void get_whole_matrix(T* const out) const {
+        if (precision!=Precision::WorkingPrecision){
+            std::fill_n(out,nr*nc,0);
+            for (int j=0;j<nc;j++){
+                for (int l=0;l<rank;l++){
+                    T v = get_V(l,j);
+                    for (int i=0;i<nr;i++){
+                        out[i+j*nr] += get_U(i,l)*v;
+                    }
+                }
+            }
+            return;
+        }
         char transa ='N';
         char transb ='N';
         int M = U.nb_rows();
@@ -95,14 +220,198 @@ public:
         return (1 - ( this->rank*( 1./double(this->nr) + 1./double(this->nc))));
     }
 
+    // Recompression: with U = Q_U R_U and V^T = Q_V R_V, the SVD W S Z^* of R_U R_V^T gives UV = (Q_U W S) (Z^* Q_V^T),
+    // which is truncated to the smallest rank whose discarded singular values are below epsilon in relative Frobenius norm
+    void recompress(){
+        int k = this->rank;
+        if (k<=1 || k>std::min(nr,nc) || precision!=Precision::WorkingPrecision){
+            return;
+        }
+
+        std::vector<T> new_U, new_V;
+        int new_rank = recompress_lowrank(nr,nc,k,U.data(),V.data(),this->epsilon,new_U,new_V,1);
+        if (new_rank==k){
+            return;
+        }
+        set_factors(new_rank,new_U.data(),new_V.data());
+    }
+
+    // Agglomeration: the block becomes the recompression of the sum of the low-rank blocks lrmats and of the dense blocks dmats,
+    // given with global offsets inside this block, dense blocks being written as products with an identity;
+    // the rank is set to -1 if their total rank is larger than the size of the block
+    template<typename LowRankMatrixType>
+    void agglomerate(const std::vector<LowRankMatrixType*>& lrmats, const std::vector<SubMatrix<T>*>& dmats){
+        int k = 0;
+        for (auto lrmat : lrmats){
+            k += lrmat->rank_of();
+        }
+        for (auto dmat : dmats){
+            k += std::min(dmat->nb_rows(),dmat->nb_cols());
+        }
+        if (k>std::min(nr,nc)){
+            this->rank = -1;
+            return;
+        }
 
+        this->rank = k;
+        U.resize(nr,std::max(k,1));
+        V.resize(std::max(k,1),nc);
+        U = T(0);
+        V = T(0);
+        int q = 0;
+        for (auto lrmat : lrmats){
+            int i0 = lrmat->get_offset_i()-offset_i;
+            int j0 = lrmat->get_offset_j()-offset_j;
+            for (int l=0;l<lrmat->rank_of();l++){
+                std::copy_n(&(lrmat->get_U()(0,l)),lrmat->nb_rows(),&(U(i0,q+l)));
+                for (int j=0;j<lrmat->nb_cols();j++){
+                    V(q+l,j0+j) = lrmat->get_V(l,j);
+                }
+            }
+            q += lrmat->rank_of();
+        }
+        for (auto dmat : dmats){
+            const SubMatrix<T>& M = *dmat;
+            int i0 = M.get_offset_i()-offset_i;
+            int j0 = M.get_offset_j()-offset_j;
+            if (M.nb_rows()<=M.nb_cols()){
+                for (int i=0;i<M.nb_rows();i++){
+                    U(i0+i,q+i) = 1;
+                    for (int j=0;j<M.nb_cols();j++){
+                        V(q+i,j0+j) = M(i,j);
+                    }
+                }
+                q += M.nb_rows();
+            }
+            else{
+                for (int j=0;j<M.nb_cols();j++){
+                    std::copy_n(&(M(0,j)),M.nb_rows(),&(U(i0,q+j)));
+                    V(q+j,j0+j) = 1;
+                }
+                q += M.nb_cols();
+            }
+        }
+
+        recompress();
+    }
+
+    // Storage of the factors in reduced precision: in half precision if half is true and the accuracy allows it, otherwise
+    // in single precision if the accuracy allows it. The rounding error is bounded by 2u sum_l |U(:,l)|_2 |V(l,:)|_2, with u
+    // the relative error of the storage on a column of U or a row of V, and it has to be below epsilon|UV|_F.
+    // Factors in the working precision are released, and the new precision is returned
+    Precision reduce_precision(bool half=false){
+        int k = this->rank;
+        if (k<=0 || precision!=Precision::WorkingPrecision){
+            return precision;
+        }
+
+        // |UV|_F^2 = tr(U^* U V V^*), and norms of the columns of U and of the rows of V
+        std::vector<T> GU(k*k), GV(k*k);
+        T one = 1, zero = 0;
+        Blas<T>::gemm("C","N",&k,&k,&nr,&one,U.data(),&nr,U.data(),&nr,&zero,GU.data(),&k);
+        Blas<T>::gemm("N","C",&k,&k,&nc,&one,V.data(),&k,V.data(),&k,&zero,GV.data(),&k);
+        double norm_terms = 0, norm = 0;
+        for (int l=0;l<k;l++){
+            norm_terms += std::sqrt(std::real(GU[l+l*k])*std::real(GV[l+l*k]));
+            for (int q=0;q<k;q++){
+                norm += std::real(GU[l+q*k]*GV[q+l*k]);
+            }
+        }
+        double tolerance = this->epsilon*std::sqrt(std::max(norm,0.));
+
+        if (half && 2*pack_half_relative_error(std::max(nr,nc)*nb_parts)*norm_terms<=tolerance){
+            U_half.resize(nr*k*nb_parts);
+            V_half.resize(k*nc*nb_parts);
+            U_scales.resize(k);
+            V_scales.resize(k);
+            std::vector<T> row(nc);
+            for (int l=0;l<k;l++){
+                U_scales[l] = pack_half(U.data()+l*nr,nr,U_half.data()+l*nr*nb_parts);
+                for (int j=0;j<nc;j++){
+                    row[j] = V(l,j);
+                }
+                V_scales[l] = pack_half(row.data(),nc,V_half.data()+l*nc*nb_parts);
+            }
+            precision = Precision::HalfPrecision;
+        }
+        else if (!std::is_same<T,single_precision_type<T>>::value && 2*std::numeric_limits<underlying_type<single_precision_type<T>>>::epsilon()/2*norm_terms<=tolerance){
+            U_single.resize(nr,k);
+            V_single.resize(k,nc);
+            std::transform(U.data(),U.data()+nr*k,U_single.data(),[](const T& a){return single_precision_type<T>(a);});
+            std::transform(V.data(),V.data()+k*nc,V_single.data(),[](const T& a){return single_precision_type<T>(a);});
+            precision = Precision::SinglePrecision;
+        }
+        else{
+            return precision;
+        }
+        U.assign(0,0,nullptr);
+        V.assign(0,0,nullptr);
+        return precision;
+    }
+
+    // Copy of new factors in working precision, U0 is nr x rank0 and V0 is rank0 x nc (column-major)
+    void set_factors(int rank0, const T* const U0, const T* const V0){
+        this->rank = rank0;
+        this->precision = Precision::WorkingPrecision;
+        U.assign(0,0,nullptr);
+        V.assign(0,0,nullptr);
+        U.resize(this->nr,rank0);
+        V.resize(rank0,this->nc);
+        std::copy_n(U0,std::size_t(this->nr)*rank0,U.data());
+        std::copy_n(V0,std::size_t(rank0)*this->nc,V.data());
+    }
+
+    // Factors stored in external memory (e.g. a memory-mapped checkpoint), U is nr x k and V is k x nc
+    void assign(int rank0, int k, T* const U0, T* const V0){
+        this->rank = rank0;
+        U.assign(this->nr,k,U0);
+        V.assign(k,this->nc,V0);
+    }
+
+    // Same with factors in single precision
+    void assign_single_precision(int rank0, int k, single_precision_type<T>* const U0, single_precision_type<T>* const V0){
+        this->rank = rank0;
+        this->precision = Precision::SinglePrecision;
+        U_single.assign(this->nr,k,U0);
+        V_single.assign(k,this->nc,V0);
+    }
+
+
+private:
+    // Factors in half precision unpacked in single precision, U_unpacked is nr x rank and V_unpacked is rank x nc
+    void unpack_half_factors(single_precision_type<T>* const U_unpacked, single_precision_type<T>* const V_unpacked) const{
+        for (int l=0;l<rank;l++){
+            unpack_half(U_half.data()+l*nr*nb_parts,nr,U_scales[l],U_unpacked+l*nr);
+            const std::uint16_t* row = V_half.data()+l*nc*nb_parts;
+            for (int j=0;j<nc;j++){
+                unpack_half(row+j*nb_parts,1,V_scales[l],V_unpacked+l+j*rank);
+            }
+        }
+    }
+
+public:
     friend std::ostream& operator<<(std::ostream& os, const LowRankMatrix& m){
         os << "rank:\t" << m.rank << std::endl;
         os << "nr:\t"   << m.nr << std::endl;
         os << "nc:\t"   << m.nc << std::endl;
         os << "U:\n";
-        os<< m.U << std::endl;
-        os<< m.V << std::endl;
+        if (m.precision!=Precision::WorkingPrecision){
+            Matrix<T> U0(m.nr,m.rank), V0(m.rank,m.nc);
+            for (int l=0;l<m.rank;l++){
+                for (int i=0;i<m.nr;i++){
+                    U0(i,l) = m.get_U(i,l);
+                }
+                for (int j=0;j<m.nc;j++){
+                    V0(l,j) = m.get_V(l,j);
+                }
+            }
+            os<< U0 << std::endl;
+            os<< V0 << std::endl;
+        }
+        else{
+            os<< m.U << std::endl;
+            os<< m.V << std::endl;
+        }
 
         return os;
     }
@@ -116,8 +425,8 @@ double Frobenius_relative_error(const LowRankMatrix<T,ClusterImpl>& lrmat, const
   }
   T norm= 0;
   T err = 0;
-  std::vector<int> ir = lrmat.get_ir();
-  std::vector<int> ic = lrmat.get_ic();
+  const int* ir = lrmat.get_ir();
+  const int* ic = lrmat.get_ic();
 
   for (int j=0;j<lrmat.nb_rows();j++){
     for (int k=0;k<lrmat.nb_cols();k++){
@@ -141,8 +450,8 @@ double Frobenius_absolute_error(const LowRankMatrix<T, ClusterImpl>& lrmat, cons
     reqrank=lrmat.rank_of();
   }
   T err = 0;
-  std::vector<int> ir = lrmat.get_ir();
-  std::vector<int> ic = lrmat.get_ic();
+  const int* ir = lrmat.get_ir();
+  const int* ic = lrmat.get_ic();
 
   for (int j=0;j<lrmat.nb_rows();j++){
     for (int k=0;k<lrmat.nb_cols();k++){
@@ -163,8 +472,8 @@ double Frobenius_absolute_error(const LowRankMatrix<std::complex<T>,ClusterImpl>
     reqrank=lrmat.rank_of();
   }
   T err = 0;
-  std::vector<int> ir = lrmat.get_ir();
-  std::vector<int> ic = lrmat.get_ic();
+  const int* ir = lrmat.get_ir();
+  const int* ic = lrmat.get_ic();
 
   for (int j=0;j<lrmat.nb_rows();j++){
     for (int k=0;k<lrmat.nb_cols();k++){
@@ -185,8 +494,8 @@ double Frobenius_absolute_error(const LowRankMatrix<T,ClusterImpl>& lrmat, const
     reqrank=lrmat.rank_of();
   }
   T err = 0;
-  std::vector<int> ir = lrmat.get_ir();
-  std::vector<int> ic = lrmat.get_ic();
+  const int* ir = lrmat.get_ir();
+  const int* ic = lrmat.get_ic();
 
   for (int j=0;j<lrmat.nb_rows();j++){
     for (int k=0;k<lrmat.nb_cols();k++){
@@ -207,8 +516,8 @@ double Frobenius_absolute_error(const LowRankMatrix<std::complex<T>,ClusterImpl>
     reqrank=lrmat.rank_of();
   }
   T err = 0;
-  std::vector<int> ir = lrmat.get_ir();
-  std::vector<int> ic = lrmat.get_ic();
+  const int* ir = lrmat.get_ir();
+  const int* ic = lrmat.get_ic();
 
   for (int j=0;j<lrmat.nb_rows();j++){
     for (int k=0;k<lrmat.nb_cols();k++){
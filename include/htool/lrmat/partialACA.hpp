@@ -48,12 +48,14 @@ public:
 			this->V.resize(1,this->nc);
 		}
 		else{
+			const int* ir = this->get_ir();
+			const int* ic = this->get_ic();
 
 			//// Choice of the first row (see paragraph 3.4.3 page 151 Bebendorf)
 			double dist=1e30;
 			int I=0;
 			for (int i =0;i<int(this->nr/Parametres::ndofperelt);i++){
-				double aux_dist= norm2(xt[tabt[this->ir[i*Parametres::ndofperelt]]]-t.get_ctr());
+				double aux_dist= norm2(xt[tabt[ir[i*Parametres::ndofperelt]]]-t.get_ctr());
 				if (dist>aux_dist){
 					dist=aux_dist;
 					I=i*Parametres::ndofperelt;
@@ -63,10 +65,27 @@ public:
 			int J=0;
 			int q = 0;
 			int reqrank = this->rank;
-			std::vector<std::vector<T> > uu, vv;
 			std::vector<bool> visited_row(this->nr,false);
 			std::vector<bool> visited_col(this->nc,false);
 
+			// Crosses are stored contiguously in column-major order: column k of U_buf is the kth column of U
+			// and column k of V_buf is the kth row of V. Their capacity is at most the size of the dense block.
+			int maxrank = (this->nr*this->nc)/(this->nr+this->nc);
+			if (reqrank>0){
+				maxrank = std::min(maxrank,reqrank);
+			}
+			std::vector<T> U_buf, V_buf, work(2*maxrank);
+			U_buf.reserve(this->nr*maxrank);
+			V_buf.reserve(this->nc*maxrank);
+			T* w1 = work.data();
+			T* w2 = work.data()+maxrank;
+			char transN = 'N';
+			char transC = 'C';
+			int inc = 1;
+			T one = 1;
+			T minus_one = -1;
+			T zero = 0;
+
 			double frob = 0;
 			double aux  = 0;
 			// Either we have a required rank
@@ -83,20 +102,24 @@ public:
 					break;
 				}
 				else{
-					std::vector<T> r(this->nc),c(this->nr);
+					int k = q-1; // number of crosses already computed
+					U_buf.resize(this->nr*q);
+					V_buf.resize(this->nc*q);
+					T* r = V_buf.data()+this->nc*k;
+					T* c = U_buf.data()+this->nr*k;
 
 					// Compute the first cross
 					//==================//
 					// Look for a column
 					double pivot = 0.;
-					SubMatrix<T> row = A.get_submatrix(std::vector<int> {this->ir[I]},this->ic);
-					for(int k=0; k<this->nc; k++){
-						r[k] = row(0,k);//A.get_coef(this->ir[I],this->ic[k]);
-						for(int j=0; j<uu.size(); j++){
-							r[k] += -uu[j][I]*vv[j][k];
-						}
-						if( std::abs(r[k])>pivot && !visited_col[k] ){
-							J=k; pivot=std::abs(r[k]);}
+					A.copy_row(ir[I],ic,this->nc,r);
+					if (k>0){
+						// r = r - V^T U(I,:)
+						Blas<T>::gemv(&transN,&(this->nc),&k,&minus_one,V_buf.data(),&(this->nc),U_buf.data()+I,&(this->nr),&one,r,&inc);
+					}
+					for(int j=0; j<this->nc; j++){
+						if( std::abs(r[j])>pivot && !visited_col[j] ){
+							J=j; pivot=std::abs(r[j]);}
 					}
 
 					visited_row[I] = true;
@@ -105,12 +128,12 @@ public:
 					// Look for a line
 					if( std::abs(r[J]) > 1e-15 ){
 						double cmax = 0.;
-						SubMatrix<T> col = A.get_submatrix(this->ir,std::vector<int> {this->ic[J]});
+						A.copy_col(ic[J],ir,this->nr,c);
+						if (k>0){
+							// c = c - U V(:,J)
+							Blas<T>::gemv(&transN,&(this->nr),&k,&minus_one,U_buf.data(),&(this->nr),V_buf.data()+J,&(this->nc),&one,c,&inc);
+						}
 						for(int j=0; j<this->nr; j++){
-							c[j] = col(j,0);//A.get_coef(this->ir[j],this->ic[J]);
-							for(int k=0; k<uu.size(); k++){
-								c[j] += -uu[k][j]*vv[k][J];
-							}
 							c[j] = gamma*c[j];
 							if( std::abs(c[j])>cmax && !visited_row[j] ){
 								I=j; cmax=std::abs(c[j]);}
@@ -119,23 +142,27 @@ public:
 						// Test if no given rank
 						if (reqrank<0){
 							// Error estimator
-							T frob_aux = 0.;
-							aux = std::abs(dprod(c,c)*dprod(r,r));
+							double norm_r = 0, norm_c = 0;
+							for(int j=0; j<this->nc; j++){
+								norm_r += std::norm(r[j]);
+							}
+							for(int j=0; j<this->nr; j++){
+								norm_c += std::norm(c[j]);
+							}
+							aux = norm_c*norm_r;
 							// aux: terme quadratiques du developpement du carre' de la norme de Frobenius de la matrice low rank
-							for(int j=0; j<uu.size(); j++){
-								frob_aux += dprod(r,vv[j])*dprod(c,uu[j]);
+							T frob_aux = 0.;
+							if (k>0){
+								Blas<T>::gemv(&transC,&(this->nc),&k,&one,V_buf.data(),&(this->nc),r,&inc,&zero,w1,&inc);
+								Blas<T>::gemv(&transC,&(this->nr),&k,&one,U_buf.data(),&(this->nr),c,&inc,&zero,w2,&inc);
+								for(int j=0; j<k; j++){
+									frob_aux += w1[j]*w2[j];
+								}
 							}
 							// frob_aux: termes croises du developpement du carre' de la norme de Frobenius de la matrice low rank
 							frob += aux + 2*std::real(frob_aux); // frob: Frobenius norm of the low rank matrix
 							//==================//
 						}
-						// Matrix<T> M=A.get_submatrix(this->ir,this->ic);
-						// uu.push_back(M.get_col(J));
-						// vv.push_back(M.get_row(I)/M(I,J));
-						// New cross added
-						uu.push_back(c);
-						vv.push_back(r);
-
 					}
 					else{
 						// std::cout << "There is a zero row in the starting submatrix and ACA didn't work" << std::endl;
@@ -149,9 +176,11 @@ public:
 			if (this->rank>0){
 				this->U.resize(this->nr,this->rank);
 				this->V.resize(this->rank,this->nc);
+				std::copy_n(U_buf.data(),this->nr*this->rank,this->U.data());
 				for (int k=0;k<this->rank;k++){
-					this->U.set_col(k,uu[k]);
-					this->V.set_row(k,vv[k]);
+					for (int j=0;j<this->nc;j++){
+						this->V(k,j) = V_buf[j+k*this->nc];
+					}
 				}
 			}
 		}
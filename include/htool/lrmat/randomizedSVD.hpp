@@ -0,0 +1,208 @@
+#ifndef HTOOL_RANDOMIZEDSVD_HPP
+#define HTOOL_RANDOMIZEDSVD_HPP
+
+#include "lrmat.hpp"
+#include <random>
+#include "../wrappers/wrapper_blas.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+
+namespace htool{
+
+// Number of random vectors sampled at each step of the randomized range finder
+const int randomizedSVD_block_size = 8;
+
+//=================================//
+//         RANDOMIZED SVD          //
+//=================================//
+//
+// Refs biblio:
+//
+//  -> N. Halko, P.-G. Martinsson, J. A. Tropp, Finding structure with randomness, SIAM Review 53(2), 2011
+//
+//  -> P.-G. Martinsson, S. Voronin, A randomized blocked algorithm for efficiently computing
+//     rank-revealing factorizations of matrices, SIAM J. Sci. Comput. 38(5), 2016
+//
+//=================================//
+template< typename T, typename ClusterImpl>
+class randomizedSVD: public LowRankMatrix<T,ClusterImpl>{
+
+private:
+  // Data member
+  std::vector<underlying_type<T>> singular_values;
+
+public:
+  // If reqrank=-1 (default value), the rank is found adaptively from epsilon: blocks of random vectors are sampled
+  // until the residual is below epsilon, and the basis is then truncated with the SVD of the small projected matrix;
+  // otherwise, reqrank+randomizedSVD_block_size vectors are sampled and the result is truncated to reqrank
+  using LowRankMatrix<T,ClusterImpl>::LowRankMatrix;
+
+  void build(const IMatrix<T>& A){
+    if (this->rank==0){
+      this->U.resize(this->nr,1);
+      this->V.resize(1,this->nc);
+      return;
+    }
+
+    //// Matrix assembling, the block is then overwritten by the residual
+    SubMatrix<T> residual = A.get_submatrix(std::vector<int>(this->get_ir(),this->get_ir()+this->nr),std::vector<int>(this->get_ic(),this->get_ic()+this->nc));
+    T* R = residual.data();
+    int m = this->nr;
+    int n = this->nc;
+    double norm = 0;
+    for (int i=0;i<m*n;i++){
+      norm += std::norm(R[i]);
+    }
+    norm = std::sqrt(norm);
+
+    // Zero block, e.g. padding or a kernel vanishing on the block
+    if (norm==0){
+      this->rank = 0;
+      this->U.resize(this->nr,1);
+      this->V.resize(1,this->nc);
+      return;
+    }
+
+    int reqrank = this->rank;
+    int maxrank = (this->nr*this->nc)/(this->nr+this->nc);
+    int sample_max = std::min(m,n);
+    if (reqrank>0){
+      reqrank = std::min(reqrank,std::min(m,n));
+      sample_max = std::min(reqrank+randomizedSVD_block_size,sample_max);
+    }
+    else{
+      sample_max = std::min(maxrank+randomizedSVD_block_size,sample_max);
+    }
+
+    //// Blocked randomized range finder
+    // Q is an orthonormal basis of the sampled range (m x k), Bt stores (Q^* A)^* (n x k)
+    std::mt19937 generator;
+    std::normal_distribution<underlying_type<T>> distribution;
+    std::vector<T> Q, Bt, Omega, W;
+    int k = 0;
+    double error = norm;
+    T one = 1, zero = 0, minus_one = -1;
+    while (k<sample_max && (reqrank>0 || error>this->epsilon*norm)){
+      int b = std::min(randomizedSVD_block_size,sample_max-k);
+
+      // Samples of the residual
+      Omega.resize(n*b);
+      underlying_type<T>* omega = reinterpret_cast<underlying_type<T>*>(Omega.data());
+      for (int i=0;i<int(n*b*sizeof(T)/sizeof(underlying_type<T>));i++){
+        omega[i] = distribution(generator);
+      }
+      Q.resize(m*(k+b));
+      T* Y = Q.data()+m*k;
+      Blas<T>::gemm("N","N",&m,&b,&n,&one,R,&m,Omega.data(),&n,&zero,Y,&m);
+
+      // Orthonormalization, made twice against the previous basis because of round-off errors
+      for (int pass=0;pass<(k>0 ? 2 : 1);pass++){
+        if (k>0){
+          W.resize(k*b);
+          Blas<T>::gemm("C","N",&k,&b,&m,&one,Q.data(),&m,Y,&m,&zero,W.data(),&k);
+          Blas<T>::gemm("N","N",&m,&b,&k,&minus_one,Q.data(),&m,W.data(),&k,&one,Y,&m);
+        }
+        orthonormalize(m,b,Y);
+      }
+
+      // Projection and update of the residual
+      Bt.resize(n*(k+b));
+      T* Bt_b = Bt.data()+n*k;
+      Blas<T>::gemm("C","N",&n,&b,&m,&one,R,&m,Y,&m,&zero,Bt_b,&n);
+      Blas<T>::gemm("N","C",&m,&n,&b,&minus_one,Y,&m,Bt_b,&n,&one,R,&m);
+      k += b;
+
+      error = 0;
+      for (int i=0;i<m*n;i++){
+        error += std::norm(R[i]);
+      }
+      error = std::sqrt(error);
+    }
+
+    if (reqrank<0 && error>this->epsilon*norm){
+      this->rank = -1;
+      return;
+    }
+
+    // Nothing sampled, the block being below epsilon
+    if (k==0){
+      this->rank = 0;
+      this->U.resize(this->nr,1);
+      this->V.resize(1,this->nc);
+      return;
+    }
+
+    //// SVD of the projected matrix B^* = W S Z^*, so that A = Q Z S W^* + residual
+    singular_values.resize(k);
+    std::vector<T> w(n*k), zt(k*k);
+    int lwork = -1;
+    int info;
+    std::vector<T> work(1);
+    std::vector<underlying_type<T>> rwork(5*k);
+    Lapack<T>::gesvd("S","S",&n,&k,Bt.data(),&n,singular_values.data(),w.data(),&n,zt.data(),&k,work.data(),&lwork,rwork.data(),&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::gesvd("S","S",&n,&k,Bt.data(),&n,singular_values.data(),w.data(),&n,zt.data(),&k,work.data(),&lwork,rwork.data(),&info);
+
+    if (reqrank<0){
+      // Smallest rank such that the residual and the discarded singular values are below epsilon
+      double tail = error*error;
+      reqrank = k;
+      while (reqrank>1 && tail+std::pow(singular_values[reqrank-1],2)<=std::pow(this->epsilon*norm,2)){
+        tail += std::pow(singular_values[reqrank-1],2);
+        reqrank--;
+      }
+      if (reqrank*(this->nr+this->nc) > (this->nr*this->nc)){
+        this->rank = -1;
+        return;
+      }
+    }
+    else{
+      reqrank = std::min(reqrank,k);
+    }
+    this->rank = reqrank;
+
+    this->U.resize(m,reqrank);
+    this->V.resize(reqrank,n);
+    Blas<T>::gemm("N","C",&m,&reqrank,&k,&one,Q.data(),&m,zt.data(),&k,&zero,this->U.data(),&m);
+    for (int j=0;j<reqrank;j++){
+      for (int i=0;i<m;i++){
+        this->U(i,j) *= singular_values[j];
+      }
+      for (int i=0;i<n;i++){
+        this->V(j,i) = conjugate(w[i+j*n]);
+      }
+    }
+  }
+
+  void build(const IMatrix<T>& A, const Cluster<ClusterImpl>&, const std::vector<R3>&, const std::vector<int>&, const Cluster<ClusterImpl>&, const std::vector<R3>&, const std::vector<int>&){
+    this->build(A);
+  }
+  T get_singular_value(int i){return singular_values[i];}
+
+private:
+  template<typename V>
+  static V conjugate(const V& v){return v;}
+  template<typename V>
+  static std::complex<V> conjugate(const std::complex<V>& v){return std::conj(v);}
+
+  // Overwrites the m x b matrix Y with an orthonormal basis of its range
+  static void orthonormalize(int m, int b, T* Y){
+    std::vector<T> tau(b), work(1);
+    int lwork = -1;
+    int info;
+    Lapack<T>::geqrf(&m,&b,Y,&m,tau.data(),work.data(),&lwork,&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::geqrf(&m,&b,Y,&m,tau.data(),work.data(),&lwork,&info);
+    lwork = -1;
+    Lapack<T>::orgqr(&m,&b,&b,Y,&m,tau.data(),work.data(),&lwork,&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::orgqr(&m,&b,&b,Y,&m,tau.data(),work.data(),&lwork,&info);
+  }
+};
+
+}
+
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef HTOOL_LRMAT_RECOMPRESSION_HPP
+#define HTOOL_LRMAT_RECOMPRESSION_HPP
+
+#include <vector>
+#include <algorithm>
+#include <complex>
+#include "../wrappers/wrapper_blas.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+
+namespace htool {
+
+// Dense linear algebra shared by the truncation of low-rank blocks (LowRankMatrix::recompress, HBlock arithmetic).
+// Matrices are stored in column-major order.
+
+// Overwrites the m x k matrix A with the factor Q of its QR factorization, R is stored in the k x k matrix R
+template<typename T>
+void qr_factorization(int m, int k, T* const A, T* const R){
+    std::vector<T> tau(k), work(1);
+    int lwork = -1;
+    int info;
+    Lapack<T>::geqrf(&m,&k,A,&m,tau.data(),work.data(),&lwork,&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::geqrf(&m,&k,A,&m,tau.data(),work.data(),&lwork,&info);
+    for (int j=0;j<k;j++){
+        std::copy_n(A+std::size_t(j)*m,j+1,R+std::size_t(j)*k);
+        std::fill(R+std::size_t(j)*k+j+1,R+std::size_t(j+1)*k,0);
+    }
+    lwork = -1;
+    Lapack<T>::orgqr(&m,&k,&k,A,&m,tau.data(),work.data(),&lwork,&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::orgqr(&m,&k,&k,A,&m,tau.data(),work.data(),&lwork,&info);
+}
+
+// SVD of the m x n matrix A, which is overwritten: A = u diag(s) vt, with u m x min(m,n) and vt min(m,n) x n
+template<typename T>
+int svd_factorization(int m, int n, T* const A, underlying_type<T>* const s, T* const u, T* const vt){
+    int min_mn = std::min(m,n);
+    if (min_mn==0){
+        return 0;
+    }
+    int lwork = -1;
+    int info;
+    std::vector<T> work(1);
+    std::vector<underlying_type<T>> rwork(5*min_mn);
+    Lapack<T>::gesvd("S","S",&m,&n,A,&m,s,u,&m,vt,&min_mn,work.data(),&lwork,rwork.data(),&info);
+    lwork = (int)std::real(work[0]);
+    work.resize(lwork);
+    Lapack<T>::gesvd("S","S",&m,&n,A,&m,s,u,&m,vt,&min_mn,work.data(),&lwork,rwork.data(),&info);
+    return info;
+}
+
+// Smallest rank, at least min_rank, such that the discarded singular values are below epsilon times the norm
+template<typename U>
+int truncated_rank(const std::vector<U>& s, double epsilon, int min_rank=0){
+    int k = s.size();
+    double norm = 0;
+    for (int l=0;l<k;l++){
+        norm += double(s[l])*s[l];
+    }
+    double tail = 0;
+    while (k>min_rank && tail+double(s[k-1])*s[k-1]<=epsilon*epsilon*norm){
+        tail += double(s[k-1])*s[k-1];
+        k--;
+    }
+    return k;
+}
+
+// Recompression of U*V, with U m x k and V k x n, k <= min(m,n): with U = Q_U R_U and V^T = Q_V R_V, the SVD W S Z^* of R_U R_V^T
+// gives UV = (Q_U W S) (Z^* Q_V^T), which is truncated to the smallest rank, at least min_rank, whose discarded singular values
+// are below epsilon in relative Frobenius norm. The new rank is returned, with the factors in new_U (m x rank) and new_V (rank x n)
+// if it is smaller than k, otherwise new_U and new_V are not modified.
+template<typename T>
+int recompress_lowrank(int m, int n, int k, const T* const U, const T* const V, double epsilon, std::vector<T>& new_U, std::vector<T>& new_V, int min_rank=0){
+    if (k<=min_rank){
+        return k;
+    }
+
+    // QR factorizations of U and V^T
+    std::vector<T> QU(U,U+std::size_t(m)*k), QV(std::size_t(n)*k), RU(std::size_t(k)*k), RV(std::size_t(k)*k);
+    for (int l=0;l<k;l++){
+        for (int j=0;j<n;j++){
+            QV[j+std::size_t(l)*n] = V[l+std::size_t(j)*k];
+        }
+    }
+    qr_factorization(m,k,QU.data(),RU.data());
+    qr_factorization(n,k,QV.data(),RV.data());
+
+    // SVD of R_U R_V^T
+    std::vector<T> R(std::size_t(k)*k), w(std::size_t(k)*k), zt(std::size_t(k)*k);
+    std::vector<underlying_type<T>> s(k);
+    T one = 1, zero = 0;
+    Blas<T>::gemm("N","T",&k,&k,&k,&one,RU.data(),&k,RV.data(),&k,&zero,R.data(),&k);
+    if (svd_factorization(k,k,R.data(),s.data(),w.data(),zt.data())!=0){
+        return k;
+    }
+
+    // Truncation
+    int new_rank = truncated_rank(s,epsilon,min_rank);
+    if (new_rank==k){
+        return k;
+    }
+    for (int l=0;l<new_rank;l++){
+        for (int i=0;i<k;i++){
+            w[i+std::size_t(l)*k] *= s[l];
+        }
+    }
+    new_U.resize(std::size_t(m)*new_rank);
+    new_V.resize(std::size_t(new_rank)*n);
+    if (new_rank>0){
+        Blas<T>::gemm("N","N",&m,&new_rank,&k,&one,QU.data(),&m,w.data(),&k,&zero,new_U.data(),&m);
+        Blas<T>::gemm("N","T",&new_rank,&n,&k,&one,zt.data(),&k,QV.data(),&n,&zero,new_V.data(),&new_rank);
+    }
+    return new_rank;
+}
+
+}
+
+#endif
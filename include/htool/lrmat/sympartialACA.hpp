@@ -49,9 +49,11 @@ public:
 		}
 		else{
 			
+			const int* ir = this->get_ir();
+			const int* ic = this->get_ic();
 			int n1,n2;
-			std::vector<int> const * i1;
-			std::vector<int> const * i2;
+			const int* i1;
+			const int* i2;
 			std::vector<int> const * tab1;
 			std::vector<int> const * tab2;
 			std::vector<R3> const* x1;
@@ -64,8 +66,8 @@ public:
 
 				n1=this->nr;
 				n2=this->nc;
-				i1=&(this->ir);
-				i2=&(this->ic);
+				i1=ir;
+				i2=ic;
 				tab1=&tabt;
 				tab2=&tabs;
 				x1=&xt;
@@ -76,8 +78,8 @@ public:
 			else{
 				n1=this->nc;
 				n2=this->nr;
-				i1=&(this->ic);
-				i2=&(this->ir);
+				i1=ic;
+				i2=ir;
 				tab1=&tabs;
 				tab2=&tabt;
 				x1=&xs;
@@ -91,7 +93,7 @@ public:
 			double dist=1e30;
 			int I1=0;
 			for (int i =0;i<int(n1/Parametres::ndofperelt);i++){
-				double aux_dist= norm2((*x1)[(*tab1)[(*i1)[i*Parametres::ndofperelt]]]-(*cluster_1).get_ctr());
+				double aux_dist= norm2((*x1)[(*tab1)[i1[i*Parametres::ndofperelt]]]-(*cluster_1).get_ctr());
 				if (dist>aux_dist){
 					dist=aux_dist;
 					I1=i*Parametres::ndofperelt;
@@ -129,26 +131,17 @@ public:
 					// Look for a column
 					double pivot = 0.;
 					if (this->offset_i>=this->offset_j){
-						SubMatrix<T> submat1 = A.get_submatrix(std::vector<int> {(*i1)[I1]},*i2);
-						for(int k=0; k<n2; k++){
-							line2[k] = submat1(0,k);//A.get_coef(this->ir[I],this->ic[k]);
-							for(int j=0; j<uu.size(); j++){
-								line2[k] += -uu[j][I1]*vv[j][k];
-							}
-							if( std::abs(line2[k])>pivot && !visited_2[k] ){
-								I2=k; pivot=std::abs(line2[k]);}
-						}
+						A.copy_row(i1[I1],i2,n2,line2.data());
 					}
 					else{
-						SubMatrix<T> submat1 = A.get_submatrix(*i2,std::vector<int> {(*i1)[I1]});
-						for(int k=0; k<n2; k++){
-							line2[k] = submat1(k,0);//A.get_coef(this->ir[I],this->ic[k]);
-							for(int j=0; j<uu.size(); j++){
-								line2[k] += -uu[j][I1]*vv[j][k];
-							}
-							if( std::abs(line2[k])>pivot && !visited_2[k] ){
-								I2=k; pivot=std::abs(line2[k]);}
+						A.copy_col(i1[I1],i2,n2,line2.data());
+					}
+					for(int k=0; k<n2; k++){
+						for(int j=0; j<uu.size(); j++){
+							line2[k] += -uu[j][I1]*vv[j][k];
 						}
+						if( std::abs(line2[k])>pivot && !visited_2[k] ){
+							I2=k; pivot=std::abs(line2[k]);}
 					}
 					visited_1[I1] = true;
 					T gamma = T(1.)/line2[I2];
@@ -158,28 +151,18 @@ public:
 					if( std::abs(line2[I2]) > 1e-15 ){
 						double cmax = 0.;
 						if (this->offset_i>=this->offset_j){
-							SubMatrix<T> submat2 = A.get_submatrix(*i1,std::vector<int> {(*i2)[I2]});
-							for(int j=0; j<n1; j++){
-								line1[j] = submat2(j,0);//A.get_coef(this->ir[j],this->ic[J]);
-								for(int k=0; k<uu.size(); k++){
-									line1[j] += -uu[k][j]*vv[k][I2];
-								}
-								line1[j] = gamma*line1[j];
-								if( std::abs(line1[j])>cmax && !visited_1[j] ){
-									I1=j; cmax=std::abs(line1[j]);}
-							}
+							A.copy_col(i2[I2],i1,n1,line1.data());
 						}
 						else{
-							SubMatrix<T> submat2 = A.get_submatrix(std::vector<int> {(*i2)[I2]},*i1);
-							for(int j=0; j<n1; j++){
-								line1[j] = submat2(0,j);//A.get_coef(this->ir[j],this->ic[J]);
-								for(int k=0; k<uu.size(); k++){
-									line1[j] += -uu[k][j]*vv[k][I2];
-								}
-								line1[j] = gamma*line1[j];
-								if( std::abs(line1[j])>cmax && !visited_1[j] ){
-									I1=j; cmax=std::abs(line1[j]);}
+							A.copy_row(i2[I2],i1,n1,line1.data());
+						}
+						for(int j=0; j<n1; j++){
+							for(int k=0; k<uu.size(); k++){
+								line1[j] += -uu[k][j]*vv[k][I2];
 							}
+							line1[j] = gamma*line1[j];
+							if( std::abs(line1[j])>cmax && !visited_1[j] ){
+								I1=j; cmax=std::abs(line1[j]);}
 						}
 						visited_2[I2] = true;
 
@@ -16,6 +16,15 @@ public:
  	static int minclustersize;
 	static int mintargetdepth; 
 	static int minsourcedepth; 
+	static bool blockarena;
+	static bool loadbalancing;
+	static bool distributedclustering;
+	static bool recompression;
+	static bool coarsening;
+	static bool mixedprecision;
+	static bool halfprecision;
+	static bool nearfieldcompression;
+	static bool pipelinedmvprod;
 
 	Parametres();
 	Parametres(int, double, double, int, int, int, int);
@@ -35,6 +44,24 @@ public:
 	friend void SetMinTargetDepth(int);
 	friend int GetMinSourceDepth();
 	friend void SetMinSourceDepth(int);
+	friend bool GetBlockArena();
+	friend void SetBlockArena(bool);
+	friend bool GetLoadBalancing();
+	friend void SetLoadBalancing(bool);
+	friend bool GetDistributedClustering();
+	friend void SetDistributedClustering(bool);
+	friend bool GetRecompression();
+	friend void SetRecompression(bool);
+	friend bool GetCoarsening();
+	friend void SetCoarsening(bool);
+	friend bool GetMixedPrecision();
+	friend void SetMixedPrecision(bool);
+	friend bool GetHalfPrecision();
+	friend void SetHalfPrecision(bool);
+	friend bool GetNearFieldCompression();
+	friend void SetNearFieldCompression(bool);
+	friend bool GetPipelinedMvprod();
+	friend void SetPipelinedMvprod(bool);
 
 };
 
@@ -46,6 +73,15 @@ int Parametres::maxblocksize;
 int Parametres::minclustersize;
 int Parametres::mintargetdepth;
 int Parametres::minsourcedepth;
+bool Parametres::blockarena=false;
+bool Parametres::loadbalancing=false;
+bool Parametres::distributedclustering=false;
+bool Parametres::recompression=false;
+bool Parametres::coarsening=false;
+bool Parametres::mixedprecision=false;
+bool Parametres::halfprecision=false;
+bool Parametres::nearfieldcompression=false;
+bool Parametres::pipelinedmvprod=false;
 
 Parametres::Parametres(){
 
@@ -113,6 +149,94 @@ void SetMinSourceDepth(int minsourcedepth0){
 	Parametres::minsourcedepth=minsourcedepth0;
 }
 
+// If true, HMatrix packs the data of all its blocks in one contiguous buffer after assembly
+bool GetBlockArena(){
+	return Parametres::blockarena;
+}
+
+void SetBlockArena(bool blockarena0){
+	Parametres::blockarena=blockarena0;
+}
+
+// If true, HMatrix redistributes the compression of its blocks among processes
+// according to their estimated cost, blocks are sent back to their owner afterwards
+bool GetLoadBalancing(){
+	return Parametres::loadbalancing;
+}
+
+void SetLoadBalancing(bool loadbalancing0){
+	Parametres::loadbalancing=loadbalancing0;
+}
+
+// If true, the levels of NCluster above the local clusters are computed by all processes
+// together and each process only splits its local cluster, subtrees are exchanged afterwards
+bool GetDistributedClustering(){
+	return Parametres::distributedclustering;
+}
+
+void SetDistributedClustering(bool distributedclustering0){
+	Parametres::distributedclustering=distributedclustering0;
+}
+
+// If true, HMatrix recompresses its low-rank blocks after assembly: the factors are orthogonalized
+// and the rank is truncated at epsilon with the SVD of the product of their triangular factors
+bool GetRecompression(){
+	return Parametres::recompression;
+}
+
+void SetRecompression(bool recompression0){
+	Parametres::recompression=recompression0;
+}
+
+// If true, HMatrix replaces the blocks covering exactly the sons of a pair of clusters by one low-rank block,
+// obtained by recompression of their union, when it needs less memory
+bool GetCoarsening(){
+	return Parametres::coarsening;
+}
+
+void SetCoarsening(bool coarsening0){
+	Parametres::coarsening=coarsening0;
+}
+
+// If true, HMatrix stores in single precision the factors of the low-rank blocks whose accuracy allows it,
+// their products being computed in single precision and accumulated in the working precision
+bool GetMixedPrecision(){
+	return Parametres::mixedprecision;
+}
+
+void SetMixedPrecision(bool mixedprecision0){
+	Parametres::mixedprecision=mixedprecision0;
+}
+
+// If true, the storage in mixed precision may also use half precision, with one scale per column of U and per row of V
+bool GetHalfPrecision(){
+	return Parametres::halfprecision;
+}
+
+void SetHalfPrecision(bool halfprecision0){
+	Parametres::halfprecision=halfprecision0;
+}
+
+// If true, HMatrix stores the dense blocks in half or single precision when the error on each block stays below epsilon,
+// entries being decoded in the products; they must then be read with get_coef or SubMatrix::get_whole_matrix
+bool GetNearFieldCompression(){
+	return Parametres::nearfieldcompression;
+}
+
+void SetNearFieldCompression(bool nearfieldcompression0){
+	Parametres::nearfieldcompression=nearfieldcompression0;
+}
+
+// If true, HMatrix splits its local rows in slices not cut by any block, and mvprod_global starts the gather of each slice
+// of the output as soon as it is computed, so that communications overlap the product of the next slices
+bool GetPipelinedMvprod(){
+	return Parametres::pipelinedmvprod;
+}
+
+void SetPipelinedMvprod(bool pipelinedmvprod0){
+	Parametres::pipelinedmvprod=pipelinedmvprod0;
+}
+
 Parametres Parametres_defauts(1,10,1e-3,1000000,10,0,0);
 }
 #endif
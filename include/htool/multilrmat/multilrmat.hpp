@@ -25,13 +25,15 @@ public:
     // Constructors
     MultiLowRankMatrix() = delete;
     MultiLowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int nm0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), nm(nm0), ir(ir0), ic(ic0), offset_i(0), offset_j(0){
+        std::shared_ptr<const std::vector<int>> ir_shared = std::make_shared<const std::vector<int>>(ir), ic_shared = std::make_shared<const std::vector<int>>(ic);
         for (int l=0;l<nm;l++){
-            LowRankMatrices.emplace_back(ir,ic,rank0);
+            LowRankMatrices.emplace_back(ir_shared,0,nr,ic_shared,0,nc,0,0,rank0);
         }
     }
     MultiLowRankMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, int nm0, int offset_i0, int offset_j0, int rank0=-1):rank(rank0), nr(ir0.size()), nc(ic0.size()), nm(nm0), ir(ir0),ic(ic0),offset_i(offset_i0), offset_j(offset_j0){
+        std::shared_ptr<const std::vector<int>> ir_shared = std::make_shared<const std::vector<int>>(ir), ic_shared = std::make_shared<const std::vector<int>>(ic);
         for (int l=0;l<nm;l++){
-            LowRankMatrices.emplace_back(ir,ic,offset_i,offset_j,rank0);
+            LowRankMatrices.emplace_back(ir_shared,0,nr,ic_shared,0,nc,offset_i,offset_j,rank0);
         }
     }
 
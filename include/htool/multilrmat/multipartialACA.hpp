@@ -77,11 +77,10 @@ public:
 					// Look for a column
 					double pivot = 0.;
 
-					MultiSubMatrix<T> row = A.get_submatrices(std::vector<int> {this->ir[I]},this->ic);
+					A.copy_row(this->ir[I],this->ic.data(),this->nc,r.data());
 
 					for (int l=0;l<this->nm;l++){
 						for(int k=0; k<this->nc; k++){
-							r(k,l) = row[l](0,k);
 							for(int j=0; j<uu.size(); j++){
 								r(k,l) += -uu[j](I,l)*vv[j](k,l);
 							}
@@ -100,10 +99,9 @@ public:
 					// Look for a line
 					if( std::abs(min(r.get_row(J))) > 1e-15 ){
 						double cmax = 0.;
-						MultiSubMatrix<T> col = A.get_submatrices(this->ir,std::vector<int> {this->ic[J]});
+						A.copy_col(this->ic[J],this->ir.data(),this->nr,c.data());
 						for (int l=0;l<this->nm;l++){
 							for(int j=0; j<this->nr; j++){
-								c(j,l) = col[l](j,0);
 								for(int k=0; k<uu.size(); k++){
 									c(j,l) += -uu[k](j,l)*vv[k](J,l);
 								}
@@ -50,13 +50,9 @@ public:
         // Internal dense blocks
         for (int l=0;l<MyDiagNearFieldMats.size();l++){
             const SubMatrix<T>& submat = *(MyDiagNearFieldMats[l]);
-            int local_nr = submat.nb_rows();
-            int local_nc = submat.nb_cols();
             int offset_i = submat.get_offset_i()-hpddm_op.HA.get_local_offset();;
             int offset_j = submat.get_offset_j()-hpddm_op.HA.get_local_offset();
-            for (int k=0;k<local_nc;k++){
-                std::copy_n(&(submat(0,k)),local_nr,&mat_loc[offset_i+(offset_j+k)*n]);
-            }
+            submat.get_whole_matrix(&mat_loc[offset_i+offset_j*n],n);
         }
 
         // Internal compressed block
@@ -134,13 +130,9 @@ public:
         // Internal dense blocks
         for (int l=0;l<MyDiagNearFieldMats.size();l++){
           const SubMatrix<T>& submat = *(MyDiagNearFieldMats[l]);
-          int local_nr = submat.nb_rows();
-          int local_nc = submat.nb_cols();
           int offset_i = submat.get_offset_i()-hpddm_op.HA.get_local_offset();;
           int offset_j = submat.get_offset_j()-hpddm_op.HA.get_local_offset();
-          for (int k=0;k<local_nc;k++){
-            std::copy_n(&(submat(0,k)),local_nr,&mat_loc[offset_i+(offset_j+k)*n]);
-          }
+          submat.get_whole_matrix(&mat_loc[offset_i+offset_j*n],n);
         }
 
         // Internal compressed block
@@ -226,13 +218,9 @@ public:
         // Internal dense blocks
         for (int i=0;i<MyLocalNearFieldMats.size();i++){
           const SubMatrix<T>& submat = *(MyLocalNearFieldMats[i]);
-          int local_nr = submat.nb_rows();
-          int local_nc = submat.nb_cols();
           int offset_i = submat.get_offset_i()-hpddm_op.HA.get_local_offset();
           int offset_j = submat.get_offset_j()-hpddm_op.HA.get_local_offset();
-          for (int i=0;i<local_nc;i++){
-            std::copy_n(&(submat(0,i)),local_nr,Bi.data()+offset_i+(offset_j+i)*n);
-          }
+          submat.get_whole_matrix(Bi.data()+offset_i+offset_j*n,n);
         }
 
         // Internal compressed block
@@ -0,0 +1,118 @@
+#ifndef HTOOL_HLU_HPP
+#define HTOOL_HLU_HPP
+
+#include <memory>
+#include <map>
+#include <string>
+#include "../types/hmatrix.hpp"
+#include "../types/hblock.hpp"
+#include "../misc/parametres.hpp"
+#include "../misc/user.hpp"
+
+namespace htool{
+
+//=================================//
+//          H-LU SOLVER            //
+//=================================//
+//
+// Direct solver for square HMatrix whose rows and columns are numbered by the same cluster tree: the blocks are
+// gathered on each process and factorized with H-arithmetic, as A = P L U, or A = L D L^T when the HMatrix is
+// symmetric with real scalars, the truncations keeping the relative error on each block below epsilon. Symmetric
+// HMatrix with complex scalars satisfy A^T = A, which L D L^H does not preserve, so that they are factorized with LU
+// from their blocks completed by transposition. The factorization is replicated, so that solutions are computed
+// without communication.
+//
+//=================================//
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+class HLU{
+private:
+    int n;
+    bool symmetric;
+    bool ldlt;
+    double epsilon;
+    std::vector<int> perm;
+    std::unique_ptr<HBlock<T>> root;
+    int rankWorld;
+    mutable std::map<std::string, std::string> infos;
+
+public:
+    // Collective on the communicator of A, low-rank blocks being truncated at epsilon0 (by default, the epsilon A was built with)
+    HLU(const HMatrix<T,LowRankMatrix,ClusterImpl>& A, double epsilon0=-1): n(A.nb_rows()), symmetric(A.is_symmetric()), ldlt(symmetric && std::is_same<T,underlying_type<T>>::value), epsilon(epsilon0<0 ? A.get_epsilon() : epsilon0), perm(A.get_permt()), rankWorld(A.get_rankworld()){
+        if (A.nb_rows()!=A.nb_cols() || &(A.get_cluster_tree_t())!=&(A.get_cluster_tree_s())){
+            if (rankWorld==0){
+                std::cerr << "HLU needs a square HMatrix with the same cluster tree for its rows and columns"<<std::endl;
+            }
+            return;
+        }
+        double time = MPI_Wtime();
+
+        // Hierarchy of all blocks, real symmetric matrices being factorized from their lower part
+        root = A.to_hblock(ldlt);
+        if (ldlt){
+            root->ldlt(epsilon);
+        }
+        else{
+            root->lu(epsilon);
+        }
+
+        // Infos
+        time = MPI_Wtime()-time;
+        double maxtime;
+        MPI_Reduce(&time, &maxtime, 1, MPI_DOUBLE, MPI_MAX, 0, A.get_comm());
+        infos["HLU_factorization_max"] = NbrToStr(maxtime);
+        infos["HLU_factorization_type"] = ldlt ? "LDLh" : "LU";
+        infos["HLU_compression"] = NbrToStr(1-double(root->size())/(double(n)*n));
+    }
+
+    // x = A^-1 rhs, for mu right-hand sides stored one after another in the global numbering
+    void solve(const T* const rhs, T* const x, int mu=1) const {
+        if (!root){
+            std::cerr << "HLU is not factorized"<<std::endl;
+            return;
+        }
+        std::vector<T> y(std::size_t(n)*mu);
+        for (int p=0;p<mu;p++){
+            for (int i=0;i<n;i++){
+                y[i+std::size_t(p)*n] = rhs[perm[i]+std::size_t(p)*n];
+            }
+        }
+        root->solve_L(y.data(),n,mu);
+        if (ldlt){
+            root->solve_D(y.data(),n,mu);
+            root->solve_LH(y.data(),n,mu);
+        }
+        else{
+            root->solve_U(y.data(),n,mu);
+        }
+        for (int p=0;p<mu;p++){
+            for (int i=0;i<n;i++){
+                x[perm[i]+std::size_t(p)*n] = y[i+std::size_t(p)*n];
+            }
+        }
+    }
+
+    std::vector<T> operator*(const std::vector<T>& rhs) const {
+        std::vector<T> x(rhs.size());
+        this->solve(rhs.data(),x.data(),rhs.size()/n);
+        return x;
+    }
+
+    // Getters
+    bool is_symmetric() const {return symmetric;}
+    const HBlock<T>& get_factors() const {return *root;}
+    const std::map<std::string, std::string>& get_infos() const {return infos;}
+    const std::string& get_infos(const std::string& key) const { return infos[key];}
+
+    void print_infos() const{
+        if (rankWorld==0){
+            for (std::map<std::string,std::string>::const_iterator it = infos.begin() ; it != infos.end() ; ++it){
+                std::cout<<it->first<<"\t"<<it->second<<std::endl;
+            }
+            std::cout << std::endl;
+        }
+    }
+};
+
+}
+
+#endif
@@ -115,13 +115,9 @@ public:
         // Internal dense blocks
         for (int i=0;i<MyDiagNearFieldMats.size();i++){
           const SubMatrix<T>& submat = *(MyDiagNearFieldMats[i]);
-          int local_nr = submat.nb_rows();
-          int local_nc = submat.nb_cols();
           int offset_i = submat.get_offset_i()-hmat_0.get_local_offset();
           int offset_j = submat.get_offset_j()-hmat_0.get_local_offset();
-          for (int i=0;i<local_nc;i++){
-            std::copy_n(&(submat(0,i)),local_nr,&mat_loc[offset_i+(offset_j+i)*n]);
-          }
+          submat.get_whole_matrix(&mat_loc[offset_i+offset_j*n],n);
         }
 
         // Internal compressed block
@@ -216,13 +212,9 @@ public:
         // Internal dense blocks
         for (int i=0;i<MyLocalNearFieldMats.size();i++){
           const SubMatrix<T>& submat = *(MyLocalNearFieldMats[i]);
-          int local_nr = submat.nb_rows();
-          int local_nc = submat.nb_cols();
           int offset_i = submat.get_offset_i()-hmat.get_local_offset();
           int offset_j = submat.get_offset_j()-hmat.get_local_offset();
-          for (int i=0;i<local_nc;i++){
-            std::copy_n(&(submat(0,i)),local_nr,Bi.data()+offset_i+(offset_j+i)*n);
-          }
+          submat.get_whole_matrix(Bi.data()+offset_i+offset_j*n,n);
         }
 
         // Internal compressed block
@@ -369,13 +361,9 @@ void build_coarse_space(Matrix<T>& Mi, IMatrix<T>& generator_Bi, const std::vect
         // Internal dense blocks
         for (int i=0;i<MyLocalNearFieldMats.size();i++){
           const SubMatrix<T>& submat = *(MyLocalNearFieldMats[i]);
-          int local_nr = submat.nb_rows();
-          int local_nc = submat.nb_cols();
           int offset_i = submat.get_offset_i()-hmat.get_local_offset();
           int offset_j = submat.get_offset_j()-hmat.get_local_offset();
-          for (int i=0;i<local_nc;i++){
-            std::copy_n(&(submat(0,i)),local_nr,Bi.data()+offset_i+(offset_j+i)*n);
-          }
+          submat.get_whole_matrix(Bi.data()+offset_i+offset_j*n,n);
         }
 
         // Internal compressed block
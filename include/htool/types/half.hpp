@@ -0,0 +1,120 @@
+#ifndef HTOOL_HALF_HPP
+#define HTOOL_HALF_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "../wrappers/wrapper_lapack.hpp"
+
+namespace htool {
+
+// Storage precision of blocks: the precision of the matrix they belong to, or a lower one
+enum class Precision {WorkingPrecision, SinglePrecision, HalfPrecision};
+
+//=================================//
+//         HALF PRECISION          //
+//=================================//
+//
+// IEEE 754 binary16 numbers stored in std::uint16_t: 11 significant bits, so that the unit roundoff is 2^-11,
+// normal numbers from 2^-14 to 65504, and subnormal numbers with a spacing of 2^-24 below.
+// Conversions round to nearest even and do not rely on F16C instructions.
+//
+//=================================//
+
+inline std::uint16_t float_to_half(float value){
+	std::uint32_t x;
+	std::memcpy(&x,&value,sizeof(float));
+	std::uint16_t sign = (x>>16) & 0x8000;
+	std::uint32_t abs = x & 0x7fffffff;
+	std::uint32_t exponent = abs>>23;
+
+	// Infinity and NaN, or overflow
+	if (abs>0x7f800000){
+		return sign | 0x7e00;
+	}
+	if (abs>=0x47800000){
+		return sign | 0x7c00;
+	}
+
+	// Subnormal numbers, and numbers below half of the smallest one rounded to zero
+	if (exponent<113){
+		if (abs<0x33000000){
+			return sign;
+		}
+		std::uint32_t mantissa = (abs & 0x007fffff) | 0x00800000;
+		int shift = 126-exponent;
+		std::uint32_t h = mantissa>>shift;
+		std::uint32_t remainder = mantissa & ((1u<<shift)-1);
+		std::uint32_t halfway = 1u<<(shift-1);
+		if (remainder>halfway || (remainder==halfway && (h & 1))){
+			h++;
+		}
+		return sign | h;
+	}
+
+	// Normal numbers, a carry in the mantissa correctly increments the exponent
+	std::uint32_t h = ((exponent-112)<<10) | ((abs & 0x007fffff)>>13);
+	std::uint32_t remainder = abs & 0x1fff;
+	if (remainder>0x1000 || (remainder==0x1000 && (h & 1))){
+		h++;
+	}
+	return sign | h;
+}
+
+inline float half_to_float(std::uint16_t h){
+	std::uint32_t exponent = (h>>10) & 0x1f;
+	std::uint32_t mantissa = h & 0x3ff;
+	float value;
+	if (exponent==0){
+		value = mantissa*5.9604644775390625e-8f; // 2^-24
+	}
+	else{
+		std::uint32_t x = (exponent==0x1f) ? (0x7f800000 | (mantissa<<13)) : (((exponent+112)<<23) | (mantissa<<13));
+		std::memcpy(&value,&x,sizeof(float));
+	}
+	return (h & 0x8000) ? -value : value;
+}
+
+// Packing of n scalars in half precision, real and imaginary parts being stored one after the other (2n numbers in out
+// for complex scalars), after division by a scale, which is returned, so that their largest part in absolute value is one
+template<typename T>
+float pack_half(const T* const in, int n, std::uint16_t* const out){
+	const underlying_type<T>* parts = reinterpret_cast<const underlying_type<T>*>(in);
+	int nb_parts = n*(sizeof(T)/sizeof(underlying_type<T>));
+	double max = 0;
+	for (int i=0;i<nb_parts;i++){
+		max = std::max(max,std::abs(double(parts[i])));
+	}
+	float scale = (max>0) ? float(max) : 1;
+	for (int i=0;i<nb_parts;i++){
+		out[i] = float_to_half(float(parts[i]/scale));
+	}
+	return scale;
+}
+
+template<typename T>
+void unpack_half(const std::uint16_t* const in, int n, float scale, T* const out){
+	underlying_type<T>* parts = reinterpret_cast<underlying_type<T>*>(out);
+	int nb_parts = n*(sizeof(T)/sizeof(underlying_type<T>));
+	for (int i=0;i<nb_parts;i++){
+		parts[i] = half_to_float(in[i])*scale;
+	}
+}
+
+// Number of scalars of type T holding n scalars of type single_precision_type<T>, to use workspaces of type T
+template<typename T>
+int single_precision_workspace_size(int n){
+	return (n*sizeof(single_precision_type<T>)+sizeof(T)-1)/sizeof(T);
+}
+
+// Bound of |x-x'|_2/|x|_2, where x' is x packed and unpacked and x has nb_parts real and imaginary parts:
+// rounding to single and half precision of the normal numbers, and spacing of the subnormal numbers, at most the scale
+inline double pack_half_relative_error(int nb_parts){
+	return std::ldexp(1.,-11)+std::ldexp(1.,-24)+std::sqrt(double(nb_parts))*std::ldexp(1.,-25);
+}
+
+}
+
+
+#endif
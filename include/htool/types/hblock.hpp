@@ -0,0 +1,982 @@
+#ifndef HTOOL_HBLOCK_HPP
+#define HTOOL_HBLOCK_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cassert>
+#include <complex>
+#include "../clustering/cluster.hpp"
+#include "../wrappers/wrapper_blas.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+#include "../lrmat/recompression.hpp"
+
+namespace htool {
+
+//=================================//
+//       HIERARCHICAL BLOCKS       //
+//=================================//
+//
+// Block of a hierarchical matrix stored with its hierarchy, which HMatrix does not keep: a block is dense, low-rank
+// (U*V with U nr x rank and V rank x nc, in column-major order), or subdivided along the sons of its target and source
+// clusters, non-leaf clusters being split. Sums of low-rank terms are truncated so that the relative error on each
+// block is below epsilon in Frobenius norm. Offsets are indices in the numbering of the cluster trees.
+//
+// Refs biblio:
+//
+//  -> W. Hackbusch, Hierarchical Matrices: Algorithms and Analysis, Springer, 2015
+//
+//  -> L. Grasedyck, W. Hackbusch, Construction and arithmetics of H-matrices, Computing 70(4), 2003
+//
+//=================================//
+template<typename T>
+class HBlock{
+public:
+    enum class Kind {Dense, LowRank, Subdivided};
+
+private:
+    int nr, nc;
+    int offset_i, offset_j;
+    Kind kind;
+
+    // Dense blocks: entries, or factors of diagonal blocks once factorized, with the row interchanges of LU
+    std::vector<T> dense;
+    std::vector<int> pivots;
+
+    // Low-rank blocks
+    int rank;
+    std::vector<T> U, V;
+
+    // Subdivided blocks: nb_row_sons x nb_col_sons sons stored by rows; sons above the diagonal are null
+    // for diagonal blocks of symmetric matrices stored by their lower part
+    int nb_row_sons, nb_col_sons;
+    std::vector<std::unique_ptr<HBlock>> sons;
+
+public:
+    // Dense block filled with zeros, or low-rank block of rank zero
+    HBlock(Kind kind0, int nr0, int nc0, int offset_i0, int offset_j0): nr(nr0), nc(nc0), offset_i(offset_i0), offset_j(offset_j0), kind(kind0), rank(0), nb_row_sons(0), nb_col_sons(0) {
+        if (kind==Kind::Dense){
+            dense.resize(std::size_t(nr)*nc,0);
+        }
+    }
+
+    // Subdivided block, sons are set with set_son
+    HBlock(int nr0, int nc0, int offset_i0, int offset_j0, int nb_row_sons0, int nb_col_sons0): nr(nr0), nc(nc0), offset_i(offset_i0), offset_j(offset_j0), kind(Kind::Subdivided), rank(0), nb_row_sons(nb_row_sons0), nb_col_sons(nb_col_sons0), sons(nb_row_sons0*nb_col_sons0) {}
+
+    // Dense block with the nr0 x nc0 entries of data (column-major, leading dimension ld)
+    HBlock(int nr0, int nc0, int offset_i0, int offset_j0, const T* const data, int ld): HBlock(Kind::Dense,nr0,nc0,offset_i0,offset_j0) {
+        for (int j=0;j<nc;j++){
+            std::copy_n(data+std::size_t(j)*ld,nr,dense.data()+std::size_t(j)*nr);
+        }
+    }
+
+    // Low-rank block U0*V0 with U0 nr0 x rank0 and V0 rank0 x nc0
+    HBlock(int nr0, int nc0, int offset_i0, int offset_j0, int rank0, std::vector<T> U0, std::vector<T> V0): nr(nr0), nc(nc0), offset_i(offset_i0), offset_j(offset_j0), kind(Kind::LowRank), rank(rank0), U(std::move(U0)), V(std::move(V0)), nb_row_sons(0), nb_col_sons(0) {}
+
+    // Deep copy
+    HBlock(const HBlock& A): nr(A.nr), nc(A.nc), offset_i(A.offset_i), offset_j(A.offset_j), kind(A.kind), dense(A.dense), pivots(A.pivots), rank(A.rank), U(A.U), V(A.V), nb_row_sons(A.nb_row_sons), nb_col_sons(A.nb_col_sons), sons(A.sons.size()) {
+        for (int b=0;b<sons.size();b++){
+            if (A.sons[b]){
+                sons[b].reset(new HBlock(*(A.sons[b])));
+            }
+        }
+    }
+
+    // Restriction of a dense or low-rank block to the rows [offset_i0,offset_i0+nr0) and the columns [offset_j0,offset_j0+nc0)
+    HBlock(const HBlock& A, int nr0, int nc0, int offset_i0, int offset_j0): nr(nr0), nc(nc0), offset_i(offset_i0), offset_j(offset_j0), kind(A.kind), rank(A.rank), nb_row_sons(0), nb_col_sons(0) {
+        assert(A.kind!=Kind::Subdivided);
+        int i0 = offset_i-A.offset_i;
+        int j0 = offset_j-A.offset_j;
+        if (kind==Kind::Dense){
+            dense.resize(std::size_t(nr)*nc);
+            for (int j=0;j<nc;j++){
+                std::copy_n(A.dense.data()+i0+std::size_t(j0+j)*A.nr,nr,dense.data()+std::size_t(j)*nr);
+            }
+        }
+        else{
+            U.resize(std::size_t(nr)*rank);
+            V.resize(std::size_t(rank)*nc);
+            for (int l=0;l<rank;l++){
+                std::copy_n(A.U.data()+i0+std::size_t(l)*A.nr,nr,U.data()+std::size_t(l)*nr);
+            }
+            std::copy_n(A.V.data()+std::size_t(j0)*rank,std::size_t(rank)*nc,V.data());
+        }
+    }
+
+    HBlock& operator=(const HBlock&) = delete;
+
+    // Transpose of a dense or low-rank block
+    HBlock* transpose() const {
+        HBlock* block = new HBlock(kind,nc,nr,offset_j,offset_i);
+        if (kind==Kind::Dense){
+            transpose(nr,nc,dense.data(),block->dense);
+        }
+        else{
+            block->rank = rank;
+            transpose(rank,nc,V.data(),block->U);
+            transpose(nr,rank,U.data(),block->V);
+        }
+        return block;
+    }
+
+    // Hierarchy of the block (t,s) built from leaves covering it, which are dense or low-rank blocks of any size made of
+    // clusters of the same trees. Blocks in one leaf are restrictions of it, except diagonal blocks which are split
+    // until their cluster is a leaf; if lower, only the lower part of diagonal blocks is built
+    template<typename ClusterImpl>
+    static HBlock* build(const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<const HBlock*>& leaves, bool lower=false){
+        std::vector<const HBlock*> intersecting;
+        for (const HBlock* leaf : leaves){
+            if (leaf->offset_i<t.get_offset()+t.get_size() && t.get_offset()<leaf->offset_i+leaf->nr && leaf->offset_j<s.get_offset()+s.get_size() && s.get_offset()<leaf->offset_j+leaf->nc){
+                intersecting.push_back(leaf);
+            }
+        }
+        bool diagonal = (t.get_offset()==s.get_offset() && t.get_size()==s.get_size());
+        if (intersecting.size()==1 && !(diagonal && !t.IsLeaf())){
+            const HBlock& leaf = *(intersecting[0]);
+            if (leaf.offset_i<=t.get_offset() && t.get_offset()+t.get_size()<=leaf.offset_i+leaf.nr && leaf.offset_j<=s.get_offset() && s.get_offset()+s.get_size()<=leaf.offset_j+leaf.nc){
+                return new HBlock(leaf,t.get_size(),s.get_size(),t.get_offset(),s.get_offset());
+            }
+        }
+        if (intersecting.empty()){
+            return new HBlock(Kind::LowRank,t.get_size(),s.get_size(),t.get_offset(),s.get_offset());
+        }
+        if (t.IsLeaf() && s.IsLeaf()){
+            HBlock* block = new HBlock(Kind::Dense,t.get_size(),s.get_size(),t.get_offset(),s.get_offset());
+            for (const HBlock* leaf : intersecting){
+                int i0 = std::max(leaf->offset_i,block->offset_i);
+                int j0 = std::max(leaf->offset_j,block->offset_j);
+                int i1 = std::min(leaf->offset_i+leaf->nr,block->offset_i+block->nr);
+                int j1 = std::min(leaf->offset_j+leaf->nc,block->offset_j+block->nc);
+                HBlock(*leaf,i1-i0,j1-j0,i0,j0).add_to_dense(block->dense.data()+(i0-block->offset_i)+std::size_t(j0-block->offset_j)*block->nr,block->nr);
+            }
+            return block;
+        }
+
+        int nb_row_sons = t.IsLeaf() ? 1 : t.get_nb_sons();
+        int nb_col_sons = s.IsLeaf() ? 1 : s.get_nb_sons();
+        HBlock* block = new HBlock(t.get_size(),s.get_size(),t.get_offset(),s.get_offset(),nb_row_sons,nb_col_sons);
+        for (int p=0;p<nb_row_sons;p++){
+            for (int q=0;q<nb_col_sons;q++){
+                if (!(lower && diagonal && p<q)){
+                    block->set_son(p,q,build(t.IsLeaf() ? t : t.get_son(p),s.IsLeaf() ? s : s.get_son(q),intersecting,lower && diagonal && p==q));
+                }
+            }
+        }
+        return block;
+    }
+
+    // Getters
+    int nb_rows() const {return nr;}
+    int nb_cols() const {return nc;}
+    int get_offset_i() const {return offset_i;}
+    int get_offset_j() const {return offset_j;}
+    Kind get_kind() const {return kind;}
+    int rank_of() const {return rank;}
+    const T* get_dense() const {return dense.data();}
+    const T* get_U() const {return U.data();}
+    const T* get_V() const {return V.data();}
+    int get_nb_row_sons() const {return nb_row_sons;}
+    int get_nb_col_sons() const {return nb_col_sons;}
+    const HBlock* get_son(int p, int q) const {return sons[p*nb_col_sons+q].get();}
+    HBlock* get_son(int p, int q) {return sons[p*nb_col_sons+q].get();}
+    void set_son(int p, int q, HBlock* son) {sons[p*nb_col_sons+q].reset(son);}
+
+    // Restriction of the block to the rows [offset_i0,offset_i0+nr0) and the columns [offset_j0,offset_j0+nc0), with its hierarchy
+    HBlock* restriction(int nr0, int nc0, int offset_i0, int offset_j0) const {
+        if (kind!=Kind::Subdivided){
+            return new HBlock(*this,nr0,nc0,offset_i0,offset_j0);
+        }
+        if (nr0==nr && nc0==nc){
+            return new HBlock(*this);
+        }
+
+        // Sons intersecting the restriction, the ranges of their rows and columns being the ones of the first son of each row and column
+        std::vector<int> row_sons, col_sons;
+        for (int p=0;p<nb_row_sons;p++){
+            const HBlock* son = nullptr;
+            for (int q=0;q<nb_col_sons && !son;q++){
+                son = get_son(p,q);
+            }
+            if (son && son->offset_i<offset_i0+nr0 && offset_i0<son->offset_i+son->nr){
+                row_sons.push_back(p);
+            }
+        }
+        for (int q=0;q<nb_col_sons;q++){
+            const HBlock* son = nullptr;
+            for (int p=0;p<nb_row_sons && !son;p++){
+                son = get_son(p,q);
+            }
+            if (son && son->offset_j<offset_j0+nc0 && offset_j0<son->offset_j+son->nc){
+                col_sons.push_back(q);
+            }
+        }
+
+        HBlock* block = new HBlock(nr0,nc0,offset_i0,offset_j0,row_sons.size(),col_sons.size());
+        for (int p=0;p<row_sons.size();p++){
+            for (int q=0;q<col_sons.size();q++){
+                const HBlock* son = get_son(row_sons[p],col_sons[q]);
+                if (son){
+                    int i0 = std::max(son->offset_i,offset_i0);
+                    int j0 = std::max(son->offset_j,offset_j0);
+                    int i1 = std::min(son->offset_i+son->nr,offset_i0+nr0);
+                    int j1 = std::min(son->offset_j+son->nc,offset_j0+nc0);
+                    block->set_son(p,q,son->restriction(i1-i0,j1-j0,i0,j0));
+                }
+            }
+        }
+        return block;
+    }
+
+    // Number of stored coefficients
+    std::size_t size() const {
+        std::size_t res = dense.size()+U.size()+V.size();
+        for (int b=0;b<sons.size();b++){
+            if (sons[b]){
+                res += sons[b]->size();
+            }
+        }
+        return res;
+    }
+
+    // out += A, out being nr x nc with leading dimension ld
+    void add_to_dense(T* const out, int ld) const {
+        if (kind==Kind::Dense){
+            for (int j=0;j<nc;j++){
+                for (int i=0;i<nr;i++){
+                    out[i+std::size_t(j)*ld] += dense[i+std::size_t(j)*nr];
+                }
+            }
+        }
+        else if (kind==Kind::LowRank){
+            if (rank>0){
+                T one = 1;
+                Blas<T>::gemm("N","N",&nr,&nc,&rank,&one,U.data(),&nr,V.data(),&rank,&one,out,&ld);
+            }
+        }
+        else{
+            for (int p=0;p<nb_row_sons;p++){
+                for (int q=0;q<nb_col_sons;q++){
+                    const HBlock* son = get_son(p,q);
+                    if (son){
+                        son->add_to_dense(out+(son->offset_i-offset_i)+std::size_t(son->offset_j-offset_j)*ld,ld);
+                    }
+                }
+            }
+        }
+    }
+
+    // Y += alpha op(A) X, with op(A)=A if op='N' and A^H if op='C', X having mu columns
+    void add_mult(char op, const T& alpha, const T* const X, int ldx, T* const Y, int ldy, int mu) const {
+        if (mu==0){
+            return;
+        }
+        T one = 1, zero = 0;
+        if (kind==Kind::Dense){
+            int m = (op=='N') ? nr : nc;
+            int k = (op=='N') ? nc : nr;
+            Blas<T>::gemm(&op,"N",&m,&mu,&k,&alpha,dense.data(),&nr,X,&ldx,&one,Y,&ldy);
+        }
+        else if (kind==Kind::LowRank){
+            if (rank==0){
+                return;
+            }
+            std::vector<T> W(std::size_t(rank)*mu);
+            if (op=='N'){
+                Blas<T>::gemm("N","N",&rank,&mu,&nc,&one,V.data(),&rank,X,&ldx,&zero,W.data(),&rank);
+                Blas<T>::gemm("N","N",&nr,&mu,&rank,&alpha,U.data(),&nr,W.data(),&rank,&one,Y,&ldy);
+            }
+            else{
+                Blas<T>::gemm(&op,"N",&rank,&mu,&nr,&one,U.data(),&nr,X,&ldx,&zero,W.data(),&rank);
+                Blas<T>::gemm(&op,"N",&nc,&mu,&rank,&alpha,V.data(),&rank,W.data(),&rank,&one,Y,&ldy);
+            }
+        }
+        else{
+            for (int b=0;b<sons.size();b++){
+                const HBlock* son = sons[b].get();
+                if (son){
+                    int i0 = son->offset_i-offset_i;
+                    int j0 = son->offset_j-offset_j;
+                    if (op=='N'){
+                        son->add_mult(op,alpha,X+j0,ldx,Y+i0,ldy,mu);
+                    }
+                    else{
+                        son->add_mult(op,alpha,X+i0,ldx,Y+j0,ldy,mu);
+                    }
+                }
+            }
+        }
+    }
+
+    // Y += alpha X op(A), X having m rows
+    void add_mult_right(char op, const T& alpha, const T* const X, int ldx, T* const Y, int ldy, int m) const {
+        if (m==0){
+            return;
+        }
+        T one = 1, zero = 0;
+        if (kind==Kind::Dense){
+            int n = (op=='N') ? nc : nr;
+            int k = (op=='N') ? nr : nc;
+            Blas<T>::gemm("N",&op,&m,&n,&k,&alpha,X,&ldx,dense.data(),&nr,&one,Y,&ldy);
+        }
+        else if (kind==Kind::LowRank){
+            if (rank==0){
+                return;
+            }
+            std::vector<T> W(std::size_t(m)*rank);
+            if (op=='N'){
+                Blas<T>::gemm("N","N",&m,&rank,&nr,&one,X,&ldx,U.data(),&nr,&zero,W.data(),&m);
+                Blas<T>::gemm("N","N",&m,&nc,&rank,&alpha,W.data(),&m,V.data(),&rank,&one,Y,&ldy);
+            }
+            else{
+                Blas<T>::gemm("N",&op,&m,&rank,&nc,&one,X,&ldx,V.data(),&rank,&zero,W.data(),&m);
+                Blas<T>::gemm("N",&op,&m,&nr,&rank,&alpha,W.data(),&m,U.data(),&nr,&one,Y,&ldy);
+            }
+        }
+        else{
+            for (int b=0;b<sons.size();b++){
+                const HBlock* son = sons[b].get();
+                if (son){
+                    std::size_t i0 = son->offset_i-offset_i;
+                    std::size_t j0 = son->offset_j-offset_j;
+                    if (op=='N'){
+                        son->add_mult_right(op,alpha,X+i0*ldx,ldx,Y+j0*ldy,ldy,m);
+                    }
+                    else{
+                        son->add_mult_right(op,alpha,X+j0*ldx,ldx,Y+i0*ldy,ldy,m);
+                    }
+                }
+            }
+        }
+    }
+
+    // A += alpha B, B having the same rows and columns; where their subdivisions differ, B is converted
+    void add(const T& alpha, const HBlock& B, double epsilon){
+        if (B.kind==Kind::LowRank){
+            add_lowrank(alpha,B.rank,B.U.data(),B.nr,B.V.data(),B.rank,epsilon);
+        }
+        else if (B.kind==Kind::Dense){
+            add_dense(alpha,B.dense.data(),B.nr,epsilon);
+        }
+        else if (kind==Kind::Subdivided && nb_row_sons==B.nb_row_sons && nb_col_sons==B.nb_col_sons){
+            for (int b=0;b<sons.size();b++){
+                if (sons[b] && B.sons[b]){
+                    sons[b]->add(alpha,*(B.sons[b]),epsilon);
+                }
+            }
+        }
+        else if (kind==Kind::LowRank){
+            int k;
+            std::vector<T> Ub, Vb;
+            B.get_lowrank(k,Ub,Vb,epsilon);
+            add_lowrank(alpha,k,Ub.data(),nr,Vb.data(),k,epsilon);
+        }
+        else{
+            std::vector<T> W(std::size_t(nr)*nc,0);
+            B.add_to_dense(W.data(),nr);
+            add_dense(alpha,W.data(),nr,epsilon);
+        }
+    }
+
+    // A += alpha Ua*Va, Ua being nr x k and Va k x nc
+    void add_lowrank(const T& alpha, int k, const T* const Ua, int ldu, const T* const Va, int ldv, double epsilon){
+        if (k==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            T one = 1;
+            Blas<T>::gemm("N","N",&nr,&nc,&k,&alpha,Ua,&ldu,Va,&ldv,&one,dense.data(),&nr);
+        }
+        else if (kind==Kind::LowRank){
+            int new_rank = rank+k;
+            std::vector<T> new_U(std::size_t(nr)*new_rank), new_V(std::size_t(new_rank)*nc);
+            std::copy(U.begin(),U.end(),new_U.begin());
+            for (int l=0;l<k;l++){
+                for (int i=0;i<nr;i++){
+                    new_U[i+std::size_t(rank+l)*nr] = alpha*Ua[i+std::size_t(l)*ldu];
+                }
+            }
+            for (int j=0;j<nc;j++){
+                std::copy_n(V.data()+std::size_t(j)*rank,rank,new_V.data()+std::size_t(j)*new_rank);
+                std::copy_n(Va+std::size_t(j)*ldv,k,new_V.data()+std::size_t(j)*new_rank+rank);
+            }
+            truncate(nr,nc,new_rank,new_U,new_V,epsilon);
+            rank = new_rank;
+            U.swap(new_U);
+            V.swap(new_V);
+        }
+        else{
+            for (int b=0;b<sons.size();b++){
+                HBlock* son = sons[b].get();
+                if (son){
+                    son->add_lowrank(alpha,k,Ua+(son->offset_i-offset_i),ldu,Va+std::size_t(son->offset_j-offset_j)*ldv,ldv,epsilon);
+                }
+            }
+        }
+    }
+
+    // A += alpha D, D being nr x nc
+    void add_dense(const T& alpha, const T* const D, int ld, double epsilon){
+        if (kind==Kind::Dense){
+            for (int j=0;j<nc;j++){
+                for (int i=0;i<nr;i++){
+                    dense[i+std::size_t(j)*nr] += alpha*D[i+std::size_t(j)*ld];
+                }
+            }
+        }
+        else if (kind==Kind::LowRank){
+            std::vector<T> W(std::size_t(nr)*nc);
+            for (int j=0;j<nc;j++){
+                for (int i=0;i<nr;i++){
+                    W[i+std::size_t(j)*nr] = alpha*D[i+std::size_t(j)*ld];
+                }
+            }
+            add_to_dense(W.data(),nr);
+            compress(nr,nc,W,rank,U,V,epsilon);
+        }
+        else{
+            for (int b=0;b<sons.size();b++){
+                HBlock* son = sons[b].get();
+                if (son){
+                    son->add_dense(alpha,D+(son->offset_i-offset_i)+std::size_t(son->offset_j-offset_j)*ld,ld,epsilon);
+                }
+            }
+        }
+    }
+
+    // Low-rank approximation of the block, truncated at epsilon
+    void get_lowrank(int& k, std::vector<T>& Ua, std::vector<T>& Va, double epsilon) const {
+        if (kind==Kind::LowRank){
+            k  = rank;
+            Ua = U;
+            Va = V;
+        }
+        else if (kind==Kind::Dense){
+            std::vector<T> W(dense);
+            compress(nr,nc,W,k,Ua,Va,epsilon);
+        }
+        else{
+            // Low-rank approximations of the sons put side by side, and truncated
+            std::vector<int> son_ranks(sons.size(),0);
+            std::vector<std::vector<T>> son_U(sons.size()), son_V(sons.size());
+            k = 0;
+            for (int b=0;b<sons.size();b++){
+                if (sons[b]){
+                    sons[b]->get_lowrank(son_ranks[b],son_U[b],son_V[b],epsilon);
+                    k += son_ranks[b];
+                }
+            }
+            Ua.assign(std::size_t(nr)*k,0);
+            Va.assign(std::size_t(k)*nc,0);
+            int l = 0;
+            for (int b=0;b<sons.size();b++){
+                if (sons[b]){
+                    const HBlock& son = *(sons[b]);
+                    int i0 = son.offset_i-offset_i;
+                    int j0 = son.offset_j-offset_j;
+                    for (int r=0;r<son_ranks[b];r++){
+                        std::copy_n(son_U[b].data()+std::size_t(r)*son.nr,son.nr,Ua.data()+i0+std::size_t(l+r)*nr);
+                        for (int j=0;j<son.nc;j++){
+                            Va[l+r+std::size_t(j0+j)*k] = son_V[b][r+std::size_t(j)*son_ranks[b]];
+                        }
+                    }
+                    l += son_ranks[b];
+                }
+            }
+            truncate(nr,nc,k,Ua,Va,epsilon);
+        }
+    }
+
+    // A += alpha B op(C), with op(C)=C if opC='N' and C^H if opC='C'; sons of B and C must be consistent with A
+    void add_product(const T& alpha, const HBlock& B, const HBlock& C, char opC, double epsilon){
+        int inner = B.nc;
+        T one = 1;
+        if (B.kind==Kind::LowRank){
+            // (U_B (V_B op(C))
+            if (B.rank==0){
+                return;
+            }
+            std::vector<T> W(std::size_t(B.rank)*nc,0);
+            C.add_mult_right(opC,one,B.V.data(),B.rank,W.data(),B.rank,B.rank);
+            add_lowrank(alpha,B.rank,B.U.data(),B.nr,W.data(),B.rank,epsilon);
+        }
+        else if (C.kind==Kind::LowRank){
+            // (B U_C) V_C, or (B V_C^H) U_C^H
+            if (C.rank==0){
+                return;
+            }
+            int k = C.rank;
+            std::vector<T> W(std::size_t(nr)*k,0), Uc, Vc;
+            if (opC=='N'){
+                B.add_mult('N',one,C.U.data(),inner,W.data(),nr,k);
+                add_lowrank(alpha,k,W.data(),nr,C.V.data(),k,epsilon);
+            }
+            else{
+                conj_transpose(k,inner,C.V.data(),Uc);
+                conj_transpose(nc,k,C.U.data(),Vc);
+                B.add_mult('N',one,Uc.data(),inner,W.data(),nr,k);
+                add_lowrank(alpha,k,W.data(),nr,Vc.data(),k,epsilon);
+            }
+        }
+        else if (B.kind==Kind::Dense){
+            std::vector<T> W(std::size_t(nr)*nc,0);
+            C.add_mult_right(opC,one,B.dense.data(),B.nr,W.data(),nr,nr);
+            add_dense(alpha,W.data(),nr,epsilon);
+        }
+        else if (C.kind==Kind::Dense){
+            std::vector<T> W(std::size_t(nr)*nc,0), Cd;
+            if (opC=='N'){
+                B.add_mult('N',one,C.dense.data(),inner,W.data(),nr,nc);
+            }
+            else{
+                conj_transpose(nc,inner,C.dense.data(),Cd);
+                B.add_mult('N',one,Cd.data(),inner,W.data(),nr,nc);
+            }
+            add_dense(alpha,W.data(),nr,epsilon);
+        }
+        else{
+            int nb_inner_sons = B.nb_col_sons;
+            int C_nb_col_sons = (opC=='N') ? C.nb_col_sons : C.nb_row_sons;
+            auto C_son = [&C,opC](int k, int q){return (opC=='N') ? C.get_son(k,q) : C.get_son(q,k);};
+            if (kind==Kind::Subdivided){
+                assert(nb_row_sons==B.nb_row_sons && nb_col_sons==C_nb_col_sons);
+                for (int p=0;p<nb_row_sons;p++){
+                    for (int q=0;q<nb_col_sons;q++){
+                        HBlock* son = get_son(p,q);
+                        if (son){
+                            for (int k=0;k<nb_inner_sons;k++){
+                                son->add_product(alpha,*(B.get_son(p,k)),*(C_son(k,q)),opC,epsilon);
+                            }
+                        }
+                    }
+                }
+            }
+            else{
+                // Product computed in a block subdivided like B op(C), and converted
+                HBlock S(nr,nc,offset_i,offset_j,B.nb_row_sons,C_nb_col_sons);
+                for (int p=0;p<B.nb_row_sons;p++){
+                    for (int q=0;q<C_nb_col_sons;q++){
+                        const HBlock& B_p = *(B.get_son(p,0));
+                        const HBlock& C_q = *(C_son(0,q));
+                        int son_nc = (opC=='N') ? C_q.nc : C_q.nr;
+                        int son_offset_j = (opC=='N') ? C_q.offset_j : C_q.offset_i;
+                        S.set_son(p,q,new HBlock(kind,B_p.nr,son_nc,B_p.offset_i,son_offset_j));
+                    }
+                }
+                S.add_product(alpha,B,C,opC,epsilon);
+                if (kind==Kind::Dense){
+                    S.add_to_dense(dense.data(),nr);
+                }
+                else{
+                    int k;
+                    std::vector<T> Us, Vs;
+                    S.get_lowrank(k,Us,Vs,epsilon);
+                    add_lowrank(one,k,Us.data(),nr,Vs.data(),k,epsilon);
+                }
+            }
+        }
+    }
+
+    // A = alpha A
+    void scale(const T& alpha){
+        for (T& a : dense){
+            a *= alpha;
+        }
+        for (T& v : V){
+            v *= alpha;
+        }
+        for (int b=0;b<sons.size();b++){
+            if (sons[b]){
+                sons[b]->scale(alpha);
+            }
+        }
+    }
+
+    // A = A D, with D diagonal
+    void scale_columns(const T* const d){
+        if (kind==Kind::Dense){
+            for (int j=0;j<nc;j++){
+                for (int i=0;i<nr;i++){
+                    dense[i+std::size_t(j)*nr] *= d[j];
+                }
+            }
+        }
+        else if (kind==Kind::LowRank){
+            for (int j=0;j<nc;j++){
+                for (int l=0;l<rank;l++){
+                    V[l+std::size_t(j)*rank] *= d[j];
+                }
+            }
+        }
+        else{
+            for (int b=0;b<sons.size();b++){
+                if (sons[b]){
+                    sons[b]->scale_columns(d+(sons[b]->offset_j-offset_j));
+                }
+            }
+        }
+    }
+
+    //// Factorizations of diagonal blocks, in place, the sons of subdivided blocks being square
+
+    // A = P L U, with L unit lower triangular and P row interchanges inside dense diagonal blocks
+    void lu(double epsilon){
+        if (kind==Kind::Dense){
+            pivots.resize(nr);
+            int info;
+            Lapack<T>::getrf(&nr,&nr,dense.data(),&nr,pivots.data(),&info);
+            if (info>0){
+                std::cerr << "Singular pivot in the LU factorization of a diagonal block"<<std::endl;
+            }
+        }
+        else if (kind==Kind::Subdivided){
+            int n = nb_row_sons;
+            for (int i=0;i<n;i++){
+                HBlock& A_ii = *(get_son(i,i));
+                A_ii.lu(epsilon);
+                for (int j=i+1;j<n;j++){
+                    A_ii.solve_L(*(get_son(i,j)),epsilon);
+                    A_ii.solve_U_right(*(get_son(j,i)),epsilon);
+                }
+                for (int j=i+1;j<n;j++){
+                    for (int k=i+1;k<n;k++){
+                        get_son(j,k)->add_product(-1,*(get_son(j,i)),*(get_son(i,k)),'N',epsilon);
+                    }
+                }
+            }
+        }
+    }
+
+    // A = L D L^H, with L unit lower triangular and D diagonal, without pivoting, A being stored by its lower part
+    void ldlt(double epsilon){
+        if (kind==Kind::Dense){
+            std::vector<T> w(nr);
+            for (int k=0;k<nr;k++){
+                T* a = dense.data();
+                for (int p=0;p<k;p++){
+                    w[p] = conjugate(a[k+std::size_t(p)*nr])*a[p+std::size_t(p)*nr];
+                }
+                for (int p=0;p<k;p++){
+                    a[k+std::size_t(k)*nr] -= a[k+std::size_t(p)*nr]*w[p];
+                }
+                if (a[k+std::size_t(k)*nr]==T(0)){
+                    std::cerr << "Singular pivot in the LDLh factorization of a diagonal block"<<std::endl;
+                }
+                for (int i=k+1;i<nr;i++){
+                    for (int p=0;p<k;p++){
+                        a[i+std::size_t(k)*nr] -= a[i+std::size_t(p)*nr]*w[p];
+                    }
+                    a[i+std::size_t(k)*nr] /= a[k+std::size_t(k)*nr];
+                }
+            }
+        }
+        else if (kind==Kind::Subdivided){
+            int n = nb_row_sons;
+            for (int i=0;i<n;i++){
+                HBlock& A_ii = *(get_son(i,i));
+                A_ii.ldlt(epsilon);
+                std::vector<T> d_inv(A_ii.nr);
+                A_ii.get_diagonal(d_inv.data());
+                std::transform(d_inv.begin(),d_inv.end(),d_inv.begin(),[](const T& a){return T(1)/a;});
+
+                // A_ji L_ii^-H = L_ji D_i is kept for the updates, and then scaled
+                std::vector<std::unique_ptr<HBlock>> L(n);
+                for (int j=i+1;j<n;j++){
+                    A_ii.solve_LH_right(*(get_son(j,i)),epsilon);
+                    L[j].reset(new HBlock(*(get_son(j,i))));
+                    L[j]->scale_columns(d_inv.data());
+                }
+                for (int j=i+1;j<n;j++){
+                    for (int k=i+1;k<=j;k++){
+                        get_son(j,k)->add_product(-1,*(get_son(j,i)),*(L[k]),'C',epsilon);
+                    }
+                }
+                for (int j=i+1;j<n;j++){
+                    sons[j*nb_col_sons+i] = std::move(L[j]);
+                }
+            }
+        }
+    }
+
+    // Diagonal of D after ldlt
+    void get_diagonal(T* const d) const {
+        if (kind==Kind::Dense){
+            for (int i=0;i<nr;i++){
+                d[i] = dense[i+std::size_t(i)*nr];
+            }
+        }
+        else{
+            for (int p=0;p<nb_row_sons;p++){
+                get_son(p,p)->get_diagonal(d+(get_son(p,p)->offset_i-offset_i));
+            }
+        }
+    }
+
+    //// Triangular solves with a factorized diagonal block, for m right-hand sides X (nr x m) or m left-hand sides X (m x nr)
+
+    // X = L^-1 P^T X
+    void solve_L(T* const X, int ldx, int m) const {
+        if (m==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            for (int i=0;i<pivots.size();i++){
+                if (pivots[i]-1!=i){
+                    for (int j=0;j<m;j++){
+                        std::swap(X[i+std::size_t(j)*ldx],X[pivots[i]-1+std::size_t(j)*ldx]);
+                    }
+                }
+            }
+            T one = 1;
+            Blas<T>::trsm("L","L","N","U",&nr,&m,&one,dense.data(),&nr,X,&ldx);
+        }
+        else{
+            for (int p=0;p<nb_row_sons;p++){
+                int i0 = get_son(p,p)->offset_i-offset_i;
+                for (int q=0;q<p;q++){
+                    get_son(p,q)->add_mult('N',-1,X+(get_son(q,q)->offset_i-offset_i),ldx,X+i0,ldx,m);
+                }
+                get_son(p,p)->solve_L(X+i0,ldx,m);
+            }
+        }
+    }
+
+    // X = U^-1 X
+    void solve_U(T* const X, int ldx, int m) const {
+        if (m==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            T one = 1;
+            Blas<T>::trsm("L","U","N","N",&nr,&m,&one,dense.data(),&nr,X,&ldx);
+        }
+        else{
+            for (int p=nb_row_sons-1;p>=0;p--){
+                int i0 = get_son(p,p)->offset_i-offset_i;
+                for (int q=p+1;q<nb_col_sons;q++){
+                    get_son(p,q)->add_mult('N',-1,X+(get_son(q,q)->offset_i-offset_i),ldx,X+i0,ldx,m);
+                }
+                get_son(p,p)->solve_U(X+i0,ldx,m);
+            }
+        }
+    }
+
+    // X = X U^-1
+    void solve_U_right(T* const X, int ldx, int m) const {
+        if (m==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            T one = 1;
+            Blas<T>::trsm("R","U","N","N",&m,&nr,&one,dense.data(),&nr,X,&ldx);
+        }
+        else{
+            for (int q=0;q<nb_col_sons;q++){
+                std::size_t j0 = get_son(q,q)->offset_j-offset_j;
+                for (int p=0;p<q;p++){
+                    get_son(p,q)->add_mult_right('N',-1,X+std::size_t(get_son(p,p)->offset_i-offset_i)*ldx,ldx,X+j0*ldx,ldx,m);
+                }
+                get_son(q,q)->solve_U_right(X+j0*ldx,ldx,m);
+            }
+        }
+    }
+
+    // X = L^-H X
+    void solve_LH(T* const X, int ldx, int m) const {
+        if (m==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            T one = 1;
+            Blas<T>::trsm("L","L","C","U",&nr,&m,&one,dense.data(),&nr,X,&ldx);
+        }
+        else{
+            for (int p=nb_row_sons-1;p>=0;p--){
+                int i0 = get_son(p,p)->offset_i-offset_i;
+                for (int q=p+1;q<nb_row_sons;q++){
+                    get_son(q,p)->add_mult('C',-1,X+(get_son(q,q)->offset_i-offset_i),ldx,X+i0,ldx,m);
+                }
+                get_son(p,p)->solve_LH(X+i0,ldx,m);
+            }
+        }
+    }
+
+    // X = X L^-H
+    void solve_LH_right(T* const X, int ldx, int m) const {
+        if (m==0){
+            return;
+        }
+        if (kind==Kind::Dense){
+            T one = 1;
+            Blas<T>::trsm("R","L","C","U",&m,&nr,&one,dense.data(),&nr,X,&ldx);
+        }
+        else{
+            for (int q=0;q<nb_col_sons;q++){
+                std::size_t j0 = get_son(q,q)->offset_j-offset_j;
+                for (int p=0;p<q;p++){
+                    get_son(q,p)->add_mult_right('C',-1,X+std::size_t(get_son(p,p)->offset_j-offset_j)*ldx,ldx,X+j0*ldx,ldx,m);
+                }
+                get_son(q,q)->solve_LH_right(X+j0*ldx,ldx,m);
+            }
+        }
+    }
+
+    // X = D^-1 X
+    void solve_D(T* const X, int ldx, int m) const {
+        std::vector<T> d(nr);
+        get_diagonal(d.data());
+        for (int j=0;j<m;j++){
+            for (int i=0;i<nr;i++){
+                X[i+std::size_t(j)*ldx] /= d[i];
+            }
+        }
+    }
+
+    //// Same with blocks, whose sons have the same clusters as the ones of the diagonal block
+
+    // X = L^-1 P^T X
+    void solve_L(HBlock& X, double epsilon) const {
+        if (X.kind==Kind::LowRank){
+            solve_L(X.U.data(),X.nr,X.rank);
+        }
+        else if (X.kind==Kind::Dense){
+            solve_L(X.dense.data(),X.nr,X.nc);
+        }
+        else if (kind==Kind::Dense){
+            for (int b=0;b<X.sons.size();b++){
+                solve_L(*(X.sons[b]),epsilon);
+            }
+        }
+        else{
+            for (int c=0;c<X.nb_col_sons;c++){
+                for (int p=0;p<nb_row_sons;p++){
+                    for (int q=0;q<p;q++){
+                        X.get_son(p,c)->add_product(-1,*(get_son(p,q)),*(X.get_son(q,c)),'N',epsilon);
+                    }
+                    get_son(p,p)->solve_L(*(X.get_son(p,c)),epsilon);
+                }
+            }
+        }
+    }
+
+    // X = X U^-1
+    void solve_U_right(HBlock& X, double epsilon) const {
+        if (X.kind==Kind::LowRank){
+            solve_U_right(X.V.data(),X.rank,X.rank);
+        }
+        else if (X.kind==Kind::Dense){
+            solve_U_right(X.dense.data(),X.nr,X.nr);
+        }
+        else if (kind==Kind::Dense){
+            for (int b=0;b<X.sons.size();b++){
+                solve_U_right(*(X.sons[b]),epsilon);
+            }
+        }
+        else{
+            for (int r=0;r<X.nb_row_sons;r++){
+                for (int q=0;q<nb_col_sons;q++){
+                    for (int p=0;p<q;p++){
+                        X.get_son(r,q)->add_product(-1,*(X.get_son(r,p)),*(get_son(p,q)),'N',epsilon);
+                    }
+                    get_son(q,q)->solve_U_right(*(X.get_son(r,q)),epsilon);
+                }
+            }
+        }
+    }
+
+    // X = X L^-H
+    void solve_LH_right(HBlock& X, double epsilon) const {
+        if (X.kind==Kind::LowRank){
+            solve_LH_right(X.V.data(),X.rank,X.rank);
+        }
+        else if (X.kind==Kind::Dense){
+            solve_LH_right(X.dense.data(),X.nr,X.nr);
+        }
+        else if (kind==Kind::Dense){
+            for (int b=0;b<X.sons.size();b++){
+                solve_LH_right(*(X.sons[b]),epsilon);
+            }
+        }
+        else{
+            for (int r=0;r<X.nb_row_sons;r++){
+                for (int q=0;q<nb_col_sons;q++){
+                    for (int p=0;p<q;p++){
+                        X.get_son(r,q)->add_product(-1,*(X.get_son(r,p)),*(get_son(q,p)),'C',epsilon);
+                    }
+                    get_son(q,q)->solve_LH_right(*(X.get_son(r,q)),epsilon);
+                }
+            }
+        }
+    }
+
+private:
+    template<typename V>
+    static V conjugate(const V& v){return v;}
+    template<typename V>
+    static std::complex<V> conjugate(const std::complex<V>& v){return std::conj(v);}
+
+    // out = in^H, in being m x n
+    static void conj_transpose(int m, int n, const T* const in, std::vector<T>& out){
+        out.resize(std::size_t(m)*n);
+        for (int j=0;j<n;j++){
+            for (int i=0;i<m;i++){
+                out[j+std::size_t(i)*n] = conjugate(in[i+std::size_t(j)*m]);
+            }
+        }
+    }
+
+    // out = in^T, in being m x n
+    static void transpose(int m, int n, const T* const in, std::vector<T>& out){
+        out.resize(std::size_t(m)*n);
+        for (int j=0;j<n;j++){
+            for (int i=0;i<m;i++){
+                out[j+std::size_t(i)*n] = in[i+std::size_t(j)*m];
+            }
+        }
+    }
+
+    // Truncated SVD of the m x n matrix W, which is overwritten: W = Ua*Va with Ua m x k and Va k x n
+    static void compress(int m, int n, std::vector<T>& W, int& k, std::vector<T>& Ua, std::vector<T>& Va, double epsilon){
+        int min_mn = std::min(m,n);
+        std::vector<underlying_type<T>> s(min_mn);
+        std::vector<T> u(std::size_t(m)*min_mn), vt(std::size_t(min_mn)*n);
+        svd_factorization(m,n,W.data(),s.data(),u.data(),vt.data());
+        k = truncated_rank(s,epsilon);
+        Ua.resize(std::size_t(m)*k);
+        Va.resize(std::size_t(k)*n);
+        for (int l=0;l<k;l++){
+            for (int i=0;i<m;i++){
+                Ua[i+std::size_t(l)*m] = u[i+std::size_t(l)*m]*s[l];
+            }
+        }
+        for (int j=0;j<n;j++){
+            std::copy_n(vt.data()+std::size_t(j)*min_mn,k,Va.data()+std::size_t(j)*k);
+        }
+    }
+
+    // Recompression of Ua*Va, with Ua m x k and Va k x n: QR factorizations of Ua and Va^T, and truncated SVD of the product of the R factors
+    static void truncate(int m, int n, int& k, std::vector<T>& Ua, std::vector<T>& Va, double epsilon){
+        if (k==0){
+            return;
+        }
+        if (k>=std::min(m,n)){
+            std::vector<T> W(std::size_t(m)*n,0);
+            T one = 1, zero = 0;
+            Blas<T>::gemm("N","N",&m,&n,&k,&one,Ua.data(),&m,Va.data(),&k,&zero,W.data(),&m);
+            compress(m,n,W,k,Ua,Va,epsilon);
+            return;
+        }
+        std::vector<T> new_U, new_V;
+        int new_rank = recompress_lowrank(m,n,k,Ua.data(),Va.data(),epsilon,new_U,new_V);
+        if (new_rank<k){
+            k = new_rank;
+            Ua.swap(new_U);
+            Va.swap(new_V);
+        }
+    }
+};
+
+}
+
+#endif
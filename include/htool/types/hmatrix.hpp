@@ -6,17 +6,43 @@
 #  include <omp.h>
 #endif
 
+#ifndef HTOOL_MMAP
+# if defined(__unix__) || defined(__APPLE__)
+#  define HTOOL_MMAP 1
+# else
+#  define HTOOL_MMAP 0
+# endif
+#endif
+
+#if HTOOL_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
 #include <cassert>
+#include <cstdint>
 #include <fstream>
+#include <sstream>
 #include <mpi.h>
 #include <map>
+#include <set>
+#include <stack>
+#include <array>
+#include <algorithm>
+#include <numeric>
 #include <memory>
+#include <type_traits>
 #include "matrix.hpp"
+#include "half.hpp"
+#include "hblock.hpp"
 #include "multihmatrix.hpp"
 #include "../misc/parametres.hpp"
 #include "../clustering/cluster.hpp"
 #include "../blocks/blocks.hpp"
 #include "../wrappers/wrapper_mpi.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
 
 
 namespace htool {
@@ -34,6 +60,18 @@ class HMatrix;
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 double Frobenius_absolute_error(const HMatrix<T, LowRankMatrix, ClusterImpl>& B, const IMatrix<T>& A);
 
+// Checkpoint format: header (with epsilon and eta), metadata (cluster trees, infos), block table and
+// block data. The data section starts on a page boundary and every array in it
+// on a HMatrix_checkpoint_alignment boundary, so that it can be mapped in memory.
+const char HMatrix_checkpoint_magic[8] = {'H','T','O','O','L','H','M','T'};
+const int HMatrix_checkpoint_version = 3;
+const std::int64_t HMatrix_checkpoint_page = 4096;
+const std::int64_t HMatrix_checkpoint_alignment = 64;
+
+// Block tree nodes with depth(t)+depth(s) below this value spawn one OpenMP task
+// per son, deeper subtrees are traversed by the task that reached them.
+const int HMatrix_block_tree_task_depth = 8;
+
 // Class
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 class HMatrix: public Parametres{
@@ -46,6 +84,7 @@ private:
 	int local_size;
 	int local_offset;
 
+	// Only the lower part of symmetric matrices (A^T = A, also for complex scalars) is stored
 	bool symmetric;
 
 	std::vector<Block<ClusterImpl>*>		   Tasks;
@@ -64,21 +103,89 @@ private:
 
 	mutable std::map<std::string, std::string> infos;
 
+	// Blocks computed by the tasks executed by each thread, appended to MyNearFieldMats and MyFarFieldMats once all are computed
+	std::vector<std::vector<SubMatrix<T>*>> thread_near_field_mats;
+	std::vector<std::vector<LowRankMatrix<T,ClusterImpl>*>> thread_far_field_mats;
+
+	// Accuracy and admissibility parameters the blocks were computed with, used by arithmetic and saved in checkpoints
+	double epsilon = GetEpsilon();
+	double eta = GetEta();
+
+	// Storage of block data not owned by the blocks themselves (arena, checkpoint buffer or mapping)
+	std::shared_ptr<char> block_data;
+
+	// Workspaces of matrix-vector products, allocated at build time and enlarged if a larger mu is used,
+	// so that products do not allocate (concurrent products with the same HMatrix are not supported)
+	mutable int workspace_mu = 0;
+	mutable std::vector<std::vector<T>> thread_workspaces; // per thread: local_size*mu accumulator (symmetric case only) followed by the largest workspace_size()*mu of low-rank blocks
+	mutable std::vector<T> global_workspace;
+	mutable std::vector<int> recvcounts_workspace, displs_workspace;
+	mutable int transp_workspace_mu = 0;
+	mutable std::vector<std::vector<T>> transp_workspaces; // per thread: nb_cols()*mu accumulator of adjoint products, allocated at the first one
+
+	// Partition of local rows in ranges [row_partition[p],row_partition[p+1]) not cut by any block, balanced with respect to
+	// the cost of the blocks, so that threads write in disjoint parts of the output in products (non symmetric case)
+	mutable std::vector<int> row_partition;
+	mutable std::vector<std::vector<LowRankMatrix<T,ClusterImpl>*>> partition_far;
+	mutable std::vector<std::vector<SubMatrix<T>*>> partition_near;
+
+	// Halo exchange of distributed products: ranges (offset,size) of the input, in the numbering of the cluster trees,
+	// received from and sent to each process, computed once from the column offsets of the local blocks
+	std::vector<std::vector<std::pair<int,int>>> halo_recv, halo_send;
+	mutable std::vector<MPI_Request> halo_requests;
+
+	// Slices [pipeline_slices[s],pipeline_slices[s+1]) of local rows gathered as soon as they are computed in pipelined
+	// products, with the number of rows and the offset of the slices of all processes, which all have the same number of slices
+	std::vector<int> pipeline_slices, pipeline_rows, pipeline_offsets;
+	mutable std::vector<int> pipeline_recvcounts, pipeline_displs;
+	mutable std::vector<MPI_Request> pipeline_requests;
+
+	// Products not reported in infos yet, to avoid string conversions in products
+	mutable int pending_mat_vec_prod = 0;
+	mutable double pending_time_mat_vec_prod = 0;
+
 	MPI_Comm comm;
 	int rankWorld,sizeWorld;
 
 
 	// Internal methods
 	void ScatterTasks();
+	void BalanceTasks();
+	void ExchangeBlocks();
 	Block<ClusterImpl>* BuildBlockTree(const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&);
 	Block<ClusterImpl>* BuildSymBlockTree(const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&);
-	void ComputeBlocks(IMatrix<T>& mat, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs);
-	void ComputeSymBlocks(IMatrix<T>& mat, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs);
-	bool UpdateBlocks(IMatrix<T>&mat ,const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<SubMatrix<T>*>&, std::vector<LowRankMatrix<T,ClusterImpl>*>&);
-	bool UpdateSymBlocks(IMatrix<T>&mat ,const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<SubMatrix<T>*>&, std::vector<LowRankMatrix<T,ClusterImpl>*>&);
+	void ComputeBlocks(IMatrix<T>& mat, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs);
+	void ComputeSymBlocks(IMatrix<T>& mat, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs);
+	bool UpdateBlocks(IMatrix<T>&mat ,const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<SubMatrix<T>*>&, std::vector<LowRankMatrix<T,ClusterImpl>*>&);
+	bool UpdateSymBlocks(IMatrix<T>&mat ,const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<SubMatrix<T>*>&, std::vector<LowRankMatrix<T,ClusterImpl>*>&);
+	bool UpdateBlocksTask(IMatrix<T>&mat ,const Cluster<ClusterImpl>&, const Cluster<ClusterImpl>&, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs);
+	void ReserveThreadBlocks();
+	void AppendThreadBlocks(const std::vector<SubMatrix<T>*>&, const std::vector<LowRankMatrix<T,ClusterImpl>*>&);
+	void MergeThreadBlocks();
 	void AddNearFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, std::vector<SubMatrix<T>*>&);
-	void AddFarFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<LowRankMatrix<T,ClusterImpl>*>&, const int& reqrank=-1);
+	void AddFarFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<LowRankMatrix<T,ClusterImpl>*>&, const int& reqrank=-1);
+	void SetDiagBlocks();
+	void RecompressBlocks();
+	void CoarsenBlocks();
+	void ReduceBlocksPrecision();
+	void CompressNearFieldBlocks();
+	void PackBlocks();
+	void ReserveWorkspaces(int mu, bool transposed=false) const;
+	std::vector<int> SplitRows(int nb_parts) const;
+	void ComputeRowPartition(int nb_parts) const;
+	void ComputePipelineSlices();
+	void MvprodGlobalPipelined(const T* const in, T* const out, const int& mu) const;
+	void ComputeHaloExchange();
+	void MyMvprodLocal(const T* const in, T* const out, const int& mu, bool local_source, bool halo_source) const;
+	void MyMvprodTranspLocal(const T* const in, T* const out, const int& mu) const;
+	void FlushMvprodInfos() const;
 	void ComputeInfos(const std::vector<double>& mytimes);
+	bool HasWorkingPrecisionBlocks() const;
+	std::vector<std::unique_ptr<HBlock<T>>> GetLeaves(bool lower) const;
+	std::unique_ptr<HBlock<T>> BuildHBlock(const std::vector<std::unique_ptr<HBlock<T>>>& leaves, bool lower) const;
+	void SetBlocks(const HBlock<T>& hblock);
+	template<typename U>
+	static void AllGather(const std::vector<U>& in, std::vector<U>& out, MPI_Datatype type, MPI_Comm comm);
 
 	// Friends
 	template<typename U,template<typename,typename> class MultiLowRankMatrix, typename ClusterImplU > friend class MultiHMatrix; 
@@ -143,6 +250,11 @@ public:
 	// Constructor without tab and with precomputed cluster
 	HMatrix(IMatrix<T>&,  const std::shared_ptr<Cluster<ClusterImpl>>& t, const std::vector<R3>& xt, bool Symmetry=false, const int& reqrank=-1, MPI_Comm comm=MPI_COMM_WORLD); // To be used with one different clusters
 
+	// Constructor from a checkpoint written by save (same number of MPI processes), collective: if the checkpoint
+	// cannot be read by one of the processes, all of them throw a std::string describing the error
+	// if memory_mapped, blocks point directly into the mapped file instead of a private copy
+	HMatrix(const std::string& inputname, MPI_Comm comm=MPI_COMM_WORLD, bool memory_mapped=false);
+
   // Destructor
 	~HMatrix() {
 		for (int i=0; i<Tasks.size(); i++)
@@ -170,6 +282,9 @@ public:
 	int get_sizeworld() const {return sizeWorld;}
 	int get_local_size() const {return local_size;}
 	int get_local_offset() const {return local_offset;}
+	bool is_symmetric() const {return symmetric;}
+	double get_epsilon() const {return epsilon;}
+	double get_eta() const {return eta;}
 
     const Cluster<ClusterImpl>& get_cluster_tree_t() const{return *(cluster_tree_t.get());}
     const Cluster<ClusterImpl>& get_cluster_tree_s() const{return *(cluster_tree_s.get());}
@@ -189,12 +304,13 @@ public:
         const std::vector<LowRankMatrix<T,ClusterImpl>*>& get_MyStrictlyDiagFarFieldMats() const {return MyStrictlyDiagFarFieldMats;}
 
 	// Infos
-	const std::map<std::string, std::string>& get_infos() const {return infos;}
-  std::string get_infos (const std::string& key) const { return infos[key];}
+	const std::map<std::string, std::string>& get_infos() const {FlushMvprodInfos();return infos;}
+  std::string get_infos (const std::string& key) const {FlushMvprodInfos(); return infos[key];}
 	void add_info(const std::string& keyname, const std::string& value) const {infos[keyname]=value;}
 	void print_infos() const;
 	void save_infos(const std::string& outputname, std::ios_base::openmode mode = std::ios_base::app, const std::string& sep = " = ") const;
 	void save_plot(const std::string& outputname) const;
+	void save(const std::string& outputname) const;
 	double compression() const; // 1- !!!
 	friend double Frobenius_absolute_error<T,LowRankMatrix,ClusterImpl>(const HMatrix<T, LowRankMatrix, ClusterImpl>& B, const IMatrix<T>& A);
 
@@ -202,6 +318,8 @@ public:
 	void mvprod_global(const T* const in, T* const out,const int& mu=1) const;
 	void mvprod_local(const T* const in, T* const out, T* const work, const int& mu) const;
 	void mymvprod_local(const T* const in, T* const out, const int& mu) const;
+	void mvprod_transp_global(const T* const in, T* const out, const int& mu=1) const;
+	void mvprod_transp_local(const T* const in, T* const out, T* const work, const int& mu) const;
     void mvprod_subrhs(const T* const in, T* const out, const int& mu, const int& offset, const int& size, const int& local_max_size_j) const;
 	std::vector<T> operator*( const std::vector<T>& x) const;
 	Matrix<T> operator*( const Matrix<T>& x) const;
@@ -218,6 +336,12 @@ public:
     // Convert
     Matrix<T> to_dense() const;
     Matrix<T> to_dense_perm() const;
+    std::unique_ptr<HBlock<T>> to_hblock(bool lower=false) const; // Collective
+
+    // Arithmetic with truncation at epsilon, the blocks keeping their structure (rows and columns in the numbering of the cluster trees)
+    void add(const T& alpha, const HMatrix& B); // this += alpha B, with the same cluster trees
+    void add_lowrank(const T& alpha, int k, const T* const U, const T* const V); // this += alpha U V, U being nb_rows() x k and V k x nb_cols() in the global numbering
+    void add_product(const T& alpha, const HMatrix& A, const HMatrix& B, const T& beta=1); // this = beta this + alpha A B, collective
 
     // Apply Dirichlet condition
     void apply_dirichlet(const std::vector<int>& boundary);
@@ -250,6 +374,10 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat, const std::v
 	// Construction arbre des blocs
 	time = MPI_Wtime();
 	Block<ClusterImpl>* B=nullptr;
+	#if _OPENMP
+	#pragma omp parallel
+	#pragma omp single
+	#endif
 	B = BuildBlockTree(cluster_tree_t->get_root(),cluster_tree_s->get_root());
 	if (B !=nullptr) Tasks.push_back(B);
 	mytimes[1] = MPI_Wtime() - time;
@@ -257,6 +385,9 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat, const std::v
 	// Repartition des blocs sur les processeurs
 	time = MPI_Wtime();
 	ScatterTasks();
+	if (loadbalancing && sizeWorld>1){
+		BalanceTasks();
+	}
 	mytimes[2] = MPI_Wtime() - time;
 
 	// Assemblage des sous-matrices
@@ -328,6 +459,10 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat,const std::ve
 	// Construction arbre des blocs
 	time = MPI_Wtime();
 	Block<ClusterImpl>* B=nullptr;
+	#if _OPENMP
+	#pragma omp parallel
+	#pragma omp single
+	#endif
 	if (!symmetric){
 		B = BuildBlockTree(cluster_tree_t->get_root(),cluster_tree_t->get_root());
 	}
@@ -341,6 +476,9 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat,const std::ve
 	// Repartition des blocs sur les processeurs
 	time = MPI_Wtime();
 	ScatterTasks();
+	if (loadbalancing && sizeWorld>1){
+		BalanceTasks();
+	}
 	mytimes[2] = MPI_Wtime() - time;
 
 	// Assemblage des sous-matrices
@@ -423,6 +561,10 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat, const std::v
 	// Construction arbre des blocs
 	time = MPI_Wtime();
 	Block<ClusterImpl>* B=nullptr;
+	#if _OPENMP
+	#pragma omp parallel
+	#pragma omp single
+	#endif
 	if (!symmetric){
 		B = BuildBlockTree(cluster_tree_t->get_root(),cluster_tree_s->get_root());
 	}
@@ -436,6 +578,9 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::build(IMatrix<T>& mat, const std::v
 	// Repartition des blocs sur les processeurs
 	time = MPI_Wtime();
 	ScatterTasks();
+	if (loadbalancing && sizeWorld>1){
+		BalanceTasks();
+	}
 	mytimes[2] = MPI_Wtime() - time;
 
 	// Assemblage des sous-matrices
@@ -486,6 +631,155 @@ HMatrix<T, LowRankMatrix, ClusterImpl>::HMatrix(IMatrix<T>& mat, const std::shar
 
 
 
+// Constructor from a checkpoint
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+HMatrix<T, LowRankMatrix, ClusterImpl>::HMatrix(const std::string& inputname, MPI_Comm comm0, bool memory_mapped): cluster_tree_s(nullptr), cluster_tree_t(nullptr){
+	MPI_Comm_dup(comm0,&comm);
+	MPI_Comm_size(comm, &sizeWorld);
+	MPI_Comm_rank(comm, &rankWorld);
+
+	// Errors are shared, so that all processes throw together instead of waiting for each other in collectives
+	auto check = [this,&inputname](const std::string& error){
+		int failed = !error.empty();
+		MPI_Allreduce(MPI_IN_PLACE,&failed,1,MPI_INT,MPI_MAX,comm);
+		if (failed){
+			MPI_Comm_free(&comm);
+			throw (error.empty() ? "Checkpoint "+inputname+" cannot be read by another process" : error);
+		}
+	};
+
+	std::string filename = inputname+"_"+NbrToStr(rankWorld)+".bin";
+	std::ifstream in(filename,std::ios::in | std::ios::binary);
+
+	// Header
+	char magic[8];
+	std::vector<int> header(13,0);
+	double parameters[2] = {0,0};
+	std::int64_t data_offset = 0;
+	in.read(magic,8);
+	in.read((char*) header.data(), header.size()*sizeof(int));
+	in.read((char*) parameters, 2*sizeof(double));
+	in.read((char*) (&data_offset), sizeof(std::int64_t));
+	std::string error;
+	if (!in){
+		error = "Cannot read checkpoint file "+filename;
+	}
+	else if (!std::equal(magic,magic+8,HMatrix_checkpoint_magic) || header[0]!=HMatrix_checkpoint_version){
+		error = filename+" is not a checkpoint of a HMatrix or its version is not supported";
+	}
+	else if (header[1]!=sizeof(T) || header[2]!=std::is_floating_point<T>::value){
+		error = "Scalar type of the checkpoint "+filename+" does not match the HMatrix";
+	}
+	else if (header[3]!=sizeWorld){
+		error = "Checkpoint "+filename+" was written with "+NbrToStr(header[3])+" MPI processes, not "+NbrToStr(sizeWorld);
+	}
+	check(error);
+	nr           = header[4];
+	nc           = header[5];
+	reqrank      = header[6];
+	local_size   = header[7];
+	local_offset = header[8];
+	symmetric    = header[9];
+	bool same_cluster_trees = header[10];
+	int nb_near  = header[11];
+	int nb_far   = header[12];
+	epsilon      = parameters[0];
+	eta          = parameters[1];
+
+	// Cluster trees
+	cluster_tree_t = std::make_shared<ClusterImpl>();
+	cluster_tree_t->bytes_to_cluster(in,comm);
+	if (same_cluster_trees){
+		cluster_tree_s = cluster_tree_t;
+	}
+	else{
+		cluster_tree_s = std::make_shared<ClusterImpl>();
+		cluster_tree_s->bytes_to_cluster(in,comm);
+	}
+
+	// Infos
+	int nb_infos = 0;
+	in.read((char*) (&nb_infos), sizeof(int));
+	for (int i=0;i<nb_infos;i++){
+		std::vector<std::string> key_value(2);
+		for (auto& str : key_value){
+			int length = 0;
+			in.read((char*) (&length), sizeof(int));
+			str.resize(length);
+			in.read(&(str[0]), length);
+		}
+		infos[key_value[0]]=key_value[1];
+	}
+
+	// Block table: offset_i, nr, offset_j, nc (and rank, k for low-rank blocks) followed by position of the data in the file
+	std::vector<int> near_table(4*nb_near), far_table(6*nb_far);
+	std::vector<std::int64_t> near_data(nb_near), far_data(2*nb_far);
+	for (int b=0;b<nb_near;b++){
+		in.read((char*) (&(near_table[4*b])), 4*sizeof(int));
+		in.read((char*) (&(near_data[b])), sizeof(std::int64_t));
+	}
+	for (int b=0;b<nb_far;b++){
+		in.read((char*) (&(far_table[6*b])), 6*sizeof(int));
+		in.read((char*) (&(far_data[2*b])), 2*sizeof(std::int64_t));
+	}
+	in.seekg(0,std::ios::end);
+	std::int64_t file_size = in.tellg();
+	std::int64_t data_end  = data_offset;
+	for (int b=0;b<nb_near;b++){
+		data_end = std::max(data_end,near_data[b]+std::int64_t(near_table[4*b+1])*near_table[4*b+3]*std::int64_t(sizeof(T)));
+	}
+	for (int b=0;b<nb_far;b++){
+		data_end = std::max(data_end,far_data[2*b+1]+std::int64_t(far_table[6*b+5])*far_table[6*b+3]*std::int64_t(sizeof(T)));
+	}
+	if (!in || data_end>file_size){
+		error = "Checkpoint file "+filename+" is truncated";
+	}
+
+	// Block data, either mapped (copy-on-write, pages shared with other processes) or read
+	char* data = nullptr;
+	#if HTOOL_MMAP
+	if (memory_mapped){
+		int fd = open(filename.c_str(),O_RDONLY);
+		void* mapping = (fd<0 ? MAP_FAILED : mmap(nullptr,file_size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0));
+		if (fd>=0) close(fd);
+		if (mapping==MAP_FAILED){
+			error = "Cannot map checkpoint file "+filename;
+		}
+		else{
+			std::int64_t length = file_size;
+			block_data = std::shared_ptr<char>(static_cast<char*>(mapping),[length](char* ptr){munmap(ptr,length);});
+			data = block_data.get()+data_offset;
+		}
+	}
+	#endif
+	check(error);
+	if (data==nullptr){
+		block_data = std::shared_ptr<char>(new char[data_end-data_offset],std::default_delete<char[]>());
+		in.seekg(data_offset);
+		in.read(block_data.get(),data_end-data_offset);
+		data = block_data.get();
+	}
+
+	// Blocks
+	for (int b=0;b<nb_near;b++){
+		const int* block = &(near_table[4*b]);
+		SubMatrix<T>* submat = new SubMatrix<T>(cluster_tree_t->get_perm_ptr(),block[0],block[1],cluster_tree_s->get_perm_ptr(),block[2],block[3],block[0],block[2],reinterpret_cast<T*>(data+(near_data[b]-data_offset)));
+		MyNearFieldMats.push_back(submat);
+	}
+	for (int b=0;b<nb_far;b++){
+		const int* block = &(far_table[6*b]);
+		LowRankMatrix<T,ClusterImpl>* lrmat = new LowRankMatrix<T,ClusterImpl>(cluster_tree_t->get_perm_ptr(),block[0],block[1],cluster_tree_s->get_perm_ptr(),block[2],block[3],block[0],block[2]);
+		lrmat->assign(block[4],block[5],reinterpret_cast<T*>(data+(far_data[2*b]-data_offset)),reinterpret_cast<T*>(data+(far_data[2*b+1]-data_offset)));
+		MyFarFieldMats.push_back(lrmat);
+	}
+	SetDiagBlocks();
+	ReserveWorkspaces(1);
+	ComputeHaloExchange();
+	if (pipelinedmvprod && !symmetric){
+		ComputePipelineSlices();
+	}
+}
+
 // Build block tree
 // TODO: recursivity -> stack for buildblocktree
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
@@ -495,6 +789,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 	int bsize = t.get_size()*s.get_size();
 	B->ComputeAdmissibility();
 	if( B->IsAdmissible() && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth() && (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )){
+		#if _OPENMP
+		#pragma omp critical
+		#endif
 		Tasks.push_back(B);
 		return nullptr;
 	}
@@ -505,8 +802,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 		else{
 			std::vector<Block<ClusterImpl>*> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
 				Blocks[p] = BuildBlockTree(t.get_son(p),s);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth() && (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 				for (auto block : Blocks){
@@ -515,6 +818,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 				return B;
 			}
 			else{
+				#if _OPENMP
+				#pragma omp critical
+				#endif
 				for (auto block : Blocks){
 					if (block !=nullptr) Tasks.push_back(block);
 				}
@@ -527,8 +833,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 		if( t.IsLeaf() ){
 			std::vector<Block<ClusterImpl>*> Blocks(s.get_nb_sons());
 			for (int p=0; p <s.get_nb_sons();p++){
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
 				Blocks[p] = BuildBlockTree(t,s.get_son(p));
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth()&& (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 				for (auto block : Blocks){
@@ -537,6 +849,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 				return B;
 			}
 			else{
+				#if _OPENMP
+				#pragma omp critical
+				#endif
 				for (auto block : Blocks){
 					if (block !=nullptr) Tasks.push_back(block);
 				} 
@@ -548,8 +863,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 			if (t.get_size()>s.get_size()){
 				std::vector<Block<ClusterImpl>*> Blocks(t.get_nb_sons());
 				for (int p=0; p <t.get_nb_sons();p++){
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
 					Blocks[p] = BuildBlockTree(t.get_son(p),s);
 				}
+				#if _OPENMP
+				#pragma omp taskwait
+				#endif
 				if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth()&& (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 					for (auto block : Blocks){
 						delete block;
@@ -557,6 +878,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 					return B;
 				}
 				else{
+					#if _OPENMP
+					#pragma omp critical
+					#endif
 					for (auto block : Blocks){
 						if (block !=nullptr) Tasks.push_back(block);
 					} 
@@ -567,8 +891,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 			else{
 				std::vector<Block<ClusterImpl>*> Blocks(s.get_nb_sons());
 				for (int p=0; p <s.get_nb_sons();p++){
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
 					Blocks[p] = BuildBlockTree(t,s.get_son(p));
 				}
+				#if _OPENMP
+				#pragma omp taskwait
+				#endif
 				if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth()&& (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 					for (auto block : Blocks){
 						delete block;
@@ -576,6 +906,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildBlockTree(const
 					return B;
 				}
 				else{
+					#if _OPENMP
+					#pragma omp critical
+					#endif
 					for (auto block : Blocks){
 						if (block !=nullptr) Tasks.push_back(block);
 					} 
@@ -594,6 +927,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 	int bsize = t.get_size()*s.get_size();
 	B->ComputeAdmissibility();
 	if( B->IsAdmissible() && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth() && (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )){
+		#if _OPENMP
+		#pragma omp critical
+		#endif
 		Tasks.push_back(B);
 		return nullptr;
 	}
@@ -604,8 +940,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 		else{
 			std::vector<Block<ClusterImpl>*> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
 				Blocks[p] = BuildSymBlockTree(t.get_son(p),s);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth() && (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 				for (auto block : Blocks){
@@ -614,6 +956,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 				return B;
 			}
 			else{
+				#if _OPENMP
+				#pragma omp critical
+				#endif
 				for (auto block : Blocks){
 					if (block !=nullptr) Tasks.push_back(block);
 				}
@@ -626,8 +971,14 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 		if( t.IsLeaf() ){
 			std::vector<Block<ClusterImpl>*> Blocks(s.get_nb_sons());
 			for (int p=0; p <s.get_nb_sons();p++){
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
 				Blocks[p] = BuildSymBlockTree(t,s.get_son(p));
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth()&& (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 				for (auto block : Blocks){
@@ -636,6 +987,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 				return B;
 			}
 			else{
+				#if _OPENMP
+				#pragma omp critical
+				#endif
 				for (auto block : Blocks){
 					if (block !=nullptr) Tasks.push_back(block);
 				} 
@@ -647,9 +1001,15 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 			std::vector<Block<ClusterImpl>*> Blocks(t.get_nb_sons()*s.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
 				for (int l=0; l <s.get_nb_sons();l++){
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p,l) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
 					Blocks[p+l*t.get_nb_sons()] = BuildSymBlockTree(t.get_son(p),s.get_son(l));
 				}
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](Block<ClusterImpl>* block){return block!=nullptr;} ) && t.get_rank()>=0 && t.get_depth()>=GetMinTargetDepth() && s.get_depth()>=GetMinSourceDepth()&& (!symmetric || (t.get_offset()==s.get_offset() && t.get_size()==s.get_size()) || (t.get_offset()!=s.get_offset() && ( (t.get_offset()<s.get_offset() && s.get_offset()-t.get_offset() >= t.get_size()) || (s.get_offset() < t.get_offset() && t.get_offset() -s.get_offset() >= s.get_size()) )) )) {
 				for (auto block : Blocks){
 					delete block;
@@ -657,6 +1017,9 @@ Block<ClusterImpl>* HMatrix<T, LowRankMatrix, ClusterImpl>::BuildSymBlockTree(co
 				return B;
 			}
 			else{
+				#if _OPENMP
+				#pragma omp critical
+				#endif
 				for (auto block : Blocks){
 					if (block !=nullptr) Tasks.push_back(block);
 				} 
@@ -689,23 +1052,200 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ScatterTasks(){
 
 }
 
+// Redistribute MyBlocks among processes so that their estimated compression
+// costs are balanced. The block tree is the same on every process, so that
+// blocks are numbered following comp_block and only these numbers are exchanged.
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::BalanceTasks(){
+    std::vector<Block<ClusterImpl>*> blocks(Tasks);
+    std::sort(blocks.begin(),blocks.end(),comp_block());
+
+    // Blocks owned by each process
+    std::vector<int> my_blocks(MyBlocks.size());
+    for (int b=0;b<MyBlocks.size();b++){
+        my_blocks[b] = std::lower_bound(blocks.begin(),blocks.end(),MyBlocks[b],comp_block())-blocks.begin();
+    }
+    std::vector<int> counts(sizeWorld), displs(sizeWorld,0);
+    int nb_my_blocks = my_blocks.size();
+    MPI_Allgather(&nb_my_blocks,1,MPI_INT,counts.data(),1,MPI_INT,comm);
+    for (int i=1;i<sizeWorld;i++){
+        displs[i] = displs[i-1]+counts[i-1];
+    }
+    int nb_blocks = displs.back()+counts.back();
+    std::vector<int> all_blocks(nb_blocks), owners(nb_blocks);
+    MPI_Allgatherv(my_blocks.data(),nb_my_blocks,MPI_INT,all_blocks.data(),counts.data(),displs.data(),MPI_INT,comm);
+    for (int i=0;i<sizeWorld;i++){
+        std::fill_n(owners.begin()+displs[i],counts[i],i);
+    }
+
+    // Estimated costs: entries of dense blocks, (nr+nc)*rank for low-rank blocks,
+    // the rank of the approximation being estimated from the required accuracy
+    double expected_rank = (reqrank>0 ? reqrank : std::max(1.,std::log(1./epsilon)));
+    std::vector<double> costs(nb_blocks), loads(sizeWorld,0);
+    for (int i=0;i<nb_blocks;i++){
+        const Block<ClusterImpl>& B = *(blocks[all_blocks[i]]);
+        double nr_block = B.tgt_().get_size(), nc_block = B.src_().get_size();
+        costs[i] = (B.IsAdmissible() ? std::min(expected_rank,std::min(nr_block,nc_block))*(nr_block+nc_block) : nr_block*nc_block);
+        loads[owners[i]] += costs[i];
+    }
+    double target = std::accumulate(loads.begin(),loads.end(),0.)/sizeWorld;
+
+    // Most expensive blocks first, a block leaves an overloaded process for the
+    // least loaded one when it does not overload it. Same result on every process.
+    std::vector<int> order(nb_blocks);
+    std::iota(order.begin(),order.end(),0);
+    std::stable_sort(order.begin(),order.end(),[&costs](int a, int b){return costs[a]>costs[b];});
+    int nb_moved_blocks = 0;
+    for (int i : order){
+        int owner = owners[i];
+        if (loads[owner]<=target) continue;
+        int receiver = std::min_element(loads.begin(),loads.end())-loads.begin();
+        if (loads[receiver]+costs[i]<=target){
+            loads[owner]    -= costs[i];
+            loads[receiver] += costs[i];
+            owners[i] = receiver;
+            nb_moved_blocks++;
+        }
+    }
+
+    // Blocks computed here, still in comp_block order
+    std::vector<int> computed;
+    for (int i=0;i<nb_blocks;i++){
+        if (owners[i]==rankWorld) computed.push_back(all_blocks[i]);
+    }
+    std::sort(computed.begin(),computed.end());
+    MyBlocks.resize(computed.size());
+    for (int b=0;b<computed.size();b++){
+        MyBlocks[b] = blocks[computed[b]];
+    }
+    infos["Number_of_moved_blocks"] = NbrToStr(nb_moved_blocks);
+}
+
+// Send the blocks computed for other processes to the process owning their rows
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ExchangeBlocks(){
+    std::vector<int> local_clusters(2*sizeWorld);
+    int local_cluster[2] = {local_offset,local_size};
+    MPI_Allgather(local_cluster,2,MPI_INT,local_clusters.data(),2,MPI_INT,comm);
+    auto owner = [&](int offset_i){
+        for (int i=0;i<sizeWorld;i++){
+            if (local_clusters[2*i]<=offset_i && offset_i<local_clusters[2*i]+local_clusters[2*i+1]) return i;
+        }
+        return rankWorld;
+    };
+
+    // Each block is described by 7 integers: type (0 dense, 1 low rank), offset_i, nr, offset_j, nc, rank, k
+    // and its data, the entries of a dense block or U then V for a low-rank block
+    std::vector<std::vector<int>> send_tables(sizeWorld);
+    std::vector<std::vector<T>> send_data(sizeWorld);
+    std::vector<SubMatrix<T>*> near_kept;
+    std::vector<LowRankMatrix<T,ClusterImpl>*> far_kept;
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        SubMatrix<T>* submat = MyNearFieldMats[b];
+        int dest = owner(submat->get_offset_i());
+        if (dest==rankWorld){
+            near_kept.push_back(submat);
+            continue;
+        }
+        int block[7] = {0,submat->get_offset_i(),submat->nb_rows(),submat->get_offset_j(),submat->nb_cols(),0,0};
+        send_tables[dest].insert(send_tables[dest].end(),block,block+7);
+        send_data[dest].insert(send_data[dest].end(),submat->data(),submat->data()+std::size_t(submat->nb_rows())*submat->nb_cols());
+        delete submat;
+    }
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        LowRankMatrix<T,ClusterImpl>* lrmat = MyFarFieldMats[b];
+        int dest = owner(lrmat->get_offset_i());
+        if (dest==rankWorld){
+            far_kept.push_back(lrmat);
+            continue;
+        }
+        const Matrix<T>& U = lrmat->get_U();
+        const Matrix<T>& V = lrmat->get_V();
+        int block[7] = {1,lrmat->get_offset_i(),lrmat->nb_rows(),lrmat->get_offset_j(),lrmat->nb_cols(),lrmat->rank_of(),U.nb_cols()};
+        send_tables[dest].insert(send_tables[dest].end(),block,block+7);
+        send_data[dest].insert(send_data[dest].end(),U.data(),U.data()+std::size_t(U.nb_rows())*U.nb_cols());
+        send_data[dest].insert(send_data[dest].end(),V.data(),V.data()+std::size_t(V.nb_rows())*V.nb_cols());
+        delete lrmat;
+    }
+    MyNearFieldMats = near_kept;
+    MyFarFieldMats  = far_kept;
+
+    // Sizes, then tables and data
+    std::vector<int> send_counts(2*sizeWorld), recv_counts(2*sizeWorld);
+    for (int i=0;i<sizeWorld;i++){
+        send_counts[2*i]   = send_tables[i].size();
+        send_counts[2*i+1] = send_data[i].size();
+    }
+    MPI_Alltoall(send_counts.data(),2,MPI_INT,recv_counts.data(),2,MPI_INT,comm);
+
+    std::vector<int> table_send_counts(sizeWorld), table_send_displs(sizeWorld,0), table_recv_counts(sizeWorld), table_recv_displs(sizeWorld,0);
+    std::vector<int> data_send_counts(sizeWorld), data_send_displs(sizeWorld,0), data_recv_counts(sizeWorld), data_recv_displs(sizeWorld,0);
+    for (int i=0;i<sizeWorld;i++){
+        table_send_counts[i] = send_counts[2*i];
+        data_send_counts[i]  = send_counts[2*i+1];
+        table_recv_counts[i] = recv_counts[2*i];
+        data_recv_counts[i]  = recv_counts[2*i+1];
+        if (i>0){
+            table_send_displs[i] = table_send_displs[i-1]+table_send_counts[i-1];
+            data_send_displs[i]  = data_send_displs[i-1]+data_send_counts[i-1];
+            table_recv_displs[i] = table_recv_displs[i-1]+table_recv_counts[i-1];
+            data_recv_displs[i]  = data_recv_displs[i-1]+data_recv_counts[i-1];
+        }
+    }
+    std::vector<int> tables_to_send, tables;
+    std::vector<T> data_to_send;
+    for (int i=0;i<sizeWorld;i++){
+        tables_to_send.insert(tables_to_send.end(),send_tables[i].begin(),send_tables[i].end());
+        data_to_send.insert(data_to_send.end(),send_data[i].begin(),send_data[i].end());
+        std::vector<int>().swap(send_tables[i]);
+        std::vector<T>().swap(send_data[i]);
+    }
+    tables.resize(table_recv_displs.back()+table_recv_counts.back());
+    std::size_t data_size = std::size_t(data_recv_displs.back())+data_recv_counts.back();
+    std::shared_ptr<char> received(new char[std::max(data_size,std::size_t(1))*sizeof(T)],std::default_delete<char[]>());
+    T* data = reinterpret_cast<T*>(received.get());
+    MPI_Alltoallv(tables_to_send.data(),table_send_counts.data(),table_send_displs.data(),MPI_INT,tables.data(),table_recv_counts.data(),table_recv_displs.data(),MPI_INT,comm);
+    MPI_Alltoallv(data_to_send.data(),data_send_counts.data(),data_send_displs.data(),wrapper_mpi<T>::mpi_type(),data,data_recv_counts.data(),data_recv_displs.data(),wrapper_mpi<T>::mpi_type(),comm);
+
+    // Received blocks are views of the receive buffer
+    std::size_t position = 0;
+    for (int b=0;b<tables.size()/7;b++){
+        const int* block = &(tables[7*b]);
+        if (block[0]==0){
+            SubMatrix<T>* submat = new SubMatrix<T>(cluster_tree_t->get_perm_ptr(),block[1],block[2],cluster_tree_s->get_perm_ptr(),block[3],block[4],block[1],block[3],data+position);
+            position += std::size_t(block[2])*block[4];
+            MyNearFieldMats.push_back(submat);
+        }
+        else{
+            LowRankMatrix<T,ClusterImpl>* lrmat = new LowRankMatrix<T,ClusterImpl>(cluster_tree_t->get_perm_ptr(),block[1],block[2],cluster_tree_s->get_perm_ptr(),block[3],block[4],block[1],block[3]);
+            lrmat->assign(block[5],block[6],data+position,data+position+std::size_t(block[2])*block[6]);
+            position += std::size_t(block[2]+block[4])*block[6];
+            MyFarFieldMats.push_back(lrmat);
+        }
+    }
+    if (!tables.empty()){
+        block_data = received;
+    }
+}
+
 // Compute blocks recursively
 // TODO: recursivity -> stack for compute blocks
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
-void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs){
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs){
+    // One task per block, refinements of blocks whose compression failed are
+    // spawned as nested tasks so that idle threads can steal them
+    ReserveThreadBlocks();
     #if _OPENMP
     #pragma omp parallel
+    #pragma omp single
     #endif
-    {
-        // IMatrix<T> mat = mat;
-        std::vector<SubMatrix<T>*>     MyNearFieldMats_local;
-        std::vector<LowRankMatrix<T,ClusterImpl>*> MyFarFieldMats_local;
-        // int tid = omp_get_thread_num();
-        // std::cout<<"Hello World from thread = "+ NbrToStr(tid)<<std::endl;
+    for(int b=0; b<MyBlocks.size(); b++)
         #if _OPENMP
-        #pragma omp for schedule(guided)
+        #pragma omp task default(shared) firstprivate(b)
         #endif
-        for(int b=0; b<MyBlocks.size(); b++) {
+        {
+            std::vector<SubMatrix<T>*>     MyNearFieldMats_local;
+            std::vector<LowRankMatrix<T,ClusterImpl>*> MyFarFieldMats_local;
             const Block<ClusterImpl>& B = *(MyBlocks[b]);
         	const Cluster<ClusterImpl>& t = B.tgt_();
             const Cluster<ClusterImpl>& s = B.src_();
@@ -722,10 +1262,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, cons
             				AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
             			}
             			else{
-							std::vector<bool> Blocks(t.get_nb_sons());
+							std::vector<char> Blocks(t.get_nb_sons());
 							for (int p=0; p <t.get_nb_sons();p++){
-								Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+								#if _OPENMP
+								#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+								#endif
+								Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 							}
+							#if _OPENMP
+							#pragma omp taskwait
+							#endif
 
 							if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 								AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -739,10 +1285,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, cons
             		}
             		else{
             			if( t.IsLeaf() ){
-							std::vector<bool> Blocks(s.get_nb_sons());
+							std::vector<char> Blocks(s.get_nb_sons());
 							for (int p=0; p <s.get_nb_sons();p++){
-								Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+								#if _OPENMP
+								#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+								#endif
+								Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 							}
+							#if _OPENMP
+							#pragma omp taskwait
+							#endif
 
 							if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 								AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -755,10 +1307,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, cons
             			}
             			else{
             				if (t.get_size()>s.get_size()){
-            					std::vector<bool> Blocks(t.get_nb_sons());
+            					std::vector<char> Blocks(t.get_nb_sons());
 								for (int p=0; p <t.get_nb_sons();p++){
-									Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+									#if _OPENMP
+									#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+									#endif
+									Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 								}
+								#if _OPENMP
+								#pragma omp taskwait
+								#endif
 
 								if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 									AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -770,10 +1328,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, cons
 								}
             				}
             				else{
-            					std::vector<bool> Blocks(s.get_nb_sons());
+            					std::vector<char> Blocks(s.get_nb_sons());
 								for (int p=0; p <s.get_nb_sons();p++){
-									Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+									#if _OPENMP
+									#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+									#endif
+									Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 								}
+								#if _OPENMP
+								#pragma omp taskwait
+								#endif
 
 								if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 									AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -792,48 +1356,67 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeBlocks(IMatrix<T>& mat, cons
             	// MyNearFieldMats.emplace_back(mat,I,J);
             	AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
             }
+            AppendThreadBlocks(MyNearFieldMats_local,MyFarFieldMats_local);
         }
-        #if _OPENMP
-        #pragma omp critical
-        #endif
-        {
-            MyFarFieldMats.insert(MyFarFieldMats.end(),MyFarFieldMats_local.begin(),MyFarFieldMats_local.end());
-            MyNearFieldMats.insert(MyNearFieldMats.end(),MyNearFieldMats_local.begin(),MyNearFieldMats_local.end());
-        }
+    MergeThreadBlocks();
+
+    // Truncation of the ranks of low-rank blocks
+    if (recompression){
+        RecompressBlocks();
     }
 
-    // Build vectors of pointers for diagonal blocks
-    for (int i=0;i<MyFarFieldMats.size();i++){
-        if (local_offset<=MyFarFieldMats[i]->get_offset_j() && MyFarFieldMats[i]->get_offset_j()<local_offset+local_size){
-            MyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-            if (MyFarFieldMats[i]->get_offset_j()==MyFarFieldMats[i]->get_offset_i())
-                MyStrictlyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-        }
+    // Blocks computed for other processes are sent to them
+    if (loadbalancing && sizeWorld>1){
+        ExchangeBlocks();
     }
-    for (int i=0;i<MyNearFieldMats.size();i++){
-        if (local_offset<=MyNearFieldMats[i]->get_offset_j() && MyNearFieldMats[i]->get_offset_j()<local_offset+local_size){
-            MyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-            if (MyNearFieldMats[i]->get_offset_j()==MyNearFieldMats[i]->get_offset_i())
-                MyStrictlyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-        }
+
+    // Agglomeration of sibling blocks
+    if (coarsening){
+        CoarsenBlocks();
+    }
+
+    // Low-rank factors in reduced precision
+    if (mixedprecision){
+        ReduceBlocksPrecision();
+    }
+
+    // Dense blocks in reduced precision
+    if (nearfieldcompression){
+        CompressNearFieldBlocks();
+    }
+
+    // Contiguous storage of blocks
+    if (blockarena){
+        PackBlocks();
+    }
+
+    // Build vectors of pointers for diagonal blocks
+    SetDiagBlocks();
+
+    // Workspaces for products
+    ReserveWorkspaces(1);
+    ComputeHaloExchange();
+    if (pipelinedmvprod && !symmetric){
+        ComputePipelineSlices();
     }
 }
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
-void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs){
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs){
+    // One task per block, refinements of blocks whose compression failed are
+    // spawned as nested tasks so that idle threads can steal them
+    ReserveThreadBlocks();
     #if _OPENMP
     #pragma omp parallel
+    #pragma omp single
     #endif
-    {
-        // IMatrix<T> mat = mat;
-        std::vector<SubMatrix<T>*>     MyNearFieldMats_local;
-        std::vector<LowRankMatrix<T,ClusterImpl>*> MyFarFieldMats_local;
-        // int tid = omp_get_thread_num();
-        // std::cout<<"Hello World from thread = "+ NbrToStr(tid)<<std::endl;
+    for(int b=0; b<MyBlocks.size(); b++)
         #if _OPENMP
-        #pragma omp for schedule(guided)
+        #pragma omp task default(shared) firstprivate(b)
         #endif
-        for(int b=0; b<MyBlocks.size(); b++) {
+        {
+            std::vector<SubMatrix<T>*>     MyNearFieldMats_local;
+            std::vector<LowRankMatrix<T,ClusterImpl>*> MyFarFieldMats_local;
             const Block<ClusterImpl>& B = *(MyBlocks[b]);
         	const Cluster<ClusterImpl>& t = B.tgt_();
             const Cluster<ClusterImpl>& s = B.src_();
@@ -850,10 +1433,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, c
             				AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
             			}
             			else{
-							std::vector<bool> Blocks(t.get_nb_sons());
+							std::vector<char> Blocks(t.get_nb_sons());
 							for (int p=0; p <t.get_nb_sons();p++){
-								Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+								#if _OPENMP
+								#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+								#endif
+								Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 							}
+							#if _OPENMP
+							#pragma omp taskwait
+							#endif
 
 							if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 								AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -867,10 +1456,16 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, c
             		}
             		else{
             			if( t.IsLeaf() ){
-							std::vector<bool> Blocks(s.get_nb_sons());
+							std::vector<char> Blocks(s.get_nb_sons());
 							for (int p=0; p <s.get_nb_sons();p++){
-								Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+								#if _OPENMP
+								#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+								#endif
+								Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 							}
+							#if _OPENMP
+							#pragma omp taskwait
+							#endif
 
 							if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 								AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
@@ -882,12 +1477,18 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, c
 							}
             			}
             			else{
-							std::vector<bool> Blocks(t.get_nb_sons()*s.get_nb_sons());
+							std::vector<char> Blocks(t.get_nb_sons()*s.get_nb_sons());
 							for (int p=0; p <t.get_nb_sons();p++){
 								for (int l=0; l <s.get_nb_sons();l++){
-									Blocks[p+l*t.get_nb_sons()] =UpdateBlocks(mat,t.get_son(p),s.get_son(l),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+									#if _OPENMP
+									#pragma omp task default(shared) firstprivate(p,l) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+									#endif
+									Blocks[p+l*t.get_nb_sons()] = UpdateBlocksTask(mat,t.get_son(p),s.get_son(l),xt,tabt,xs,tabs);
 								}
 							}
+							#if _OPENMP
+							#pragma omp taskwait
+							#endif
 							if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 									AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
 							}
@@ -906,35 +1507,53 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeSymBlocks(IMatrix<T>& mat, c
             	// MyNearFieldMats.emplace_back(mat,I,J);
             	AddNearFieldMat(mat,t,s,MyNearFieldMats_local);
             }
+            AppendThreadBlocks(MyNearFieldMats_local,MyFarFieldMats_local);
         }
-        #if _OPENMP
-        #pragma omp critical
-        #endif
-        {
-            MyFarFieldMats.insert(MyFarFieldMats.end(),MyFarFieldMats_local.begin(),MyFarFieldMats_local.end());
-            MyNearFieldMats.insert(MyNearFieldMats.end(),MyNearFieldMats_local.begin(),MyNearFieldMats_local.end());
-        }
+    MergeThreadBlocks();
+
+    // Truncation of the ranks of low-rank blocks
+    if (recompression){
+        RecompressBlocks();
     }
 
-    // Build vectors of pointers for diagonal blocks
-    for (int i=0;i<MyFarFieldMats.size();i++){
-        if (local_offset<=MyFarFieldMats[i]->get_offset_j() && MyFarFieldMats[i]->get_offset_j()<local_offset+local_size){
-            MyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-            if (MyFarFieldMats[i]->get_offset_j()==MyFarFieldMats[i]->get_offset_i())
-                MyStrictlyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-        }
+    // Blocks computed for other processes are sent to them
+    if (loadbalancing && sizeWorld>1){
+        ExchangeBlocks();
     }
-    for (int i=0;i<MyNearFieldMats.size();i++){
-        if (local_offset<=MyNearFieldMats[i]->get_offset_j() && MyNearFieldMats[i]->get_offset_j()<local_offset+local_size){
-            MyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-            if (MyNearFieldMats[i]->get_offset_j()==MyNearFieldMats[i]->get_offset_i())
-                MyStrictlyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-        }
+
+    // Agglomeration of sibling blocks
+    if (coarsening){
+        CoarsenBlocks();
+    }
+
+    // Low-rank factors in reduced precision
+    if (mixedprecision){
+        ReduceBlocksPrecision();
+    }
+
+    // Dense blocks in reduced precision
+    if (nearfieldcompression){
+        CompressNearFieldBlocks();
+    }
+
+    // Contiguous storage of blocks
+    if (blockarena){
+        PackBlocks();
+    }
+
+    // Build vectors of pointers for diagonal blocks
+    SetDiagBlocks();
+
+    // Workspaces for products
+    ReserveWorkspaces(1);
+    ComputeHaloExchange();
+    if (pipelinedmvprod && !symmetric){
+        ComputePipelineSlices();
     }
 }
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
-bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<SubMatrix<T>*>& MyNearFieldMats_local, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local){
+bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<SubMatrix<T>*>& MyNearFieldMats_local, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local){
 	int bsize = t.get_size()*s.get_size();
 	Block<ClusterImpl> B(t,s);
 	B.ComputeAdmissibility();
@@ -954,10 +1573,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const
 			return false;
 		}
 		else{
-			std::vector<bool> Blocks(t.get_nb_sons());
+			std::vector<char> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
-				Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
+				Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 				return false;
@@ -972,10 +1597,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const
 	}
 	else{
 		if( t.IsLeaf() ){
-			std::vector<bool> Blocks(t.get_nb_sons());
+			std::vector<char> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
-				Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
+				Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 				return false;
@@ -990,10 +1621,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const
 		else{
 
 			if (t.get_size()>s.get_size()){
-				std::vector<bool> Blocks(t.get_nb_sons());
+				std::vector<char> Blocks(t.get_nb_sons());
 				for (int p=0; p <t.get_nb_sons();p++){
-					Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
+					Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 				}
+				#if _OPENMP
+				#pragma omp taskwait
+				#endif
 
 				if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 					return false;
@@ -1006,10 +1643,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const
 				}
 			}
 			else{
-				std::vector<bool> Blocks(t.get_nb_sons());
+				std::vector<char> Blocks(t.get_nb_sons());
 				for (int p=0; p <t.get_nb_sons();p++){
-					Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
+					Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 				}
+				#if _OPENMP
+				#pragma omp taskwait
+				#endif
 
 				if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 					return false;
@@ -1026,7 +1669,7 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocks(IMatrix<T>& mat,const
 }
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
-bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<SubMatrix<T>*>& MyNearFieldMats_local, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local){
+bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<SubMatrix<T>*>& MyNearFieldMats_local, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local){
 	int bsize = t.get_size()*s.get_size();
 	Block<ClusterImpl> B(t,s);
 	B.ComputeAdmissibility();
@@ -1046,10 +1689,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,con
 			return false;
 		}
 		else{
-			std::vector<bool> Blocks(t.get_nb_sons());
+			std::vector<char> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
-				Blocks[p] = UpdateBlocks(mat,t.get_son(p),s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
+				Blocks[p] = UpdateBlocksTask(mat,t.get_son(p),s,xt,tabt,xs,tabs);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 				return false;
@@ -1064,10 +1713,16 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,con
 	}
 	else{
 		if( t.IsLeaf() ){
-			std::vector<bool> Blocks(t.get_nb_sons());
+			std::vector<char> Blocks(t.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
-				Blocks[p] = UpdateBlocks(mat,t,s.get_son(p),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+				#if _OPENMP
+				#pragma omp task default(shared) firstprivate(p) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+				#endif
+				Blocks[p] = UpdateBlocksTask(mat,t,s.get_son(p),xt,tabt,xs,tabs);
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 				return false;
@@ -1080,12 +1735,18 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,con
 			}
 		}
 		else{
-			std::vector<bool> Blocks(t.get_nb_sons()*s.get_nb_sons());
+			std::vector<char> Blocks(t.get_nb_sons()*s.get_nb_sons());
 			for (int p=0; p <t.get_nb_sons();p++){
 				for (int l=0; l <s.get_nb_sons();l++){
-					Blocks[p+l*t.get_nb_sons()] =UpdateBlocks(mat,t.get_son(p),s.get_son(l),xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+					#if _OPENMP
+					#pragma omp task default(shared) firstprivate(p,l) if(t.get_depth()+s.get_depth()<HMatrix_block_tree_task_depth)
+					#endif
+					Blocks[p+l*t.get_nb_sons()] = UpdateBlocksTask(mat,t.get_son(p),s.get_son(l),xt,tabt,xs,tabs);
 				}
 			}
+			#if _OPENMP
+			#pragma omp taskwait
+			#endif
 			if ((bsize <= maxblocksize) && std::all_of(Blocks.begin(), Blocks.end(),[](bool block){return block!=true;} ) ) {
 					return false;
 			}
@@ -1101,10 +1762,54 @@ bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateSymBlocks(IMatrix<T>& mat,con
 	}
 }
 
+// UpdateBlocks as a task of its own: blocks are computed in task-local vectors
+// and appended to the lists of the thread once the subtree is done
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+bool HMatrix<T, LowRankMatrix, ClusterImpl>::UpdateBlocksTask(IMatrix<T>& mat,const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs){
+    std::vector<SubMatrix<T>*>     MyNearFieldMats_local;
+    std::vector<LowRankMatrix<T,ClusterImpl>*> MyFarFieldMats_local;
+    bool done = UpdateBlocks(mat,t,s,xt,tabt,xs,tabs,MyNearFieldMats_local,MyFarFieldMats_local);
+    AppendThreadBlocks(MyNearFieldMats_local,MyFarFieldMats_local);
+    return done;
+}
+
+// One list of blocks per thread, so that tasks computing blocks do not synchronize
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ReserveThreadBlocks(){
+    int nb_threads = 1;
+    #if _OPENMP
+    nb_threads = omp_get_max_threads();
+    #endif
+    thread_near_field_mats.assign(nb_threads,std::vector<SubMatrix<T>*>());
+    thread_far_field_mats.assign(nb_threads,std::vector<LowRankMatrix<T,ClusterImpl>*>());
+}
+
+// Tasks are tied, so that the thread executing a task does not change between
+// omp_get_thread_num() and the insertion
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::AppendThreadBlocks(const std::vector<SubMatrix<T>*>& MyNearFieldMats_local, const std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local){
+    int thread = 0;
+    #if _OPENMP
+    thread = omp_get_thread_num();
+    #endif
+    thread_near_field_mats[thread].insert(thread_near_field_mats[thread].end(),MyNearFieldMats_local.begin(),MyNearFieldMats_local.end());
+    thread_far_field_mats[thread].insert(thread_far_field_mats[thread].end(),MyFarFieldMats_local.begin(),MyFarFieldMats_local.end());
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::MergeThreadBlocks(){
+    for (int thread=0;thread<thread_near_field_mats.size();thread++){
+        MyNearFieldMats.insert(MyNearFieldMats.end(),thread_near_field_mats[thread].begin(),thread_near_field_mats[thread].end());
+        MyFarFieldMats.insert(MyFarFieldMats.end(),thread_far_field_mats[thread].begin(),thread_far_field_mats[thread].end());
+    }
+    thread_near_field_mats.clear();
+    thread_far_field_mats.clear();
+}
+
 // Build a dense block
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::AddNearFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, std::vector<SubMatrix<T>*>& MyNearFieldMats_local){
-    SubMatrix<T>* submat = new SubMatrix<T>(mat, std::vector<int>(cluster_tree_t->get_perm_start()+t.get_offset(),cluster_tree_t->get_perm_start()+t.get_offset()+t.get_size()), std::vector<int>(cluster_tree_s->get_perm_start()+s.get_offset(),cluster_tree_s->get_perm_start()+s.get_offset()+s.get_size()),t.get_offset(),s.get_offset());
+    SubMatrix<T>* submat = new SubMatrix<T>(mat, cluster_tree_t->get_perm_ptr(), t.get_offset(), t.get_size(), cluster_tree_s->get_perm_ptr(), s.get_offset(), s.get_size(), t.get_offset(), s.get_offset());
 
 	MyNearFieldMats_local.push_back(submat);
 
@@ -1112,13 +1817,574 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::AddNearFieldMat(IMatrix<T>& mat, co
 
 // Build a low rank block
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
-void HMatrix<T, LowRankMatrix, ClusterImpl>::AddFarFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3> xt,const std::vector<int> tabt, const std::vector<R3> xs, const std::vector<int>tabs, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local, const int& reqrank){
-    LowRankMatrix<T,ClusterImpl>* lrmat = new LowRankMatrix<T,ClusterImpl> (std::vector<int>(cluster_tree_t->get_perm_start()+t.get_offset(),cluster_tree_t->get_perm_start()+t.get_offset()+t.get_size()), std::vector<int>(cluster_tree_s->get_perm_start()+s.get_offset(),cluster_tree_s->get_perm_start()+s.get_offset()+s.get_size()),t.get_offset(),s.get_offset(),reqrank);
+void HMatrix<T, LowRankMatrix, ClusterImpl>::AddFarFieldMat(IMatrix<T>& mat, const Cluster<ClusterImpl>& t, const Cluster<ClusterImpl>& s, const std::vector<R3>& xt,const std::vector<int>& tabt, const std::vector<R3>& xs, const std::vector<int>& tabs, std::vector<LowRankMatrix<T,ClusterImpl>*>& MyFarFieldMats_local, const int& reqrank){
+    LowRankMatrix<T,ClusterImpl>* lrmat = new LowRankMatrix<T,ClusterImpl> (cluster_tree_t->get_perm_ptr(), t.get_offset(), t.get_size(), cluster_tree_s->get_perm_ptr(), s.get_offset(), s.get_size(), t.get_offset(), s.get_offset(), reqrank);
     MyFarFieldMats_local.push_back(lrmat);
 	MyFarFieldMats_local.back()->build(mat,t,xt,tabt,s,xs,tabs);
 
 }
 
+// Build vectors of pointers for diagonal blocks
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::SetDiagBlocks(){
+    for (int i=0;i<MyFarFieldMats.size();i++){
+        if (local_offset<=MyFarFieldMats[i]->get_offset_j() && MyFarFieldMats[i]->get_offset_j()<local_offset+local_size){
+            MyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
+            if (MyFarFieldMats[i]->get_offset_j()==MyFarFieldMats[i]->get_offset_i())
+                MyStrictlyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
+        }
+    }
+    for (int i=0;i<MyNearFieldMats.size();i++){
+        if (local_offset<=MyNearFieldMats[i]->get_offset_j() && MyNearFieldMats[i]->get_offset_j()<local_offset+local_size){
+            MyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
+            if (MyNearFieldMats[i]->get_offset_j()==MyNearFieldMats[i]->get_offset_i())
+                MyStrictlyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
+        }
+    }
+}
+
+// Workspaces for products with mu right-hand sides and the current number of threads
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ReserveWorkspaces(int mu, bool transposed) const{
+    int nb_threads = 1;
+    #if _OPENMP
+    nb_threads = omp_get_max_threads();
+    #endif
+    if (transposed && (mu>transp_workspace_mu || nb_threads>transp_workspaces.size())){
+        transp_workspace_mu = std::max(mu,transp_workspace_mu);
+        transp_workspaces.resize(std::max<int>(nb_threads,transp_workspaces.size()));
+        for (int i=0;i<transp_workspaces.size();i++){
+            transp_workspaces[i].resize(nc*transp_workspace_mu);
+        }
+    }
+    if (mu<=workspace_mu && nb_threads<=thread_workspaces.size()){
+        return;
+    }
+    workspace_mu = std::max(mu,workspace_mu);
+
+    int max_workspace_size = 0;
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        max_workspace_size = std::max(max_workspace_size,MyFarFieldMats[b]->workspace_size());
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        max_workspace_size = std::max(max_workspace_size,MyNearFieldMats[b]->workspace_size());
+    }
+    if (!symmetric && nb_threads>thread_workspaces.size()){
+        ComputeRowPartition(nb_threads);
+    }
+    thread_workspaces.resize(std::max<int>(nb_threads,thread_workspaces.size()));
+    for (int i=0;i<thread_workspaces.size();i++){
+        thread_workspaces[i].resize(((symmetric ? local_size : 0)+max_workspace_size)*workspace_mu);
+    }
+    global_workspace.resize(2*std::max(nr,nc)*workspace_mu+local_size*workspace_mu+std::max(nr,nc));
+    recvcounts_workspace.resize(sizeWorld);
+    displs_workspace.resize(sizeWorld);
+}
+
+// Boundaries of at most nb_parts ranges of local rows of similar cost, cutting only between blocks
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+std::vector<int> HMatrix<T, LowRankMatrix, ClusterImpl>::SplitRows(int nb_parts) const{
+    // Number of blocks crossing each row boundary and cost of blocks starting at each row
+    std::vector<int> crossing(local_size+1,0);
+    std::vector<double> cost(local_size+1,0);
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        const LowRankMatrix<T,ClusterImpl>& M = *(MyFarFieldMats[b]);
+        crossing[M.get_offset_i()-local_offset+1]++;
+        crossing[M.get_offset_i()-local_offset+M.nb_rows()]--;
+        cost[M.get_offset_i()-local_offset] += double(M.rank_of())*(M.nb_rows()+M.nb_cols());
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        const SubMatrix<T>& M = *(MyNearFieldMats[b]);
+        crossing[M.get_offset_i()-local_offset+1]++;
+        crossing[M.get_offset_i()-local_offset+M.nb_rows()]--;
+        cost[M.get_offset_i()-local_offset] += double(M.nb_rows())*M.nb_cols();
+    }
+
+    // Greedy choice of the admissible boundary closest to each target cumulated cost
+    double total = std::accumulate(cost.begin(),cost.end(),0.);
+    std::vector<int> boundaries(1,0);
+    int nb_crossing = 0;
+    double cumulated = 0;
+    double previous = 0;
+    int previous_row = 0;
+    for (int r=1;r<local_size;r++){
+        nb_crossing += crossing[r];
+        cumulated   += cost[r-1];
+        if (nb_crossing==0){
+            double target = total*boundaries.size()/nb_parts;
+            if (cumulated>=target && boundaries.size()<nb_parts){
+                boundaries.push_back((target-previous<cumulated-target && previous_row>boundaries.back()) ? previous_row : r);
+            }
+            previous     = cumulated;
+            previous_row = r;
+        }
+    }
+    boundaries.push_back(local_size);
+    return boundaries;
+}
+
+// Split local rows in at most nb_parts ranges of similar cost, cutting only between blocks
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeRowPartition(int nb_parts) const{
+    row_partition = SplitRows(nb_parts);
+
+    // Blocks of each range, in order of target offset
+    int nb_ranges = row_partition.size()-1;
+    partition_far.assign(nb_ranges,std::vector<LowRankMatrix<T,ClusterImpl>*>());
+    partition_near.assign(nb_ranges,std::vector<SubMatrix<T>*>());
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        int p = std::upper_bound(row_partition.begin(),row_partition.end(),MyFarFieldMats[b]->get_offset_i()-local_offset)-row_partition.begin()-1;
+        partition_far[p].push_back(MyFarFieldMats[b]);
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        int p = std::upper_bound(row_partition.begin(),row_partition.end(),MyNearFieldMats[b]->get_offset_i()-local_offset)-row_partition.begin()-1;
+        partition_near[p].push_back(MyNearFieldMats[b]);
+    }
+    for (int p=0;p<nb_ranges;p++){
+        std::stable_sort(partition_far[p].begin(),partition_far[p].end(),[](const LowRankMatrix<T,ClusterImpl>* A, const LowRankMatrix<T,ClusterImpl>* B){return A->get_offset_i()<B->get_offset_i();});
+        std::stable_sort(partition_near[p].begin(),partition_near[p].end(),[](const SubMatrix<T>* A, const SubMatrix<T>* B){return A->get_offset_i()<B->get_offset_i();});
+    }
+}
+
+// Slices of local rows of pipelined products, padded with empty slices so that all processes have the same number of them
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputePipelineSlices(){
+    // A few slices per thread, so that the gather of the first ones overlaps the product of the next ones
+    int nb_threads = 1;
+    #if _OPENMP
+    nb_threads = omp_get_max_threads();
+    #endif
+    pipeline_slices = SplitRows(4*nb_threads);
+    int nb_slices = pipeline_slices.size()-1;
+    MPI_Allreduce(MPI_IN_PLACE,&nb_slices,1,MPI_INT,MPI_MAX,comm);
+    pipeline_slices.resize(nb_slices+1,local_size);
+
+    // Number of rows and offset in the numbering of the cluster tree of the slices of all processes
+    std::vector<int> rows(nb_slices);
+    for (int s=0;s<nb_slices;s++){
+        rows[s] = pipeline_slices[s+1]-pipeline_slices[s];
+    }
+    pipeline_rows.resize(nb_slices*sizeWorld);
+    pipeline_offsets.resize(nb_slices*sizeWorld);
+    MPI_Allgather(rows.data(),nb_slices,MPI_INT,pipeline_rows.data(),nb_slices,MPI_INT,comm);
+    for (int q=0;q<sizeWorld;q++){
+        pipeline_offsets[q*nb_slices] = cluster_tree_t->get_masteroffset(q).first;
+        for (int s=1;s<nb_slices;s++){
+            pipeline_offsets[q*nb_slices+s] = pipeline_offsets[q*nb_slices+s-1]+pipeline_rows[q*nb_slices+s-1];
+        }
+    }
+    pipeline_recvcounts.resize(nb_slices*sizeWorld);
+    pipeline_displs.resize(nb_slices*sizeWorld);
+    pipeline_requests.resize(nb_slices);
+}
+
+// Parts of the input of distributed products owned by other processes and used by the local blocks; requests are
+// exchanged so that each process also knows which ranges of its local input to send
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeHaloExchange(){
+    // Merged column ranges of local blocks
+    std::vector<std::pair<int,int>> ranges;
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        ranges.emplace_back(MyFarFieldMats[b]->get_offset_j(),MyFarFieldMats[b]->get_offset_j()+MyFarFieldMats[b]->nb_cols());
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        ranges.emplace_back(MyNearFieldMats[b]->get_offset_j(),MyNearFieldMats[b]->get_offset_j()+MyNearFieldMats[b]->nb_cols());
+    }
+    std::sort(ranges.begin(),ranges.end());
+    std::vector<std::pair<int,int>> merged;
+    for (int r=0;r<ranges.size();r++){
+        if (!merged.empty() && ranges[r].first<=merged.back().second){
+            merged.back().second = std::max(merged.back().second,ranges[r].second);
+        }
+        else{
+            merged.push_back(ranges[r]);
+        }
+    }
+
+    // Intersection with the parts of other processes
+    halo_recv.assign(sizeWorld,std::vector<std::pair<int,int>>());
+    for (int q=0;q<sizeWorld;q++){
+        int begin = cluster_tree_t->get_masteroffset(q).first;
+        int end   = begin+cluster_tree_t->get_masteroffset(q).second;
+        for (int r=0;r<merged.size() && q!=rankWorld;r++){
+            int first = std::max(merged[r].first,begin);
+            int last  = std::min(merged[r].second,end);
+            if (first<last){
+                halo_recv[q].emplace_back(first,last-first);
+            }
+        }
+    }
+
+    // Exchange of requests
+    std::vector<int> recvcounts(sizeWorld), sendcounts(sizeWorld), recvdispls(sizeWorld,0), senddispls(sizeWorld,0);
+    for (int q=0;q<sizeWorld;q++){
+        recvcounts[q] = 2*halo_recv[q].size();
+    }
+    MPI_Alltoall(recvcounts.data(),1,MPI_INT,sendcounts.data(),1,MPI_INT,comm);
+    for (int q=1;q<sizeWorld;q++){
+        recvdispls[q] = recvdispls[q-1]+recvcounts[q-1];
+        senddispls[q] = senddispls[q-1]+sendcounts[q-1];
+    }
+    std::vector<int> requested(recvdispls.back()+recvcounts.back()), to_send(senddispls.back()+sendcounts.back());
+    for (int q=0;q<sizeWorld;q++){
+        for (int r=0;r<halo_recv[q].size();r++){
+            requested[recvdispls[q]+2*r]   = halo_recv[q][r].first;
+            requested[recvdispls[q]+2*r+1] = halo_recv[q][r].second;
+        }
+    }
+    MPI_Alltoallv(requested.data(),recvcounts.data(),recvdispls.data(),MPI_INT,to_send.data(),sendcounts.data(),senddispls.data(),MPI_INT,comm);
+    halo_send.assign(sizeWorld,std::vector<std::pair<int,int>>());
+    for (int q=0;q<sizeWorld;q++){
+        for (int r=0;r<sendcounts[q]/2;r++){
+            halo_send[q].emplace_back(to_send[senddispls[q]+2*r],to_send[senddispls[q]+2*r+1]);
+        }
+    }
+    halo_requests.resize((requested.size()+to_send.size())/2);
+}
+
+// Report products in infos
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::FlushMvprodInfos() const{
+    if (pending_mat_vec_prod>0){
+        infos["nb_mat_vec_prod"] = NbrToStr(pending_mat_vec_prod+StrToNbr<int>(infos["nb_mat_vec_prod"]));
+        infos["total_time_mat_vec_prod"] = NbrToStr(pending_time_mat_vec_prod+StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+        pending_mat_vec_prod = 0;
+        pending_time_mat_vec_prod = 0;
+    }
+}
+
+// Recompression of low-rank blocks, with statistics on ranks before and after
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::RecompressBlocks(){
+    // 0 : rank before ; 1 : rank after
+    std::vector<int> maxinfos(2,0),mininfos(2,std::max(nc,nr));
+    std::vector<double> meaninfos(2,0);
+    std::vector<int> ranks(MyFarFieldMats.size());
+    #if _OPENMP
+    #pragma omp parallel for schedule(dynamic,1)
+    #endif
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        ranks[b] = MyFarFieldMats[b]->rank_of();
+        MyFarFieldMats[b]->recompress();
+    }
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        int rank = MyFarFieldMats[b]->rank_of();
+        maxinfos[0] = std::max(maxinfos[0],ranks[b]);
+        mininfos[0] = std::min(mininfos[0],ranks[b]);
+        meaninfos[0] += ranks[b];
+        maxinfos[1] = std::max(maxinfos[1],rank);
+        mininfos[1] = std::min(mininfos[1],rank);
+        meaninfos[1] += rank;
+    }
+
+    int nlrmat = MyFarFieldMats.size();
+    MPI_Allreduce(MPI_IN_PLACE, &nlrmat, 1, MPI_INT, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &(maxinfos[0]), 2, MPI_INT, MPI_MAX, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &(mininfos[0]), 2, MPI_INT, MPI_MIN, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &(meaninfos[0]), 2, MPI_DOUBLE, MPI_SUM, comm);
+    for (int i=0;i<2;i++){
+        meaninfos[i] = (nlrmat == 0 ? 0 : meaninfos[i]/nlrmat);
+        mininfos[i]  = (nlrmat == 0 ? 0 : mininfos[i]);
+    }
+
+    infos["Rank_before_recompression_max"]  = NbrToStr(maxinfos[0]);
+    infos["Rank_before_recompression_mean"] = NbrToStr(meaninfos[0]);
+    infos["Rank_before_recompression_min"]  = NbrToStr(mininfos[0]);
+    infos["Rank_after_recompression_max"]  = NbrToStr(maxinfos[1]);
+    infos["Rank_after_recompression_mean"] = NbrToStr(meaninfos[1]);
+    infos["Rank_after_recompression_min"]  = NbrToStr(mininfos[1]);
+}
+
+// Agglomeration of blocks: when local blocks cover exactly the sons of a block (both clusters or only one of them being split),
+// they are replaced by one low-rank block if its recompression needs less memory, until no more blocks can be merged
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::CoarsenBlocks(){
+    typedef std::pair<int,int> Range;
+    typedef std::array<int,4> BlockKey;
+
+    // Father of each cluster with siblings, clusters being identified by their range
+    std::map<Range,const Cluster<ClusterImpl>*> fathers_t, fathers_s;
+    auto find_fathers = [](const Cluster<ClusterImpl>& root, std::map<Range,const Cluster<ClusterImpl>*>& fathers){
+        std::stack<const Cluster<ClusterImpl>*> s;
+        s.push(&root);
+        while (!s.empty()){
+            const Cluster<ClusterImpl>* curr = s.top();
+            s.pop();
+            for (int p=0;p<curr->get_nb_sons();p++){
+                if (curr->get_nb_sons()>1){
+                    fathers[Range(curr->get_son(p).get_offset(),curr->get_son(p).get_size())] = curr;
+                }
+                s.push(&(curr->get_son(p)));
+            }
+        }
+    };
+    find_fathers(cluster_tree_t->get_root(),fathers_t);
+    find_fathers(cluster_tree_s->get_root(),fathers_s);
+
+    // Blocks by range, low-rank blocks b are stored as b and dense blocks b as -b-1
+    std::map<BlockKey,int> blocks;
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        blocks[BlockKey{MyFarFieldMats[b]->get_offset_i(),MyFarFieldMats[b]->nb_rows(),MyFarFieldMats[b]->get_offset_j(),MyFarFieldMats[b]->nb_cols()}] = b;
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        blocks[BlockKey{MyNearFieldMats[b]->get_offset_i(),MyNearFieldMats[b]->nb_rows(),MyNearFieldMats[b]->get_offset_j(),MyNearFieldMats[b]->nb_cols()}] = -b-1;
+    }
+
+    // Sons of a range: the ranges of the sons of its cluster if it is split, the range itself otherwise
+    auto sons = [](const Cluster<ClusterImpl>* father, Range range){
+        std::vector<Range> ranges;
+        if (father==nullptr){
+            ranges.push_back(range);
+        }
+        else{
+            for (int p=0;p<father->get_nb_sons();p++){
+                ranges.push_back(Range(father->get_son(p).get_offset(),father->get_son(p).get_size()));
+            }
+        }
+        return ranges;
+    };
+
+    int nb_merged_blocks = 0;
+    int nb_agglomerated_blocks = 0;
+    std::set<std::array<int,5>> tried;
+    bool merged = true;
+    while (merged){
+        merged = false;
+        std::vector<BlockKey> keys;
+        for (auto& block : blocks){
+            keys.push_back(block.first);
+        }
+        for (const BlockKey& key : keys){
+            if (blocks.count(key)==0){
+                continue;
+            }
+            Range t(key[0],key[1]), s(key[2],key[3]);
+            const Cluster<ClusterImpl>* father_t = fathers_t.count(t) ? fathers_t[t] : nullptr;
+            const Cluster<ClusterImpl>* father_s = fathers_s.count(s) ? fathers_s[s] : nullptr;
+
+            // 0 : both clusters are split ; 1 : target cluster is split ; 2 : source cluster is split
+            bool replaced = false;
+            for (int form=0;form<3 && !replaced;form++){
+                const Cluster<ClusterImpl>* T_cluster = (form==2) ? nullptr : father_t;
+                const Cluster<ClusterImpl>* S_cluster = (form==1) ? nullptr : father_s;
+                if ((form!=2 && T_cluster==nullptr) || (form!=1 && S_cluster==nullptr)){
+                    continue;
+                }
+                Range T_range = (T_cluster==nullptr) ? t : Range(T_cluster->get_offset(),T_cluster->get_size());
+                Range S_range = (S_cluster==nullptr) ? s : Range(S_cluster->get_offset(),S_cluster->get_size());
+                std::array<int,5> attempt{T_range.first,T_range.second,S_range.first,S_range.second,form};
+                if (tried.count(attempt)){
+                    continue;
+                }
+                // Blocks must stay inside the partition of the clusters between processes
+                if ((T_cluster!=nullptr && (T_cluster->get_rank()<0 || T_cluster->get_depth()<GetMinTargetDepth())) || (S_cluster!=nullptr && (S_cluster->get_rank()<0 || S_cluster->get_depth()<GetMinSourceDepth()))){
+                    continue;
+                }
+                // In the symmetric case, only blocks without intersection with the diagonal are stored once
+                if (symmetric && !(T_range.first+T_range.second<=S_range.first || S_range.first+S_range.second<=T_range.first)){
+                    continue;
+                }
+
+                // Sons must all be blocks
+                std::vector<LowRankMatrix<T,ClusterImpl>*> lrmats;
+                std::vector<SubMatrix<T>*> dmats;
+                std::vector<BlockKey> sons_keys;
+                double memory = 0;
+                bool complete = true;
+                for (const Range& t_son : sons(T_cluster,t)){
+                    for (const Range& s_son : sons(S_cluster,s)){
+                        BlockKey son_key{t_son.first,t_son.second,s_son.first,s_son.second};
+                        auto it = blocks.find(son_key);
+                        if (it==blocks.end()){
+                            complete = false;
+                            break;
+                        }
+                        sons_keys.push_back(son_key);
+                        if (it->second>=0){
+                            lrmats.push_back(MyFarFieldMats[it->second]);
+                            memory += double(lrmats.back()->rank_of())*(t_son.second+s_son.second);
+                        }
+                        else{
+                            dmats.push_back(MyNearFieldMats[-it->second-1]);
+                            memory += double(t_son.second)*s_son.second;
+                        }
+                    }
+                    if (!complete) break;
+                }
+                if (!complete){
+                    continue;
+                }
+                // Sons only change by agglomeration, which replaces them by their father, so that a failed attempt is not repeated
+                tried.insert(attempt);
+
+                std::unique_ptr<LowRankMatrix<T,ClusterImpl>> lrmat(new LowRankMatrix<T,ClusterImpl>(cluster_tree_t->get_perm_ptr(), T_range.first, T_range.second, cluster_tree_s->get_perm_ptr(), S_range.first, S_range.second, T_range.first, S_range.first, -1));
+                lrmat->agglomerate(lrmats,dmats);
+                if (lrmat->rank_of()<0 || double(lrmat->rank_of())*(T_range.second+S_range.second)>=memory){
+                    continue;
+                }
+
+                // Sons are replaced by their father
+                for (const BlockKey& son_key : sons_keys){
+                    int b = blocks[son_key];
+                    if (b>=0){
+                        delete MyFarFieldMats[b];
+                        MyFarFieldMats[b] = nullptr;
+                    }
+                    else{
+                        delete MyNearFieldMats[-b-1];
+                        MyNearFieldMats[-b-1] = nullptr;
+                    }
+                    blocks.erase(son_key);
+                }
+                blocks[BlockKey{T_range.first,T_range.second,S_range.first,S_range.second}] = MyFarFieldMats.size();
+                MyFarFieldMats.push_back(lrmat.release());
+                nb_merged_blocks += sons_keys.size();
+                nb_agglomerated_blocks++;
+                replaced = true;
+                merged = true;
+            }
+        }
+
+        // New blocks may have siblings, so that another pass is needed
+        MyFarFieldMats.erase(std::remove(MyFarFieldMats.begin(),MyFarFieldMats.end(),nullptr),MyFarFieldMats.end());
+        MyNearFieldMats.erase(std::remove(MyNearFieldMats.begin(),MyNearFieldMats.end(),nullptr),MyNearFieldMats.end());
+        blocks.clear();
+        for (int b=0;b<MyFarFieldMats.size();b++){
+            blocks[BlockKey{MyFarFieldMats[b]->get_offset_i(),MyFarFieldMats[b]->nb_rows(),MyFarFieldMats[b]->get_offset_j(),MyFarFieldMats[b]->nb_cols()}] = b;
+        }
+        for (int b=0;b<MyNearFieldMats.size();b++){
+            blocks[BlockKey{MyNearFieldMats[b]->get_offset_i(),MyNearFieldMats[b]->nb_rows(),MyNearFieldMats[b]->get_offset_j(),MyNearFieldMats[b]->nb_cols()}] = -b-1;
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &nb_merged_blocks, 1, MPI_INT, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &nb_agglomerated_blocks, 1, MPI_INT, MPI_SUM, comm);
+    infos["Number_of_merged_blocks"] = NbrToStr(nb_merged_blocks);
+    infos["Number_of_agglomerated_blocks"] = NbrToStr(nb_agglomerated_blocks);
+}
+
+// Storage of the factors of low-rank blocks in reduced precision, chosen for each block from its accuracy
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::ReduceBlocksPrecision(){
+    int nb_single_precision_blocks = 0;
+    int nb_half_precision_blocks = 0;
+    #if _OPENMP
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nb_single_precision_blocks,nb_half_precision_blocks)
+    #endif
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        Precision precision = MyFarFieldMats[b]->reduce_precision(halfprecision);
+        if (precision==Precision::SinglePrecision){
+            nb_single_precision_blocks++;
+        }
+        else if (precision==Precision::HalfPrecision){
+            nb_half_precision_blocks++;
+        }
+    }
+    int nb_blocks[2] = {nb_single_precision_blocks,nb_half_precision_blocks};
+    MPI_Allreduce(MPI_IN_PLACE, nb_blocks, 2, MPI_INT, MPI_SUM, comm);
+    infos["Number_of_single_precision_blocks"] = NbrToStr(nb_blocks[0]);
+    infos["Number_of_half_precision_blocks"] = NbrToStr(nb_blocks[1]);
+}
+
+// Storage of dense blocks in reduced precision, chosen for each block so that its error is below epsilon;
+// strictly diagonal blocks stay in the working precision for the symmetric product and apply_dirichlet
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::CompressNearFieldBlocks(){
+    int nb_single_precision_blocks = 0;
+    int nb_half_precision_blocks = 0;
+    #if _OPENMP
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nb_single_precision_blocks,nb_half_precision_blocks)
+    #endif
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        if (MyNearFieldMats[b]->get_offset_i()==MyNearFieldMats[b]->get_offset_j()){
+            continue;
+        }
+        Precision precision = MyNearFieldMats[b]->reduce_precision(epsilon);
+        if (precision==Precision::SinglePrecision){
+            nb_single_precision_blocks++;
+        }
+        else if (precision==Precision::HalfPrecision){
+            nb_half_precision_blocks++;
+        }
+    }
+    int nb_blocks[2] = {nb_single_precision_blocks,nb_half_precision_blocks};
+    MPI_Allreduce(MPI_IN_PLACE, nb_blocks, 2, MPI_INT, MPI_SUM, comm);
+    infos["Number_of_single_precision_dense_blocks"] = NbrToStr(nb_blocks[0]);
+    infos["Number_of_half_precision_dense_blocks"] = NbrToStr(nb_blocks[1]);
+}
+
+// Sort blocks in comp_block order and move their data in one buffer following this order
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::PackBlocks(){
+    std::sort(MyFarFieldMats.begin(),MyFarFieldMats.end(),[](const LowRankMatrix<T,ClusterImpl>* A, const LowRankMatrix<T,ClusterImpl>* B){
+        return A->get_offset_i()<B->get_offset_i() || (A->get_offset_i()==B->get_offset_i() && A->get_offset_j()<B->get_offset_j());
+    });
+    std::sort(MyNearFieldMats.begin(),MyNearFieldMats.end(),[](const SubMatrix<T>* A, const SubMatrix<T>* B){
+        return A->get_offset_i()<B->get_offset_i() || (A->get_offset_i()==B->get_offset_i() && A->get_offset_j()<B->get_offset_j());
+    });
+
+    // Every array starts on a cache line, positions are in bytes; factors in half precision and dense blocks in reduced
+    // precision keep their own storage
+    auto align = [](std::size_t position){return (position+HMatrix_checkpoint_alignment-1)/HMatrix_checkpoint_alignment*HMatrix_checkpoint_alignment;};
+    std::size_t size = 0;
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        const LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+        if (lrmat.is_single_precision()){
+            size = align(size)+std::size_t(lrmat.get_U_single().nb_rows())*lrmat.get_U_single().nb_cols()*sizeof(single_precision_type<T>);
+            size = align(size)+std::size_t(lrmat.get_V_single().nb_rows())*lrmat.get_V_single().nb_cols()*sizeof(single_precision_type<T>);
+        }
+        else if (lrmat.get_precision()==Precision::WorkingPrecision){
+            size = align(size)+std::size_t(lrmat.get_U().nb_rows())*lrmat.get_U().nb_cols()*sizeof(T);
+            size = align(size)+std::size_t(lrmat.get_V().nb_rows())*lrmat.get_V().nb_cols()*sizeof(T);
+        }
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        if (MyNearFieldMats[b]->get_precision()==Precision::WorkingPrecision){
+            size = align(size)+std::size_t(MyNearFieldMats[b]->nb_rows())*MyNearFieldMats[b]->nb_cols()*sizeof(T);
+        }
+    }
+
+    std::size_t bytes = size+HMatrix_checkpoint_alignment;
+    std::shared_ptr<char> arena(new char[bytes],std::default_delete<char[]>());
+    void* start = arena.get();
+    std::align(HMatrix_checkpoint_alignment,size,start,bytes);
+    char* data = static_cast<char*>(start);
+
+    // Blocks become views of the arena, their own storage is released
+    std::size_t position = 0;
+    auto move_to_arena = [&](const void* ptr, std::size_t nb_bytes){
+        position = align(position);
+        char* dest = data+position;
+        std::copy_n(static_cast<const char*>(ptr),nb_bytes,dest);
+        position += nb_bytes;
+        return dest;
+    };
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+        if (lrmat.is_single_precision()){
+            const Matrix<single_precision_type<T>>& U = lrmat.get_U_single();
+            const Matrix<single_precision_type<T>>& V = lrmat.get_V_single();
+            char* U_data = move_to_arena(U.data(),std::size_t(U.nb_rows())*U.nb_cols()*sizeof(single_precision_type<T>));
+            char* V_data = move_to_arena(V.data(),std::size_t(V.nb_rows())*V.nb_cols()*sizeof(single_precision_type<T>));
+            lrmat.assign_single_precision(lrmat.rank_of(),U.nb_cols(),reinterpret_cast<single_precision_type<T>*>(U_data),reinterpret_cast<single_precision_type<T>*>(V_data));
+        }
+        else if (lrmat.get_precision()==Precision::WorkingPrecision){
+            const Matrix<T>& U = lrmat.get_U();
+            const Matrix<T>& V = lrmat.get_V();
+            char* U_data = move_to_arena(U.data(),std::size_t(U.nb_rows())*U.nb_cols()*sizeof(T));
+            char* V_data = move_to_arena(V.data(),std::size_t(V.nb_rows())*V.nb_cols()*sizeof(T));
+            lrmat.assign(lrmat.rank_of(),U.nb_cols(),reinterpret_cast<T*>(U_data),reinterpret_cast<T*>(V_data));
+        }
+    }
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        SubMatrix<T>& submat = *(MyNearFieldMats[b]);
+        if (submat.get_precision()==Precision::WorkingPrecision){
+            submat.assign(submat.nb_rows(),submat.nb_cols(),reinterpret_cast<T*>(move_to_arena(submat.data(),std::size_t(submat.nb_rows())*submat.nb_cols()*sizeof(T))));
+        }
+    }
+    block_data = arena;
+}
+
 // Compute infos
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeInfos(const std::vector<double>& mytime){
@@ -1215,8 +2481,8 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeInfos(const std::vector<doub
     #endif
 
 
-	infos["Eta"] = NbrToStr(GetEta());
-	infos["Eps"] = NbrToStr(GetEpsilon());
+	infos["Eta"] = NbrToStr(eta);
+	infos["Eps"] = NbrToStr(epsilon);
 	infos["MinTargetDepth"] = NbrToStr(GetMinTargetDepth());
 	infos["MinSourceDepth"] = NbrToStr(GetMinSourceDepth());
 
@@ -1227,15 +2493,70 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::ComputeInfos(const std::vector<doub
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T* const out, const int& mu) const{
+	MyMvprodLocal(in,out,mu,true,true);
+}
+
+// Product with the local blocks whose columns are in the local part of the input if local_source, and with the other
+// ones if halo_source; out is overwritten by the first kind of blocks and incremented by the second one
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::MyMvprodLocal(const T* const in, T* const out, const int& mu, bool local_source, bool halo_source) const{
+
+	ReserveWorkspaces(mu);
+	auto selected = [&](int offset_j, int size_j){
+		return (offset_j>=local_offset && offset_j+size_j<=local_offset+local_size) ? local_source : halo_source;
+	};
 
-	std::fill(out,out+local_size*mu,0);
+	// Each range of rows is computed by one thread, directly in out
+	if (!symmetric){
+		#if _OPENMP
+		#pragma omp parallel
+		#endif
+		{
+			int thread = 0;
+			#if _OPENMP
+			thread = omp_get_thread_num();
+			#endif
+			T* const work = thread_workspaces[thread].data();
+			#if _OPENMP
+			#pragma omp for schedule(dynamic,1)
+			#endif
+			for (int p=0;p<partition_far.size();p++){
+				if (local_source){
+					std::fill(out+row_partition[p]*mu,out+row_partition[p+1]*mu,0);
+				}
+				for (int b=0;b<partition_far[p].size();b++){
+					const LowRankMatrix<T,ClusterImpl>&  M  = *(partition_far[p][b]);
+					if (selected(M.get_offset_j(),M.nb_cols())){
+						M.add_mvprod_row_major(in+M.get_offset_j()*mu,out+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
+					}
+				}
+				for (int b=0;b<partition_near[p].size();b++){
+					const SubMatrix<T>&  M  = *(partition_near[p][b]);
+					if (selected(M.get_offset_j(),M.nb_cols())){
+						M.add_mvprod_row_major(in+M.get_offset_j()*mu,out+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	if (local_source){
+		std::fill(out,out+local_size*mu,0);
+	}
 
 	// Contribution champ lointain
     #if _OPENMP
     #pragma omp parallel
     #endif
     {
-        std::vector<T> temp(local_size*mu,0);
+        int thread = 0;
+        #if _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+        T* const temp = thread_workspaces[thread].data();
+        T* const work = temp+local_size*mu;
+        std::fill_n(temp,local_size*mu,0);
         #if _OPENMP
         #pragma omp for schedule(guided)
         #endif
@@ -1244,8 +2565,8 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
     		int offset_i     = M.get_offset_i();
     		int offset_j     = M.get_offset_j();
 
-			if (!symmetric || offset_i!=offset_j){// remove strictly diagonal blocks
-    			M.add_mvprod_row_major(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+			if ((!symmetric || offset_i!=offset_j) && selected(offset_j,M.nb_cols())){// remove strictly diagonal blocks
+    			M.add_mvprod_row_major(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu,'N',work);
 			}
     	}
     	// Contribution champ proche
@@ -1257,13 +2578,13 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
     		int offset_i     = M.get_offset_i();
     		int offset_j     = M.get_offset_j();
 
-			if (!symmetric || offset_i!=offset_j){// remove strictly diagonal blocks
-    			M.add_mvprod_row_major(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+			if ((!symmetric || offset_i!=offset_j) && selected(offset_j,M.nb_cols())){// remove strictly diagonal blocks
+    			M.add_mvprod_row_major(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu,'N',work);
 			}
     	}
 
-		// Symmetric part of the diagonal part
-		if (symmetric){
+		// Transposes of the blocks of the diagonal part, whose input is local
+		if (symmetric && local_source){
 			#if _OPENMP
 			#pragma omp for schedule(guided)
 			#endif
@@ -1273,7 +2594,7 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
 				int offset_j     = M.get_offset_i();
 
 				if (offset_i!=offset_j){// remove strictly diagonal blocks
-					M.add_mvprod_row_major(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu,'C');
+					M.add_mvprod_row_major(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu,'T',work);
 				}
 
 			}
@@ -1285,7 +2606,7 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
 			// 	int offset_i     = M.get_offset_j();
 			// 	int offset_j     = M.get_offset_i();
 
-			// 	M.add_mvprod_row_major_sym(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+			// 	M.add_mvprod_row_major_sym(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu);
 
 			// }
 
@@ -1299,7 +2620,7 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
 				int offset_j     = M.get_offset_i();
 				
 				if (offset_i!=offset_j){// remove strictly diagonal blocks
-					M.add_mvprod_row_major(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu,'C');
+					M.add_mvprod_row_major(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu,'T',work);
 				}
 			}
 
@@ -1310,14 +2631,14 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
 				const SubMatrix<T>&  M  = *(MyStrictlyDiagNearFieldMats[b]);
 				int offset_i     = M.get_offset_j();
 				int offset_j     = M.get_offset_i();
-				M.add_mvprod_row_major_sym(in+offset_j*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+				M.add_mvprod_row_major_sym(in+offset_j*mu,temp+(offset_i-local_offset)*mu,mu);
 			}
 		}
     	
         #if _OPENMP
         #pragma omp critical
         #endif
-        std::transform (temp.begin(), temp.end(), out, out, std::plus<T>());
+        std::transform (temp, temp+local_size*mu, out, out, std::plus<T>());
 
     }
 
@@ -1353,8 +2674,9 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mymvprod_local(const T* const in, T
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::local_to_global(const T* const in, T* const out, const int& mu) const{
   // Allgather
-  std::vector<int> recvcounts(sizeWorld);
-  std::vector<int>  displs(sizeWorld);
+  ReserveWorkspaces(mu);
+  std::vector<int>& recvcounts = recvcounts_workspace;
+  std::vector<int>& displs = displs_workspace;
 
 
   displs[0] = 0;
@@ -1378,33 +2700,62 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::local_to_global(const T* const in,
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_local(const T* const in, T* const out, T* const work, const int& mu) const{
 	double time = MPI_Wtime();
+	ReserveWorkspaces(mu);
+
+	// Whole input gathered if the halo exchange was not computed
+	if (halo_recv.size()!=sizeWorld){
+		local_to_global(in,work,mu);
+		mymvprod_local(work,out,mu);
+		pending_mat_vec_prod++;
+		pending_time_mat_vec_prod += MPI_Wtime()-time;
+		return;
+	}
+
+	// Nonblocking exchange of the parts of the input used by the local blocks, received at their place in work
+	int nb_requests = 0;
+	for (int q=0;q<sizeWorld;q++){
+		for (int r=0;r<halo_recv[q].size();r++){
+			MPI_Irecv(work+halo_recv[q][r].first*mu,halo_recv[q][r].second*mu,wrapper_mpi<T>::mpi_type(),q,0,comm,&(halo_requests[nb_requests++]));
+		}
+	}
+	for (int q=0;q<sizeWorld;q++){
+		for (int r=0;r<halo_send[q].size();r++){
+			MPI_Isend(in+(halo_send[q][r].first-local_offset)*mu,halo_send[q][r].second*mu,wrapper_mpi<T>::mpi_type(),q,0,comm,&(halo_requests[nb_requests++]));
+		}
+	}
+	std::copy_n(in,local_size*mu,work+local_offset*mu);
 
-    this->local_to_global(in, work,mu);
-    this->mymvprod_local(work,out,mu);
+	// Blocks using only the local input while the halo is exchanged, then the other ones
+	MyMvprodLocal(work,out,mu,true,false);
+	MPI_Waitall(nb_requests,halo_requests.data(),MPI_STATUSES_IGNORE);
+	MyMvprodLocal(work,out,mu,false,true);
 
-	infos["nb_mat_vec_prod"] = NbrToStr(1+StrToNbr<int>(infos["nb_mat_vec_prod"]));
-	infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime()-time+StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+	pending_mat_vec_prod++;
+	pending_time_mat_vec_prod += MPI_Wtime()-time;
 }
 
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_global(const T* const in, T* const out, const int& mu) const{
     double time = MPI_Wtime();
+    ReserveWorkspaces(mu);
+    std::vector<int>& recvcounts = recvcounts_workspace;
+    std::vector<int>& displs = displs_workspace;
 
-    if (mu==1){
-    	std::vector<T> out_perm(local_size);
-        std::vector<T> buffer(std::max(nc,nr));
+    if (!pipeline_slices.empty()){
+        MvprodGlobalPipelined(in,out,mu);
+    }
+    else if (mu==1){
+    	T* const out_perm = global_workspace.data();
+        T* const buffer   = out_perm+local_size;
 
         // Permutation
-        cluster_tree_s->global_to_cluster(in,buffer.data());
+        cluster_tree_s->global_to_cluster(in,buffer);
 
         //
-    	mymvprod_local(buffer.data(),out_perm.data(),1);
+    	mymvprod_local(buffer,out_perm,1);
 
         // Allgather
-    	std::vector<int> recvcounts(sizeWorld);
-    	std::vector<int>  displs(sizeWorld);
-
     	displs[0] = 0;
 
     	for (int i=0; i<sizeWorld; i++) {
@@ -1413,22 +2764,22 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_global(const T* const in, T*
     			displs[i] = displs[i-1] + recvcounts[i-1];
     	}
 
-    	MPI_Allgatherv(out_perm.data(), recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), buffer.data(), &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
+    	MPI_Allgatherv(out_perm, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), buffer, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
 
         // Permutation
-        cluster_tree_t->cluster_to_global(buffer.data(),out);
+        cluster_tree_t->cluster_to_global(buffer,out);
 
     }
     else{
 
 
-    	std::vector<T> in_perm(std::max(nr,nc)*mu*2);
-    	std::vector<T> out_perm(local_size*mu);
-        std::vector<T> buffer(nc);
+    	T* const in_perm  = global_workspace.data();
+    	T* const out_perm = in_perm+std::max(nr,nc)*mu*2;
+        T* const buffer   = out_perm+local_size*mu;
 
         for (int i=0;i<mu;i++){
     	    // Permutation
-    	    cluster_tree_s->global_to_cluster(in+i*nc,buffer.data());
+    	    cluster_tree_s->global_to_cluster(in+i*nc,buffer);
 
 
             // Transpose
@@ -1437,7 +2788,7 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_global(const T* const in, T*
             }
         }
 
-    	mymvprod_local(in_perm.data(),in_perm.data()+nc*mu,mu);
+    	mymvprod_local(in_perm,in_perm+nc*mu,mu);
 
         // Tranpose
         for (int i=0;i<mu;i++){
@@ -1449,9 +2800,6 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_global(const T* const in, T*
 
 
     	// Allgather
-    	std::vector<int> recvcounts(sizeWorld);
-    	std::vector<int>  displs(sizeWorld);
-
     	displs[0] = 0;
 
     	for (int i=0; i<sizeWorld; i++) {
@@ -1460,24 +2808,263 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_global(const T* const in, T*
     			displs[i] = displs[i-1] + recvcounts[i-1];
     	}
 
-    	MPI_Allgatherv(out_perm.data(), recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), in_perm.data() + mu*nr, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
+    	MPI_Allgatherv(out_perm, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), in_perm + mu*nr, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
 
         for (int i=0 ;i<mu;i++){
             for (int j=0; j<sizeWorld;j++){
-                std::copy_n(in_perm.data()+mu*nr+displs[j]+i*recvcounts[j]/mu,recvcounts[j]/mu,in_perm.data()+i*nr+displs[j]/mu);
+                std::copy_n(in_perm+mu*nr+displs[j]+i*recvcounts[j]/mu,recvcounts[j]/mu,in_perm+i*nr+displs[j]/mu);
             }
 
             // Permutation
-            cluster_tree_t->cluster_to_global(in_perm.data()+i*nr,out+i*nr);
+            cluster_tree_t->cluster_to_global(in_perm+i*nr,out+i*nr);
+        }
+    }
+	// Timing
+	pending_mat_vec_prod++;
+	pending_time_mat_vec_prod += MPI_Wtime()-time;
+}
+
+// mvprod_global by slices of local rows, the gather of each slice of the output being started as soon as it is computed;
+// the input being global, only the output is exchanged
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::MvprodGlobalPipelined(const T* const in, T* const out, const int& mu) const{
+    T* const in_perm  = global_workspace.data();
+    T* const out_perm = in_perm+std::max(nr,nc)*mu;
+    T* const buffer   = out_perm+std::max(nr,nc)*mu;
+    T* const local_out = out_perm+local_offset*mu;
+
+    // Permutation and transposition of the input
+    for (int i=0;i<mu;i++){
+        cluster_tree_s->global_to_cluster(in+i*nc,buffer);
+        for (int j=0;j<nc;j++){
+            in_perm[i+j*mu]=buffer[j];
         }
     }
+
+    int nb_slices = pipeline_slices.size()-1;
+    for (int s=0;s<nb_slices;s++){
+        int begin = pipeline_slices[s];
+        int end   = pipeline_slices[s+1];
+
+        // Rows of the slice in each range of the row partition, computed by one thread
+        #if _OPENMP
+        #pragma omp parallel
+        #endif
+        {
+            int thread = 0;
+            #if _OPENMP
+            thread = omp_get_thread_num();
+            #endif
+            T* const work = thread_workspaces[thread].data();
+            #if _OPENMP
+            #pragma omp for schedule(dynamic,1)
+            #endif
+            for (int p=0;p<partition_far.size();p++){
+                int first = std::max(row_partition[p],begin);
+                int last  = std::min(row_partition[p+1],end);
+                if (first>=last){
+                    continue;
+                }
+                std::fill(local_out+first*mu,local_out+last*mu,0);
+                for (int b=0;b<partition_far[p].size();b++){
+                    const LowRankMatrix<T,ClusterImpl>&  M  = *(partition_far[p][b]);
+                    int row = M.get_offset_i()-local_offset;
+                    if (row>=first && row<last){
+                        M.add_mvprod_row_major(in_perm+M.get_offset_j()*mu,local_out+row*mu,mu,'N',work);
+                    }
+                }
+                for (int b=0;b<partition_near[p].size();b++){
+                    const SubMatrix<T>&  M  = *(partition_near[p][b]);
+                    int row = M.get_offset_i()-local_offset;
+                    if (row>=first && row<last){
+                        M.add_mvprod_row_major(in_perm+M.get_offset_j()*mu,local_out+row*mu,mu,'N',work);
+                    }
+                }
+            }
+        }
+
+        // Gather of the slice, in place in the output of all processes
+        for (int q=0;q<sizeWorld;q++){
+            pipeline_recvcounts[s*sizeWorld+q] = pipeline_rows[q*nb_slices+s]*mu;
+            pipeline_displs[s*sizeWorld+q]     = pipeline_offsets[q*nb_slices+s]*mu;
+        }
+        MPI_Iallgatherv(MPI_IN_PLACE,0,wrapper_mpi<T>::mpi_type(),out_perm,pipeline_recvcounts.data()+s*sizeWorld,pipeline_displs.data()+s*sizeWorld,wrapper_mpi<T>::mpi_type(),comm,&(pipeline_requests[s]));
+
+        // Progress of pending gathers
+        int done;
+        MPI_Testall(s+1,pipeline_requests.data(),&done,MPI_STATUSES_IGNORE);
+    }
+    MPI_Waitall(nb_slices,pipeline_requests.data(),MPI_STATUSES_IGNORE);
+
+    // Transposition and permutation of the output
+    for (int i=0;i<mu;i++){
+        for (int j=0;j<nr;j++){
+            buffer[j]=out_perm[i+j*mu];
+        }
+        cluster_tree_t->cluster_to_global(buffer,out+i*nr);
+    }
+}
+
+// out = A^H in, in and out being in the global numbering; the blocks are distributed by rows, so that the contributions
+// of all processes to every entry of out are summed
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_transp_global(const T* const in, T* const out, const int& mu) const{
+    if (symmetric && std::is_same<T,underlying_type<T>>::value){
+        mvprod_global(in,out,mu);
+        return;
+    }
+    if (symmetric){
+        // A^H in = conj(A conj(in))
+        ReserveWorkspaces(mu,true);
+        T* const in_conj = transp_workspaces[0].data();
+        std::transform(in,in+nr*mu,in_conj,[](const T& a){return conj_if_complex(a);});
+        mvprod_global(in_conj,out,mu);
+        std::transform(out,out+nc*mu,out,[](const T& a){return conj_if_complex(a);});
+        return;
+    }
+    double time = MPI_Wtime();
+    ReserveWorkspaces(mu);
+    T* const out_perm = global_workspace.data();
+    T* const in_perm  = out_perm+std::max(nr,nc)*mu*2;
+    T* const buffer   = in_perm+local_size*mu;
+
+    // Local rows of the input, permuted and transposed
+    for (int i=0;i<mu;i++){
+        cluster_tree_t->global_to_cluster(in+i*nr,buffer);
+        for (int j=0;j<local_size;j++){
+            in_perm[i+j*mu]=buffer[local_offset+j];
+        }
+    }
+
+    MyMvprodTranspLocal(in_perm,out_perm,mu);
+
+    // Sum over processes
+    MPI_Allreduce(MPI_IN_PLACE, out_perm, nc*mu, wrapper_mpi<T>::mpi_type(), MPI_SUM, comm);
+
+    // Transpose and permutation
+    for (int i=0;i<mu;i++){
+        for (int j=0;j<nc;j++){
+            buffer[j]=out_perm[i+j*mu];
+        }
+        cluster_tree_s->cluster_to_global(buffer,out+i*nc);
+    }
+
 	// Timing
-	infos["nb_mat_vec_prod"] = NbrToStr(1+StrToNbr<int>(infos["nb_mat_vec_prod"]));
-	infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime()-time+StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+	pending_mat_vec_prod++;
+	pending_time_mat_vec_prod += MPI_Wtime()-time;
+}
+
+// out = A^H in, in being the local rows of the input and out the local part of the output given by the source cluster tree,
+// both in the numbering of the cluster trees with the mu vectors interleaved as in mvprod_local; work has size nb_cols()*mu
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_transp_local(const T* const in, T* const out, T* const work, const int& mu) const{
+    if (symmetric && std::is_same<T,underlying_type<T>>::value){
+        mvprod_local(in,out,work,mu);
+        return;
+    }
+    if (symmetric){
+        ReserveWorkspaces(mu,true);
+        T* const in_conj = transp_workspaces[0].data();
+        std::transform(in,in+local_size*mu,in_conj,[](const T& a){return conj_if_complex(a);});
+        mvprod_local(in_conj,out,work,mu);
+        std::transform(out,out+local_size*mu,out,[](const T& a){return conj_if_complex(a);});
+        return;
+    }
+	double time = MPI_Wtime();
+
+    MyMvprodTranspLocal(in,work,mu);
+
+    // Sum over processes, each one receiving its part
+    std::vector<int>& recvcounts = recvcounts_workspace;
+    for (int i=0; i<sizeWorld; i++) {
+        recvcounts[i] = cluster_tree_s->get_masteroffset(i).second*mu;
+    }
+    MPI_Reduce_scatter(work, out, recvcounts.data(), wrapper_mpi<T>::mpi_type(), MPI_SUM, comm);
+
+	pending_mat_vec_prod++;
+	pending_time_mat_vec_prod += MPI_Wtime()-time;
+}
+
+// out = A^H in for the local blocks, in being the local rows and out all the columns; blocks of different rows
+// contribute to the same entries of out, so that each thread sums its blocks in its own accumulator
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::MyMvprodTranspLocal(const T* const in, T* const out, const int& mu) const{
+	ReserveWorkspaces(mu,true);
+	std::fill(out,out+nc*mu,0);
+
+    #if _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        int thread = 0;
+        #if _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+        T* const work = thread_workspaces[thread].data();
+        T* const temp = transp_workspaces[thread].data();
+        std::fill_n(temp,nc*mu,0);
+        #if _OPENMP
+        #pragma omp for schedule(guided)
+        #endif
+    	for(int b=0; b<MyFarFieldMats.size(); b++){
+    		const LowRankMatrix<T,ClusterImpl>&  M  = *(MyFarFieldMats[b]);
+   			M.add_mvprod_row_major(in+(M.get_offset_i()-local_offset)*mu,temp+M.get_offset_j()*mu,mu,'C',work);
+    	}
+        #if _OPENMP
+        #pragma omp for schedule(guided)
+        #endif
+    	for(int b=0; b<MyNearFieldMats.size(); b++){
+    		const SubMatrix<T>&  M  = *(MyNearFieldMats[b]);
+   			M.add_mvprod_row_major(in+(M.get_offset_i()-local_offset)*mu,temp+M.get_offset_j()*mu,mu,'C',work);
+    	}
+        #if _OPENMP
+        #pragma omp critical
+        #endif
+        std::transform(temp, temp+nc*mu, out, out, std::plus<T>());
+    }
 }
 
+// Product with the local blocks whose columns intersect [offset,offset+size], in starting at column offset-local_max_size_j;
+// as in MyMvprodLocal, each range of rows is computed by one thread in the non symmetric case, and products use the workspaces
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_subrhs(const T* const in, T* const out, const int& mu, const int& offset, const int& size, const int& local_max_size_j) const{
+    ReserveWorkspaces(mu);
+    auto selected = [&](int offset_j, int size_j){
+        return offset_j <= offset+size && offset<= offset_j+size_j;
+    };
+
+    if (!symmetric){
+        #if _OPENMP
+        #pragma omp parallel
+        #endif
+        {
+            int thread = 0;
+            #if _OPENMP
+            thread = omp_get_thread_num();
+            #endif
+            T* const work = thread_workspaces[thread].data();
+            #if _OPENMP
+            #pragma omp for schedule(dynamic,1)
+            #endif
+            for (int p=0;p<partition_far.size();p++){
+                std::fill(out+row_partition[p]*mu,out+row_partition[p+1]*mu,0);
+                for (int b=0;b<partition_far[p].size();b++){
+                    const LowRankMatrix<T,ClusterImpl>&  M  = *(partition_far[p][b]);
+                    if (selected(M.get_offset_j(),M.nb_cols())){
+                        M.add_mvprod_row_major(in+(M.get_offset_j()-offset+local_max_size_j)*mu,out+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
+                    }
+                }
+                for (int b=0;b<partition_near[p].size();b++){
+                    const SubMatrix<T>&  M  = *(partition_near[p][b]);
+                    if (selected(M.get_offset_j(),M.nb_cols())){
+                        M.add_mvprod_row_major(in+(M.get_offset_j()-offset+local_max_size_j)*mu,out+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
+                    }
+                }
+            }
+        }
+        return;
+    }
+
     std::fill(out,out+local_size*mu,0);
 
 	// Contribution champ lointain
@@ -1485,18 +3072,20 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_subrhs(const T* const in, T*
     #pragma omp parallel
     #endif
     {
-        std::vector<T> temp(local_size*mu,0);
+        int thread = 0;
+        #if _OPENMP
+        thread = omp_get_thread_num();
+        #endif
+        T* const temp = thread_workspaces[thread].data();
+        T* const work = temp+local_size*mu;
+        std::fill_n(temp,local_size*mu,0);
         #if _OPENMP
         #pragma omp for schedule(guided)
         #endif
     	for(int b=0; b<MyFarFieldMats.size(); b++){
             const LowRankMatrix<T,ClusterImpl>&  M  = *(MyFarFieldMats[b]);
-            int offset_i     = M.get_offset_i();
-            int offset_j     = M.get_offset_j();
-            int size_j       = M.nb_cols();
-
-            if (offset_j <= offset+size && offset<= offset_j+size_j){
-        		M.add_mvprod_row_major(in+(offset_j-offset+local_max_size_j)*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+            if (selected(M.get_offset_j(),M.nb_cols())){
+        		M.add_mvprod_row_major(in+(M.get_offset_j()-offset+local_max_size_j)*mu,temp+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
             }
     	}
     	// Contribution champ proche
@@ -1505,21 +3094,15 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::mvprod_subrhs(const T* const in, T*
         #endif
     	for(int b=0; b<MyNearFieldMats.size(); b++){
             const SubMatrix<T>&  M  = *(MyNearFieldMats[b]);
-            int offset_i     = M.get_offset_i();
-            int offset_j     = M.get_offset_j();
-            int size_j       = M.nb_cols();
-
-            if (offset_j <= offset+size && offset<= offset_j+size_j){
-    		    M.add_mvprod_row_major(in+(offset_j-offset+local_max_size_j)*mu,temp.data()+(offset_i-local_offset)*mu,mu);
+            if (selected(M.get_offset_j(),M.nb_cols())){
+    		    M.add_mvprod_row_major(in+(M.get_offset_j()-offset+local_max_size_j)*mu,temp+(M.get_offset_i()-local_offset)*mu,mu,'N',work);
     		}
     	}
         #if _OPENMP
         #pragma omp critical
         #endif
-        std::transform (temp.begin(), temp.end(), out, out, std::plus<T>());
-
+        std::transform(temp, temp+local_size*mu, out, out, std::plus<T>());
     }
-
 }
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
@@ -1574,6 +3157,7 @@ double HMatrix<T, LowRankMatrix, ClusterImpl>::compression() const{
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::print_infos() const{
+	FlushMvprodInfos();
 	int rankWorld;
     MPI_Comm_rank(comm, &rankWorld);
 
@@ -1587,6 +3171,7 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::print_infos() const{
 
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::save_infos(const std::string& outputname,std::ios_base::openmode mode, const std::string& sep) const{
+	FlushMvprodInfos();
 	int rankWorld;
   MPI_Comm_rank(comm, &rankWorld);
 
@@ -1614,10 +3199,10 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::save_plot(const std::string& output
 	if (outputfile){
 		outputfile<<nr<<","<<nc<<std::endl;
 		for (typename std::vector<SubMatrix<T>*>::const_iterator it = MyNearFieldMats.begin() ; it != MyNearFieldMats.end() ; ++it){
-			outputfile<<(*it)->get_offset_i()<<","<<(*it)->get_ir().size()<<","<<(*it)->get_offset_j()<<","<<(*it)->get_ic().size()<<","<<-1<<std::endl;
+			outputfile<<(*it)->get_offset_i()<<","<<(*it)->nb_rows()<<","<<(*it)->get_offset_j()<<","<<(*it)->nb_cols()<<","<<-1<<std::endl;
 		}
 		for (typename std::vector<LowRankMatrix<T,ClusterImpl>*>::const_iterator it = MyFarFieldMats.begin() ; it != MyFarFieldMats.end() ; ++it){
-			outputfile<<(*it)->get_offset_i()<<","<<(*it)->get_ir().size()<<","<<(*it)->get_offset_j()<<","<<(*it)->get_ic().size()<<","<<(*it)->rank_of()<<std::endl;
+			outputfile<<(*it)->get_offset_i()<<","<<(*it)->nb_rows()<<","<<(*it)->get_offset_j()<<","<<(*it)->nb_cols()<<","<<(*it)->rank_of()<<std::endl;
 		}
 		outputfile.close();
 	}
@@ -1626,6 +3211,102 @@ void HMatrix<T, LowRankMatrix, ClusterImpl>::save_plot(const std::string& output
 	}
 }
 
+// Checkpoint, one file per MPI process
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::save(const std::string& outputname) const{
+	if (std::any_of(MyFarFieldMats.begin(),MyFarFieldMats.end(),[](const LowRankMatrix<T,ClusterImpl>* lrmat){return lrmat->get_precision()!=Precision::WorkingPrecision;})
+	    || std::any_of(MyNearFieldMats.begin(),MyNearFieldMats.end(),[](const SubMatrix<T>* submat){return submat->get_precision()!=Precision::WorkingPrecision;})){
+		std::cerr << "Checkpoints of HMatrix with blocks in reduced precision are not supported"<<std::endl;
+		return;
+	}
+	std::string filename = outputname+"_"+NbrToStr(rankWorld)+".bin";
+	std::ofstream out(filename,std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!out){
+		std::cout << "Unable to create "<<filename<<std::endl;
+		return;
+	}
+	int nb_near = MyNearFieldMats.size();
+	int nb_far  = MyFarFieldMats.size();
+	FlushMvprodInfos();
+
+	// Metadata: cluster trees and infos
+	bool same_cluster_trees = (cluster_tree_t==cluster_tree_s);
+	std::ostringstream metadata(std::ios::out | std::ios::binary);
+	cluster_tree_t->cluster_to_bytes(metadata);
+	if (!same_cluster_trees){
+		cluster_tree_s->cluster_to_bytes(metadata);
+	}
+	int nb_infos = infos.size();
+	metadata.write((const char*) (&nb_infos), sizeof(int));
+	for (std::map<std::string,std::string>::const_iterator it = infos.begin() ; it != infos.end() ; ++it){
+		int length = it->first.size();
+		metadata.write((const char*) (&length), sizeof(int));
+		metadata.write(it->first.data(), length);
+		length = it->second.size();
+		metadata.write((const char*) (&length), sizeof(int));
+		metadata.write(it->second.data(), length);
+	}
+	std::string metadata_bytes = metadata.str();
+
+	// Layout of the data section
+	auto align = [](std::int64_t position, std::int64_t alignment){return (position+alignment-1)/alignment*alignment;};
+	std::int64_t table_offset = 8+13*sizeof(int)+2*sizeof(double)+sizeof(std::int64_t)+metadata_bytes.size();
+	std::int64_t data_offset  = align(table_offset+nb_near*(4*sizeof(int)+sizeof(std::int64_t))+nb_far*(6*sizeof(int)+2*sizeof(std::int64_t)),HMatrix_checkpoint_page);
+	std::vector<std::int64_t> near_data(nb_near), far_data(2*nb_far);
+	std::int64_t position = data_offset;
+	for (int b=0;b<nb_near;b++){
+		near_data[b] = align(position,HMatrix_checkpoint_alignment);
+		position = near_data[b]+std::int64_t(MyNearFieldMats[b]->nb_rows())*MyNearFieldMats[b]->nb_cols()*sizeof(T);
+	}
+	for (int b=0;b<nb_far;b++){
+		const LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+		far_data[2*b] = align(position,HMatrix_checkpoint_alignment);
+		position = far_data[2*b]+std::int64_t(lrmat.get_U().nb_rows())*lrmat.get_U().nb_cols()*sizeof(T);
+		far_data[2*b+1] = align(position,HMatrix_checkpoint_alignment);
+		position = far_data[2*b+1]+std::int64_t(lrmat.get_V().nb_rows())*lrmat.get_V().nb_cols()*sizeof(T);
+	}
+
+	// Header and metadata
+	std::vector<int> header = {HMatrix_checkpoint_version,int(sizeof(T)),std::is_floating_point<T>::value,sizeWorld,nr,nc,reqrank,local_size,local_offset,symmetric,same_cluster_trees,nb_near,nb_far};
+	out.write(HMatrix_checkpoint_magic,8);
+	double parameters[2] = {epsilon,eta};
+	out.write((const char*) header.data(), header.size()*sizeof(int));
+	out.write((const char*) parameters, 2*sizeof(double));
+	out.write((const char*) (&data_offset), sizeof(std::int64_t));
+	out.write(metadata_bytes.data(),metadata_bytes.size());
+
+	// Block table
+	for (int b=0;b<nb_near;b++){
+		const SubMatrix<T>& submat = *(MyNearFieldMats[b]);
+		int block[4] = {submat.get_offset_i(),submat.nb_rows(),submat.get_offset_j(),submat.nb_cols()};
+		out.write((const char*) block, 4*sizeof(int));
+		out.write((const char*) (&(near_data[b])), sizeof(std::int64_t));
+	}
+	for (int b=0;b<nb_far;b++){
+		const LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+		int block[6] = {lrmat.get_offset_i(),lrmat.nb_rows(),lrmat.get_offset_j(),lrmat.nb_cols(),lrmat.rank_of(),lrmat.get_U().nb_cols()};
+		out.write((const char*) block, 6*sizeof(int));
+		out.write((const char*) (&(far_data[2*b])), 2*sizeof(std::int64_t));
+	}
+
+	// Block data
+	std::vector<char> padding(HMatrix_checkpoint_page,0);
+	auto write_array = [&out,&padding](const Matrix<T>& matrix, std::int64_t offset){
+		out.write(padding.data(),offset-out.tellp());
+		out.write((const char*) matrix.data(),std::int64_t(matrix.nb_rows())*matrix.nb_cols()*sizeof(T));
+	};
+	for (int b=0;b<nb_near;b++){
+		write_array(*(MyNearFieldMats[b]),near_data[b]);
+	}
+	for (int b=0;b<nb_far;b++){
+		write_array(MyFarFieldMats[b]->get_U(),far_data[2*b]);
+		write_array(MyFarFieldMats[b]->get_V(),far_data[2*b+1]);
+	}
+	out.write(padding.data(),align(position,HMatrix_checkpoint_alignment)-out.tellp());
+	out.close();
+}
+
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 double Frobenius_absolute_error(const HMatrix<T, LowRankMatrix, ClusterImpl>& B, const IMatrix<T>& A){
 	double myerr = 0;
@@ -1646,13 +3327,9 @@ Matrix<T> HMatrix<T, LowRankMatrix, ClusterImpl>::to_dense() const{
     // Internal dense blocks
     for (int l=0;l<MyNearFieldMats.size();l++){
       const SubMatrix<T>& submat = *(MyNearFieldMats[l]);
-      int local_nr = submat.nb_rows();
-      int local_nc = submat.nb_cols();
       int offset_i = submat.get_offset_i();
       int offset_j = submat.get_offset_j();
-      for (int k=0;k<local_nc;k++){
-        std::copy_n(&(submat(0,k)),local_nr,Dense.data()+offset_i+(offset_j+k)*local_size);
-      }
+      submat.get_whole_matrix(Dense.data()+offset_i+offset_j*local_size,local_size);
     }
 
     // Internal compressed block
@@ -1684,7 +3361,7 @@ Matrix<T> HMatrix<T, LowRankMatrix, ClusterImpl>::to_dense_perm() const{
 		int offset_j = submat.get_offset_j();
 		for (int k=0;k<local_nc;k++)
 			for (int j=0;j<local_nr;j++)
-				Dense(get_permt(j+offset_i),get_perms(k+offset_j))=submat(j,k);
+				Dense(get_permt(j+offset_i),get_perms(k+offset_j))=submat.get_coef(j,k);
 	}
 
 	// Internal compressed block
@@ -1704,6 +3381,230 @@ Matrix<T> HMatrix<T, LowRankMatrix, ClusterImpl>::to_dense_perm() const{
 	return Dense;
 }
 
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+std::unique_ptr<HBlock<T>> HMatrix<T, LowRankMatrix, ClusterImpl>::to_hblock(bool lower) const{
+    // Local blocks, described by kind (0 dense, 1 low-rank), nb_rows, nb_cols, offset_i, offset_j and rank, and their data
+    std::vector<std::unique_ptr<HBlock<T>>> my_leaves = GetLeaves(lower);
+    std::vector<int> my_table;
+    std::vector<T> my_data;
+    for (int b=0;b<my_leaves.size();b++){
+        const HBlock<T>& leaf = *(my_leaves[b]);
+        std::size_t nr_b = leaf.nb_rows(), nc_b = leaf.nb_cols();
+        if (leaf.get_kind()==HBlock<T>::Kind::Dense){
+            my_table.insert(my_table.end(),{0,leaf.nb_rows(),leaf.nb_cols(),leaf.get_offset_i(),leaf.get_offset_j(),0});
+            my_data.insert(my_data.end(),leaf.get_dense(),leaf.get_dense()+nr_b*nc_b);
+        }
+        else{
+            std::size_t rank = leaf.rank_of();
+            my_table.insert(my_table.end(),{1,leaf.nb_rows(),leaf.nb_cols(),leaf.get_offset_i(),leaf.get_offset_j(),leaf.rank_of()});
+            my_data.insert(my_data.end(),leaf.get_U(),leaf.get_U()+nr_b*rank);
+            my_data.insert(my_data.end(),leaf.get_V(),leaf.get_V()+rank*nc_b);
+        }
+    }
+    my_leaves.clear();
+
+    // All blocks
+    std::vector<int> table;
+    std::vector<T> data;
+    AllGather(my_table,table,MPI_INT,comm);
+    AllGather(my_data,data,wrapper_mpi<T>::mpi_type(),comm);
+
+    std::vector<std::unique_ptr<HBlock<T>>> leaves;
+    std::size_t position = 0;
+    for (int b=0;b<table.size()/6;b++){
+        const int* block = &(table[6*b]);
+        int nr_b = block[1], nc_b = block[2], offset_i = block[3], offset_j = block[4], rank = block[5];
+        if (block[0]==0){
+            leaves.emplace_back(new HBlock<T>(nr_b,nc_b,offset_i,offset_j,data.data()+position,nr_b));
+            position += std::size_t(nr_b)*nc_b;
+        }
+        else{
+            std::vector<T> U(data.begin()+position,data.begin()+position+std::size_t(nr_b)*rank);
+            std::vector<T> V(data.begin()+position+std::size_t(nr_b)*rank,data.begin()+position+std::size_t(nr_b+nc_b)*rank);
+            leaves.emplace_back(new HBlock<T>(nr_b,nc_b,offset_i,offset_j,rank,std::move(U),std::move(V)));
+            position += std::size_t(nr_b+nc_b)*rank;
+        }
+    }
+    return BuildHBlock(leaves,lower);
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::add(const T& alpha, const HMatrix& B){
+    if (&get_cluster_tree_t()!=&B.get_cluster_tree_t() || &get_cluster_tree_s()!=&B.get_cluster_tree_s() || (symmetric && !B.symmetric)){
+        std::cerr << "HMatrix::add needs a matrix with the same cluster trees, and symmetric if this one is"<<std::endl;
+        return;
+    }
+    if (!HasWorkingPrecisionBlocks()){
+        std::cerr << "H-arithmetic needs blocks in working precision"<<std::endl;
+        return;
+    }
+
+    // Local rows of both matrices, with their hierarchy
+    std::unique_ptr<HBlock<T>> hblock = BuildHBlock(GetLeaves(false),false);
+    std::unique_ptr<HBlock<T>> B_hblock = B.BuildHBlock(B.GetLeaves(false),false);
+    hblock->add(alpha,*B_hblock,epsilon);
+    SetBlocks(*hblock);
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::add_lowrank(const T& alpha, int k, const T* const U, const T* const V){
+    if (symmetric){
+        std::cerr << "HMatrix::add_lowrank does not keep the symmetric storage"<<std::endl;
+        return;
+    }
+    if (!HasWorkingPrecisionBlocks()){
+        std::cerr << "H-arithmetic needs blocks in working precision"<<std::endl;
+        return;
+    }
+
+    // Local rows of U and columns of V in the numbering of the cluster trees
+    std::vector<T> U_local(std::size_t(local_size)*k), V_perm(std::size_t(k)*nc);
+    for (int l=0;l<k;l++){
+        for (int i=0;i<local_size;i++){
+            U_local[i+std::size_t(l)*local_size] = U[get_permt(local_offset+i)+std::size_t(l)*nr];
+        }
+    }
+    for (int j=0;j<nc;j++){
+        std::copy_n(V+std::size_t(get_perms(j))*k,k,V_perm.data()+std::size_t(j)*k);
+    }
+
+    // Update of each block
+    std::vector<std::unique_ptr<HBlock<T>>> leaves = GetLeaves(false);
+    for (int b=0;b<leaves.size();b++){
+        HBlock<T>& leaf = *(leaves[b]);
+        leaf.add_lowrank(alpha,k,U_local.data()+leaf.get_offset_i()-local_offset,local_size,V_perm.data()+std::size_t(leaf.get_offset_j())*k,k,epsilon);
+    }
+    SetBlocks(*BuildHBlock(leaves,false));
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::add_product(const T& alpha, const HMatrix& A, const HMatrix& B, const T& beta){
+    if (symmetric || &get_cluster_tree_t()!=&A.get_cluster_tree_t() || &A.get_cluster_tree_s()!=&B.get_cluster_tree_t() || &B.get_cluster_tree_s()!=&get_cluster_tree_s()){
+        if (rankWorld==0){
+            std::cerr << "HMatrix::add_product needs a non symmetric matrix and factors whose cluster trees match its own and each other's"<<std::endl;
+        }
+        return;
+    }
+
+    // Local rows of A op B need every row of B
+    std::unique_ptr<HBlock<T>> B_hblock = B.to_hblock();
+    if (!HasWorkingPrecisionBlocks()){
+        std::cerr << "H-arithmetic needs blocks in working precision"<<std::endl;
+        return;
+    }
+    std::unique_ptr<HBlock<T>> hblock = BuildHBlock(GetLeaves(false),false);
+    if (beta!=T(1)){
+        hblock->scale(beta);
+    }
+    std::unique_ptr<HBlock<T>> A_hblock = A.BuildHBlock(A.GetLeaves(false),false);
+    hblock->add_product(alpha,*A_hblock,*B_hblock,'N',epsilon);
+    SetBlocks(*hblock);
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+bool HMatrix<T, LowRankMatrix, ClusterImpl>::HasWorkingPrecisionBlocks() const{
+    return std::all_of(MyFarFieldMats.begin(),MyFarFieldMats.end(),[](const LowRankMatrix<T,ClusterImpl>* lrmat){return lrmat->get_precision()==Precision::WorkingPrecision;})
+        && std::all_of(MyNearFieldMats.begin(),MyNearFieldMats.end(),[](const SubMatrix<T>* submat){return submat->get_precision()==Precision::WorkingPrecision;});
+}
+
+// Local blocks as dense and low-rank HBlock. If lower, symmetric matrices only give the blocks of their lower part;
+// otherwise their blocks in the local diagonal square, stored by their lower part, are completed with transposes
+// so that the blocks cover the local rows
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+std::vector<std::unique_ptr<HBlock<T>>> HMatrix<T, LowRankMatrix, ClusterImpl>::GetLeaves(bool lower) const{
+    std::vector<std::unique_ptr<HBlock<T>>> leaves;
+    auto add_leaf = [&](HBlock<T>* leaf){
+        int offset_i = leaf->get_offset_i();
+        int offset_j = leaf->get_offset_j();
+        if (symmetric && lower && offset_j>offset_i){
+            delete leaf;
+            return;
+        }
+        leaves.emplace_back(leaf);
+        if (symmetric && !lower && offset_j<offset_i && local_offset<=offset_j && offset_j<local_offset+local_size){
+            leaves.emplace_back(leaf->transpose());
+        }
+    };
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        const SubMatrix<T>& submat = *(MyNearFieldMats[b]);
+        int nr_b = submat.nb_rows();
+        int nc_b = submat.nb_cols();
+        std::vector<T> data(std::size_t(nr_b)*nc_b);
+        for (int j=0;j<nc_b;j++){
+            for (int i=0;i<nr_b;i++){
+                data[i+std::size_t(j)*nr_b] = submat.get_coef(i,j);
+            }
+        }
+        add_leaf(new HBlock<T>(nr_b,nc_b,submat.get_offset_i(),submat.get_offset_j(),data.data(),nr_b));
+    }
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        const LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+        int nr_b = lrmat.nb_rows();
+        int nc_b = lrmat.nb_cols();
+        int rank = lrmat.rank_of();
+        std::vector<T> U(std::size_t(nr_b)*rank), V(std::size_t(rank)*nc_b);
+        for (int l=0;l<rank;l++){
+            for (int i=0;i<nr_b;i++){
+                U[i+std::size_t(l)*nr_b] = lrmat.get_U(i,l);
+            }
+            for (int j=0;j<nc_b;j++){
+                V[l+std::size_t(j)*rank] = lrmat.get_V(l,j);
+            }
+        }
+        add_leaf(new HBlock<T>(nr_b,nc_b,lrmat.get_offset_i(),lrmat.get_offset_j(),rank,std::move(U),std::move(V)));
+    }
+    return leaves;
+}
+
+// Hierarchy of the blocks following the cluster trees, blocks not covered by leaves being low-rank blocks of rank zero
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+std::unique_ptr<HBlock<T>> HMatrix<T, LowRankMatrix, ClusterImpl>::BuildHBlock(const std::vector<std::unique_ptr<HBlock<T>>>& leaves, bool lower) const{
+    std::vector<const HBlock<T>*> ptrs(leaves.size());
+    for (int b=0;b<leaves.size();b++){
+        ptrs[b] = leaves[b].get();
+    }
+    return std::unique_ptr<HBlock<T>>(HBlock<T>::build(*cluster_tree_t,*cluster_tree_s,ptrs,lower && symmetric));
+}
+
+// Local blocks set from their restrictions of hblock, low-rank blocks being truncated at epsilon
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::SetBlocks(const HBlock<T>& hblock){
+    for (int b=0;b<MyNearFieldMats.size();b++){
+        SubMatrix<T>& submat = *(MyNearFieldMats[b]);
+        std::unique_ptr<HBlock<T>> block(hblock.restriction(submat.nb_rows(),submat.nb_cols(),submat.get_offset_i(),submat.get_offset_j()));
+        std::fill_n(submat.data(),std::size_t(submat.nb_rows())*submat.nb_cols(),0);
+        block->add_to_dense(submat.data(),submat.nb_rows());
+    }
+    for (int b=0;b<MyFarFieldMats.size();b++){
+        LowRankMatrix<T,ClusterImpl>& lrmat = *(MyFarFieldMats[b]);
+        std::unique_ptr<HBlock<T>> block(hblock.restriction(lrmat.nb_rows(),lrmat.nb_cols(),lrmat.get_offset_i(),lrmat.get_offset_j()));
+        int k;
+        std::vector<T> U, V;
+        block->get_lowrank(k,U,V,epsilon);
+        lrmat.set_factors(k,U.data(),V.data());
+    }
+
+    // Ranks changed, workspaces and row partition are computed again
+    workspace_mu = 0;
+    thread_workspaces.clear();
+    ReserveWorkspaces(1);
+}
+
+template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
+template<typename U>
+void HMatrix<T, LowRankMatrix, ClusterImpl>::AllGather(const std::vector<U>& in, std::vector<U>& out, MPI_Datatype type, MPI_Comm comm){
+    int sizeWorld;
+    MPI_Comm_size(comm, &sizeWorld);
+    int size = in.size();
+    std::vector<int> counts(sizeWorld), displs(sizeWorld,0);
+    MPI_Allgather(&size,1,MPI_INT,counts.data(),1,MPI_INT,comm);
+    for (int i=1;i<sizeWorld;i++){
+        displs[i] = displs[i-1]+counts[i-1];
+    }
+    out.resize(displs.back()+counts.back());
+    MPI_Allgatherv(in.data(),size,type,out.data(),counts.data(),displs.data(),type,comm);
+}
+
 template<typename T, template<typename,typename> class LowRankMatrix, class ClusterImpl>
 void HMatrix<T, LowRankMatrix, ClusterImpl>::apply_dirichlet(const std::vector<int>& boundary){
     // Renum
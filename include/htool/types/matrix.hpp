@@ -7,11 +7,21 @@
 #include <fstream>
 #include <vector>
 #include <iterator>
+#include <memory>
+#include <limits>
+#include <type_traits>
 #include "../wrappers/wrapper_blas.hpp"
 #include "vector.hpp"
+#include "half.hpp"
 
 namespace htool {
 
+// Complex conjugate, which is the identity for real scalars
+template<typename T>
+T conj_if_complex(const T& a){return a;}
+
+template<typename T>
+std::complex<T> conj_if_complex(const std::complex<T>& a){return std::conj(a);}
 
 //=================================================================//
 //                         CLASS MATRIX
@@ -55,6 +65,26 @@ public:
         return mat;
     }
 
+    //! ### Coefficients of a row
+    /*!
+    Puts the coefficients (_i_,_cols_[k]) for 0<=k<_nb_cols_ in _out_, without allocation.
+    The default implementation calls get_coef for each coefficient, it can be overloaded to compute a whole row at once.
+    */
+    virtual void copy_row(const int& i, const int* const cols, const int& nb_cols, T* const out) const{
+        for (int k=0; k<nb_cols; k++)
+        out[k] = this->get_coef(i, cols[k]);
+    }
+
+    //! ### Coefficients of a column
+    /*!
+    Puts the coefficients (_rows_[k],_j_) for 0<=k<_nb_rows_ in _out_, without allocation.
+    The default implementation calls get_coef for each coefficient, it can be overloaded to compute a whole column at once.
+    */
+    virtual void copy_col(const int& j, const int* const rows, const int& nb_rows, T* const out) const{
+        for (int k=0; k<nb_rows; k++)
+        out[k] = this->get_coef(rows[k], j);
+    }
+
 
     //! ### Access to number of rows
     /*!
@@ -77,7 +107,8 @@ class Matrix: public IMatrix<T>{
 
 protected:
 
-    std::vector<T> mat;
+    std::vector<T> mat; // entries owned by the matrix, empty if the matrix is a view
+    T* mat_ptr;         // entries in column-major order, either mat.data() or external memory
 
 
 public:
@@ -86,7 +117,7 @@ public:
     /*!
     Initializes the matrix to the size 0*0.
     */
-    Matrix():IMatrix<T>(0,0){}
+    Matrix():IMatrix<T>(0,0),mat_ptr(nullptr){}
 
 
     //! ### Another constructor
@@ -96,12 +127,16 @@ public:
     */
     Matrix(const int& nbr, const int& nbc): IMatrix<T>(nbr,nbc){
         this->mat.resize(nbr*nbc,0);
+        this->mat_ptr = this->mat.data();
     }
 
     //! ### Copy constructor
     /*!
+    The copy always owns its entries, even if _A_ is a view.
     */
-    Matrix(const Matrix& A) = default;
+    Matrix(const Matrix& A): IMatrix<T>(A), mat(A.mat_ptr,A.mat_ptr+A.nr*A.nc){
+        this->mat_ptr = this->mat.data();
+    }
 
     //! ### Copy assignement operator with matrix input argument
     /*!
@@ -111,7 +146,7 @@ public:
     */
     void operator=(const Matrix& A){
         assert( this->nr==A.nr && this->nc==A.nc);
-        this->mat = A.mat;
+        std::copy_n(A.mat_ptr,A.nr*A.nc,this->mat_ptr);
     }
 
     //! ### Copy assignement operator with scalar input argument
@@ -120,14 +155,18 @@ public:
     to the input value _z_.
     */
     void operator=(const T& z){
-        std::fill (this->mat.begin(), this->mat.end(),z);
+        std::fill_n(this->mat_ptr,this->nr*this->nc,z);
     }
 
     //! ### Move constructor
     /*!
     Initializes the matrix to the size 0*0.
     */
-    Matrix(Matrix&&) = default;
+    Matrix(Matrix&& A): IMatrix<T>(A), mat(std::move(A.mat)), mat_ptr(A.mat_ptr){
+        A.mat_ptr = nullptr;
+        A.nr = 0;
+        A.nc = 0;
+    }
 
     //! ### Copy assignement operator with matrix input argument
     /*!
@@ -137,13 +176,33 @@ public:
     */
     Matrix& operator=(Matrix&& A){
         assert( this->nr==A.nr && this->nc==A.nc);
-        this->mat = std::move(A.mat);
-        this->nr  = std::move(A.nr);
-        this->nc  = std::move(A.nc);
+        this->mat     = std::move(A.mat);
+        this->mat_ptr = A.mat_ptr;
+        this->nr      = std::move(A.nr);
+        this->nc      = std::move(A.nc);
+        A.mat_ptr = nullptr;
 
         return *this;
     }
 
+    //! ### View on external memory
+    /*!
+    The matrix becomes a _nbr_ x _nbc_ view on the column-major
+    entries pointed by _ptr_, without copy nor ownership:
+    the memory has to outlive the matrix (or the next call to _resize_).
+    */
+    void assign(const int& nbr, const int& nbc, T* const ptr){
+        std::vector<T>().swap(this->mat);
+        this->mat_ptr = ptr;
+        this->nr = nbr;
+        this->nc = nbc;
+    }
+
+    //! ### Is the matrix a view on external memory
+    /*!
+    */
+    bool is_view() const {return this->mat_ptr!=this->mat.data();}
+
 
     //! ### Access operator
     /*!
@@ -153,7 +212,7 @@ public:
     */
 
     T get_coef(const int& j, const int& k) const{
-        return this->mat[j+k*this->nr];
+        return this->mat_ptr[j+k*this->nr];
     }
     // SubMatrix<T> get_submatrix(const std::vector<int>& J, const std::vector<int>& K) const
     // {
@@ -183,7 +242,8 @@ public:
     are allowed.
     */
     T& operator()(const int& j, const int& k){
-        return this->mat[j+k*this->nr];
+        assert(this->mat_ptr!=nullptr);
+        return this->mat_ptr[j+k*this->nr];
     }
 
 
@@ -195,7 +255,8 @@ public:
     entries are forbidden.
     */
     const T& operator()(const int& j, const int& k) const {
-        return this->mat[j+k*this->nr];
+        assert(this->mat_ptr!=nullptr);
+        return this->mat_ptr[j+k*this->nr];
     }
 
     //! ### Access operator
@@ -207,9 +268,17 @@ public:
 
     //! ### Access operator
     /*!
+    Entries in column-major order, which must be stored (see SubMatrix::reduce_precision) unless the matrix is empty.
     */
 
-    T *  data() {return this->mat.data();}
+    T *  data() {
+        assert(this->mat_ptr!=nullptr || this->nr*this->nc==0);
+        return this->mat_ptr;
+    }
+    const T *  data() const {
+        assert(this->mat_ptr!=nullptr || this->nr*this->nc==0);
+        return this->mat_ptr;
+    }
 
     //! ### Access operator
     /*!
@@ -221,7 +290,7 @@ public:
     {
         std::vector<T> result;
         result.reserve( length );
-        const T *pos = &mat[start];
+        const T *pos = mat_ptr+start;
         for( int i = 0; i < length; i++ ) {
             result.push_back(*pos);
             pos += stride;
@@ -257,7 +326,7 @@ public:
 
     void set_stridedslice( int start, int length, int stride, const std::vector<T>& a){
         assert(length==a.size());
-        T *pos = &mat[start];
+        T *pos = mat_ptr+start;
         for( int i = 0; i < length; i++ ) {
             *pos=a[i];
             pos += stride;
@@ -289,7 +358,11 @@ public:
     the number of columns is set to _nbc_.
     */
     void resize(const int nbr, const int nbc, T value=0){
+        if (this->is_view()){
+            this->mat.assign(this->mat_ptr,this->mat_ptr+this->nr*this->nc);
+        }
         this->mat.resize(nbr*nbc, value); this->nr = nbr; this->nc = nbc;
+        this->mat_ptr = this->mat.data();
     }
 
     //! ### Matrix-scalar product
@@ -318,7 +391,7 @@ public:
         Matrix R(A.nr,A.nc);
         for (int i=0;i<A.nr;i++){
             for (int j=0;j<A.nc;j++){
-                R(i,j)=this->mat[i+j*this->nr]+A(i,j);
+                R(i,j)=this->mat_ptr[i+j*this->nr]+A(i,j);
             }
         }
         return R;
@@ -333,7 +406,7 @@ public:
         Matrix R(A.nr,A.nc);
         for (int i=0;i<A.nr;i++){
             for (int j=0;j<A.nc;j++){
-                R(i,j)=this->mat[i+j*this->nr]-A(i,j);
+                R(i,j)=this->mat_ptr[i+j*this->nr]-A(i,j);
             }
         }
         return R;
@@ -355,7 +428,7 @@ public:
     Matrix operator*(const Matrix& B) const{
         assert(this->nc==B.nr);
         Matrix R(this->nr,B.nc);
-        this->mvprod(&(B.mat[0]),&(R.mat[0]),B.nc);
+        this->mvprod(B.mat_ptr,R.mat_ptr,B.nc);
         return R;
     }
 
@@ -373,7 +446,7 @@ public:
             char n='N';
             int incx =1;
             int incy = 1;
-            Blas<T>::gemv(&n, &nr , &nc, &alpha, &(this->mat[0]) , &lda, in, &incx, &beta, out, &incy);
+            Blas<T>::gemv(&n, &nr , &nc, &alpha, this->mat_ptr , &lda, in, &incx, &beta, out, &incy);
         }
         else{
             char transa ='N';
@@ -383,82 +456,41 @@ public:
             int K = nc;
             int ldb = nc;
             int ldc = nr;
-            Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, &(this->mat[0]),
+            Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, this->mat_ptr,
             &lda, in , &ldb, &beta, out,&ldc);
         }
     }
 
     //! ### Special mvprod
     /*!
+    out = op(A) in, with the mu vectors interleaved in in and out (row-major), op being 'N', 'T' or 'C' as in BLAS.
+    With several vectors, op='C' and complex entries, the product is computed with one gemm as the conjugate of conj(in)*A,
+    conj(in) being stored in work, which has row_major_workspace_size(mu,op) entries.
     */
-    void mvprod_row_major(const T* const in, T* const out, const int& mu, char op = 'N') const{
-        int nr = this->nr;
-        int nc = this->nc;
-        T alpha = 1;
-        T beta =0;
-        int lda =  nr;
-
-        if (mu==1){
-            int incx =1;
-            int incy = 1;
-            Blas<T>::gemv(&op, &nr , &nc, &alpha, &(this->mat[0]) , &lda, in, &incx, &beta, out, &incy);
-        }
-        else{
-            int lda =  mu;
-            char transa ='N';
-            char transb ='T';
-            int M = mu;
-            int N = nr;
-            int K = nc;
-            int ldb =  nr;
-            int ldc = mu;
-
-            if (op=='C'){
-                transb='N';
-                N=nc;
-                K=nr;
-            }
+    void mvprod_row_major(const T* const in, T* const out, const int& mu, char op, T* const work) const{
+        row_major_product(in,out,mu,op,0,work);
+    }
 
-            Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, in,
-                &lda, &(this->mat[0]), &ldb, &beta, out,&ldc);
-            }
+    void mvprod_row_major(const T* const in, T* const out, const int& mu, char op = 'N') const{
+        std::vector<T> work(row_major_workspace_size(mu,op));
+        row_major_product(in,out,mu,op,0,work.data());
     }
 
     //! ### Special add_mvprod
     /*!
+    out += op(A) in, see mvprod_row_major.
     */
-    void add_mvprod_row_major(const T* const in, T* const out, const int& mu, char op='N') const{
-        int nr = this->nr;
-        int nc = this->nc;
-        T alpha = 1;
-        T beta =1;
-
-
-        if (mu==1){
-            int lda =  nr;
-            int incx =1;
-            int incy = 1;
-            Blas<T>::gemv(&op, &nr , &nc, &alpha, &(this->mat[0]) , &lda, in, &incx, &beta, out, &incy);
-        }
-        else{
-            int lda =  mu;
-            char transa ='N';
-            char transb ='T';
-            int M = mu;
-            int N = nr;
-            int K = nc;
-            int ldb =  nr;
-            int ldc = mu;
-
-            if (op=='C'){
-                transb='N';
-                N=nc;
-                K=nr;
-            }
+    void add_mvprod_row_major(const T* const in, T* const out, const int& mu, char op, T* const work) const{
+        row_major_product(in,out,mu,op,1,work);
+    }
 
+    void add_mvprod_row_major(const T* const in, T* const out, const int& mu, char op='N') const{
+        std::vector<T> work(row_major_workspace_size(mu,op));
+        row_major_product(in,out,mu,op,1,work.data());
+    }
 
-            Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, in, &lda, &(this->mat[0]), &ldb, &beta, out,&ldc);
-        }
+    int row_major_workspace_size(int mu, char op) const {
+        return (mu>1 && op=='C' && !std::is_same<T,underlying_type<T>>::value) ? this->nr*mu : 0;
     }
 
     void add_mvprod_row_major_sym(const T* const in, T* const out, const int& mu) const{
@@ -473,7 +505,7 @@ public:
             int lda =  nr;
             int incx =1;
             int incy = 1;
-            Blas<T>::symv(&UPLO, &nr, &alpha, &(this->mat[0]), &lda,in, &incx, &beta, out, &incy);
+            Blas<T>::symv(&UPLO, &nr, &alpha, this->mat_ptr, &lda,in, &incx, &beta, out, &incy);
         }
         else{
             int lda =  nr;
@@ -483,13 +515,13 @@ public:
             int ldb =  mu;
             int ldc = mu;
 
-            Blas<T>::symm(&side, &UPLO, &M, &N, &alpha, &(this->mat[0]),&lda, in, &ldb, &beta, out,&ldc);
+            Blas<T>::symm(&side, &UPLO, &M, &N, &alpha, this->mat_ptr,&lda, in, &ldb, &beta, out,&ldc);
 
         }
     }
 
     friend std::ostream& operator<<(std::ostream& out, const Matrix& m){
-        if ( !(m.mat.empty()) ) {
+        if ( m.nr*m.nc>0 ) {
             std::cout<< m.nr << " " << m.nc <<std::endl;
             for (int i=0;i<m.nr;i++){
                 std::vector<T> row = m.get_row(i);
@@ -507,11 +539,35 @@ public:
     of maximal modulus in the matrix _A_.
     */
     friend std::pair<int,int> argmax(const Matrix<T>& M) {
-        int p = argmax(M.mat);
+        int p = std::max_element(M.mat_ptr,M.mat_ptr+M.nr*M.nc,[](T a, T b){return std::abs(a)<std::abs(b);})-M.mat_ptr;
         return std::pair<int,int> (p% M.nr,(int) p/M.nr);
     }
 
-    //! ### Looking for the entry of maximal modulus
+    //! ### Save a matrix in a stream (bytes)
+    /*!
+    Writes the number of rows, the number of columns and the entries of the matrix in _out_.
+    */
+    void matrix_to_bytes(std::ostream& out) const{
+        int rows = this->nr;
+        int cols = this->nc;
+        out.write((const char*) (&rows), sizeof(int));
+        out.write((const char*) (&cols), sizeof(int));
+        out.write((const char*) mat_ptr, rows*cols*sizeof(T) );
+    }
+
+    //! ### Load a matrix from a stream (bytes)
+    /*!
+    Reads a matrix written by _matrix_to_bytes_ from _in_.
+    */
+    void bytes_to_matrix(std::istream& in){
+        int rows=0, cols=0;
+        in.read((char*) (&rows), sizeof(int));
+        in.read((char*) (&cols), sizeof(int));
+        this->resize(rows,cols);
+        in.read( (char *) mat_ptr , rows*cols*sizeof(T) );
+    }
+
+    //! ### Save a matrix in a file (bytes)
     /*!
     Save a Matrix in a file (bytes)
     */
@@ -523,17 +579,13 @@ public:
             std::cout << "Cannot open file."<<std::endl;
             return 1;
         }
-        int rows = this->nr;
-        int cols = this->nc;
-        out.write((char*) (&rows), sizeof(int));
-        out.write((char*) (&cols), sizeof(int));
-        out.write((char*) &(mat[0]), rows*cols*sizeof(T) );
+        matrix_to_bytes(out);
 
         out.close();
         return 0;
     }
 
-    //! ### Looking for the entry of maximal modulus
+    //! ### Load a matrix from a file (bytes)
     /*!
     Load a matrix from a file (bytes)
     */
@@ -545,14 +597,7 @@ public:
             std::cout << "Cannot open file."<<std::endl;
             return 1;
         }
-
-        int rows=0, cols=0;
-        in.read((char*) (&rows), sizeof(int));
-        in.read((char*) (&cols), sizeof(int));
-        mat.resize(rows*cols);
-        this->nr=rows;
-        this->nc=cols;
-        in.read( (char *) &(mat[0]) , rows*cols*sizeof(T) );
+        bytes_to_matrix(in);
 
         in.close();
         return 0;
@@ -609,7 +654,44 @@ public:
         return 0;
     }
 
+private:
+    // out = beta out + op(A) in, see mvprod_row_major
+    void row_major_product(const T* const in, T* const out, const int& mu, char op, const T& beta, T* const work) const{
+        int nr = this->nr;
+        int nc = this->nc;
+        T alpha = 1;
 
+        if (mu==1){
+            int lda =  nr;
+            int incx =1;
+            int incy = 1;
+            Blas<T>::gemv(&op, &nr , &nc, &alpha, this->mat_ptr , &lda, in, &incx, &beta, out, &incy);
+            return;
+        }
+
+        // out = in A^T if op='N', out = in A if op='T'
+        int lda =  mu;
+        char transa ='N';
+        char transb = (op=='N') ? 'T' : 'N';
+        int M = mu;
+        int N = (op=='N') ? nr : nc;
+        int K = (op=='N') ? nc : nr;
+        int ldb =  nr;
+        int ldc = mu;
+
+        if (op=='C' && !std::is_same<T,underlying_type<T>>::value){
+            // out = in conj(A) = conj(conj(in) A)
+            std::transform(in,in+nr*mu,work,[](const T& a){return conj_if_complex(a);});
+            if (beta!=T(0)){
+                std::transform(out,out+nc*mu,out,[](const T& a){return conj_if_complex(a);});
+            }
+            Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, work, &lda, this->mat_ptr, &ldb, &beta, out,&ldc);
+            std::transform(out,out+nc*mu,out,[](const T& a){return conj_if_complex(a);});
+            return;
+        }
+
+        Blas<T>::gemm(&transa, &transb, &M, &N, &K, &alpha, in, &lda, this->mat_ptr, &ldb, &beta, out,&ldc);
+    }
 };
 
 //! ### Computation of the Frobenius norm
@@ -632,39 +714,64 @@ double normFrob (const Matrix<T>& A){
 //================================//
 template<typename T>
 class SubMatrix : public Matrix<T>{
-    // TODO: remove ir and ic
-    std::vector<int> ir;
-    std::vector<int> ic;
+    // Row and column indices are ranges [ir_start,ir_start+nr) and [ic_start,ic_start+nc) of shared index vectors (e.g. cluster permutations)
+    std::shared_ptr<const std::vector<int>> ir;
+    std::shared_ptr<const std::vector<int>> ic;
+    int ir_start;
+    int ic_start;
     int offset_i;
     int offset_j;
 
+    // Entries in reduced precision, used instead of the entries of the matrix depending on the precision of the block:
+    // in single precision, or in half precision with one scale per column
+    Precision precision = Precision::WorkingPrecision;
+    Matrix<single_precision_type<T>> mat_single;
+    std::vector<std::uint16_t> mat_half;
+    std::vector<float> scales;
+    static const int nb_parts = sizeof(T)/sizeof(underlying_type<T>);
+
 public:
-    SubMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0) : Matrix<T>(ir0.size(),ic0.size()), ir(ir0), ic(ic0),offset_i(0), offset_j(0) {}
+    SubMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0) : Matrix<T>(ir0.size(),ic0.size()), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(0), offset_j(0) {}
+
+    SubMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, const int& offset_i0, const int& offset_j0) : Matrix<T>(ir0.size(),ic0.size()), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(offset_i0), offset_j(offset_j0) {}
 
-    SubMatrix(const std::vector<int>& ir0, const std::vector<int>& ic0, const int& offset_i0, const int& offset_j0) : Matrix<T>(ir0.size(),ic0.size()), ir(ir0), ic(ic0),offset_i(offset_i0), offset_j(offset_j0) {}
+    SubMatrix(const IMatrix<T>& mat0, const std::vector<int>& ir0, const std::vector<int>& ic0): Matrix<T>(mat0.get_submatrix(ir0,ic0)), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(0), offset_j(0) {}
 
-    SubMatrix(const IMatrix<T>& mat0, const std::vector<int>& ir0, const std::vector<int>& ic0): Matrix<T>(ir0.size(),ic0.size()), ir(ir0), ic(ic0), offset_i(0),offset_j(0) {
+    SubMatrix( const IMatrix<T>& mat0, const std::vector<int>& ir0, const std::vector<int>& ic0, const int& offset_i0, const int& offset_j0): Matrix<T>(mat0.get_submatrix(ir0,ic0)), ir(std::make_shared<const std::vector<int>>(ir0)), ic(std::make_shared<const std::vector<int>>(ic0)), ir_start(0), ic_start(0), offset_i(offset_i0), offset_j(offset_j0) {}
 
-        // Matrix<T> test ;
-        // std::cout << (&test)->mat << std::endl;
-        *this = mat0.get_submatrix(ir0,ic0);
+    // Indices given by nr0 (resp. nc0) entries of ir0 (resp. ic0) starting from ir_start0 (resp. ic_start0), without copy
+    SubMatrix(const std::shared_ptr<const std::vector<int>>& ir0, int ir_start0, int nr0, const std::shared_ptr<const std::vector<int>>& ic0, int ic_start0, int nc0, const int& offset_i0, const int& offset_j0) : Matrix<T>(nr0,nc0), ir(ir0), ic(ic0), ir_start(ir_start0), ic_start(ic_start0), offset_i(offset_i0), offset_j(offset_j0) {}
+
+    // Same, as a view on the column-major entries pointed by ptr, without allocation (see Matrix::assign)
+    SubMatrix(const std::shared_ptr<const std::vector<int>>& ir0, int ir_start0, int nr0, const std::shared_ptr<const std::vector<int>>& ic0, int ic_start0, int nc0, const int& offset_i0, const int& offset_j0, T* const ptr) : Matrix<T>(), ir(ir0), ic(ic0), ir_start(ir_start0), ic_start(ic_start0), offset_i(offset_i0), offset_j(offset_j0) {
+        this->assign(nr0,nc0,ptr);
     }
 
-    SubMatrix( const IMatrix<T>& mat0, const std::vector<int>& ir0, const std::vector<int>& ic0, const int& offset_i0, const int& offset_j0): Matrix<T>(ir0.size(),ic0.size()), ir(ir0), ic(ic0) {
+    SubMatrix(const IMatrix<T>& mat0, const std::shared_ptr<const std::vector<int>>& ir0, int ir_start0, int nr0, const std::shared_ptr<const std::vector<int>>& ic0, int ic_start0, int nc0, const int& offset_i0, const int& offset_j0) : Matrix<T>(mat0.get_submatrix(std::vector<int>(ir0->begin()+ir_start0,ir0->begin()+ir_start0+nr0),std::vector<int>(ic0->begin()+ic_start0,ic0->begin()+ic_start0+nc0))), ir(ir0), ic(ic0), ir_start(ir_start0), ic_start(ic_start0), offset_i(offset_i0), offset_j(offset_j0) {}
 
-        *this = mat0.get_submatrix(ir0,ic0);
-        offset_i=offset_i0;
-        offset_j=offset_j0;
+    SubMatrix(const SubMatrix& m): Matrix<T>(m.precision==Precision::WorkingPrecision ? Matrix<T>(m) : Matrix<T>()), ir(m.ir), ic(m.ic), ir_start(m.ir_start), ic_start(m.ic_start), offset_i(m.offset_i), offset_j(m.offset_j), precision(m.precision), mat_single(m.mat_single), mat_half(m.mat_half), scales(m.scales) {
+        this->nr = m.nr;
+        this->nc = m.nc;
     }
 
-    SubMatrix(const SubMatrix& m) {
-        this->mat = m.mat;
-        this->ir=m.ir;
-        this->ic=m.ic;
-        this->offset_i=m.offset_i;
-        this->offset_j=m.offset_j;
-        this->nr=m.nr;
-        this->nc=m.nc;
+    SubMatrix& operator=(const SubMatrix& m){
+        if (precision==Precision::WorkingPrecision && m.precision==Precision::WorkingPrecision){
+            Matrix<T>::operator=(m);
+        }
+        else{
+            Matrix<T>::operator=(SubMatrix(m));
+        }
+        ir         = m.ir;
+        ic         = m.ic;
+        ir_start   = m.ir_start;
+        ic_start   = m.ic_start;
+        offset_i   = m.offset_i;
+        offset_j   = m.offset_j;
+        precision  = m.precision;
+        mat_single = m.mat_single;
+        mat_half   = m.mat_half;
+        scales     = m.scales;
+        return *this;
     }
 
     // Mostly same operators as in Matrix, need CRTP to factorize
@@ -692,12 +799,138 @@ public:
         return A*a;
     }
     // Getters
-    std::vector<int> get_ir() const{ return this->ir;}
-    std::vector<int> get_ic() const{ return this->ic;}
+    const int* get_ir() const{ return this->ir->data()+this->ir_start;}
+    const int* get_ic() const{ return this->ic->data()+this->ic_start;}
     int get_offset_i() const{ return this->offset_i;}
     int get_offset_j() const{ return this->offset_j;}
     void set_offset_i(int offset) {  this->offset_i=offset;}
     void set_offset_j(int offset) {  this->offset_j=offset;}
+    Precision get_precision() const {return this->precision;}
+
+    // Entries are decoded if they are stored in reduced precision, they can then no longer be accessed with operator()
+    T get_coef(const int& j, const int& k) const{
+        T a;
+        switch (precision){
+            case Precision::SinglePrecision:
+                return T(mat_single(j,k));
+            case Precision::HalfPrecision:
+                unpack_half(mat_half.data()+(j+k*this->nr)*nb_parts,1,scales[k],&a);
+                return a;
+            default:
+                return Matrix<T>::get_coef(j,k);
+        }
+    }
+
+    // Entries in column-major order in out, with leading dimension ld (nr by default), decoded if they are stored in
+    // reduced precision; dense blocks which may be compressed must be read this way or with get_coef
+    void get_whole_matrix(T* const out, int ld=-1) const{
+        int nr = this->nr;
+        int nc = this->nc;
+        ld = (ld<0) ? nr : ld;
+        for (int k=0;k<nc;k++){
+            if (precision==Precision::SinglePrecision){
+                std::transform(mat_single.data()+k*nr,mat_single.data()+(k+1)*nr,out+k*ld,[](const single_precision_type<T>& a){return T(a);});
+            }
+            else if (precision==Precision::HalfPrecision){
+                unpack_half(mat_half.data()+k*nr*nb_parts,nr,scales[k],out+k*ld);
+            }
+            else{
+                std::copy_n(this->mat_ptr+k*nr,nr,out+k*ld);
+            }
+        }
+    }
+
+    // Storage of the entries in reduced precision: in half precision if the relative error of the storage of each column
+    // is below epsilon, otherwise in single precision if it is below epsilon, so that the error on the block is below
+    // epsilon in Frobenius norm. Entries in the working precision are released, and the new precision is returned
+    Precision reduce_precision(double epsilon){
+        int nr = this->nr;
+        int nc = this->nc;
+        if (nr*nc==0 || precision!=Precision::WorkingPrecision){
+            return precision;
+        }
+        if (pack_half_relative_error(nr*nb_parts)<=epsilon){
+            mat_half.resize(nr*nc*nb_parts);
+            scales.resize(nc);
+            for (int k=0;k<nc;k++){
+                scales[k] = pack_half(this->mat_ptr+k*nr,nr,mat_half.data()+k*nr*nb_parts);
+            }
+            precision = Precision::HalfPrecision;
+        }
+        else if (!std::is_same<T,single_precision_type<T>>::value && std::numeric_limits<underlying_type<single_precision_type<T>>>::epsilon()/2<=epsilon){
+            mat_single.resize(nr,nc);
+            std::transform(this->mat_ptr,this->mat_ptr+nr*nc,mat_single.data(),[](const T& a){return single_precision_type<T>(a);});
+            precision = Precision::SinglePrecision;
+        }
+        else{
+            return precision;
+        }
+        std::vector<T>().swap(this->mat);
+        this->mat_ptr = nullptr;
+        return precision;
+    }
+
+    // Size of the workspace needed by products with one vector: with entries in reduced precision, room for the input
+    // and the output in single precision, and for the entries unpacked in single precision if they are stored in half precision;
+    // otherwise, with complex entries, room for the conjugated input of products with A^H (see Matrix::mvprod_row_major)
+    int workspace_size() const {
+        switch (precision){
+            case Precision::SinglePrecision:
+                return single_precision_workspace_size<T>(this->nr+this->nc);
+            case Precision::HalfPrecision:
+                return single_precision_workspace_size<T>(this->nr*this->nc+this->nr+this->nc);
+            default:
+                return std::is_same<T,underlying_type<T>>::value ? 0 : this->nr;
+        }
+    }
+
+    void add_mvprod_row_major(const T* const in, T* const out, const int& mu, char op='N') const{
+        if (precision==Precision::WorkingPrecision){
+            Matrix<T>::add_mvprod_row_major(in,out,mu,op);
+        }
+        else{
+            std::vector<T> work(this->workspace_size()*mu);
+            add_mvprod_row_major(in,out,mu,op,work.data());
+        }
+    }
+
+    // Same with a workspace of size at least workspace_size()*mu provided by the caller;
+    // with entries in reduced precision, the product is computed in single precision and added to out
+    void add_mvprod_row_major(const T* const in, T* const out, const int& mu, char op, T* const work) const{
+        if (precision==Precision::WorkingPrecision){
+            Matrix<T>::add_mvprod_row_major(in,out,mu,op,work);
+            return;
+        }
+        int size_in  = (op=='N') ? this->nc : this->nr;
+        int size_out = (op=='N') ? this->nr : this->nc;
+        single_precision_type<T>* buffer = reinterpret_cast<single_precision_type<T>*>(work);
+        const Matrix<single_precision_type<T>>* reduced = &mat_single;
+        Matrix<single_precision_type<T>> unpacked;
+        if (precision==Precision::HalfPrecision){
+            for (int k=0;k<this->nc;k++){
+                unpack_half(mat_half.data()+k*this->nr*nb_parts,this->nr,scales[k],buffer+k*this->nr);
+            }
+            unpacked.assign(this->nr,this->nc,buffer);
+            reduced = &unpacked;
+            buffer += this->nr*this->nc;
+        }
+        single_precision_type<T>* const in_single  = buffer;
+        single_precision_type<T>* const out_single = in_single+size_in*mu;
+        if (op=='C'){
+            // A^H in = conj(A^T conj(in)), without workspace in the product
+            std::transform(in,in+size_in*mu,in_single,[](const T& a){return single_precision_type<T>(conj_if_complex(a));});
+            reduced->mvprod_row_major(in_single,out_single,mu,'T');
+            for (int i=0;i<size_out*mu;i++){
+                out[i] += T(conj_if_complex(out_single[i]));
+            }
+            return;
+        }
+        std::transform(in,in+size_in*mu,in_single,[](const T& a){return single_precision_type<T>(a);});
+        reduced->mvprod_row_major(in_single,out_single,mu,op);
+        for (int i=0;i<size_out*mu;i++){
+            out[i] += T(out_single[i]);
+        }
+    }
 
 };
 } // namespace
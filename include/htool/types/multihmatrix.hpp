@@ -130,7 +130,12 @@ void MultiHMatrix<T,MultiLowRankMatrix,ClusterImpl>::build(MultiIMatrix<T>& mat,
 
 	// Construction arbre des blocs
 	time = MPI_Wtime();
-	Block<ClusterImpl>* B = HMatrices[0].BuildBlockTree(cluster_tree_t->get_root(),cluster_tree_s->get_root());
+	Block<ClusterImpl>* B=nullptr;
+	#if _OPENMP
+	#pragma omp parallel
+	#pragma omp single
+	#endif
+	B = HMatrices[0].BuildBlockTree(cluster_tree_t->get_root(),cluster_tree_s->get_root());
 	if (B != NULL) HMatrices[0].Tasks.push_back(B);
 	mytimes[1] = MPI_Wtime() - time;
 
@@ -156,6 +161,13 @@ void MultiHMatrix<T,MultiLowRankMatrix,ClusterImpl>::build(MultiIMatrix<T>& mat,
 		HMatrices[l].local_offset=local_offset;
 	}
 
+	// Diagonal blocks, workspaces and halo exchange of products
+	for (int l=0;l<nb_hmatrix;l++){
+		HMatrices[l].SetDiagBlocks();
+		HMatrices[l].ReserveWorkspaces(1);
+		HMatrices[l].ComputeHaloExchange();
+	}
+
 
 	// Infos
 	for (int l=0;l<nb_hmatrix;l++){
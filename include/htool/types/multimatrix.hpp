@@ -49,6 +49,38 @@ public:
         return mat;
     }
 
+    //! ### Coefficients of a row
+    /*!
+    Puts the coefficients (_i_,_cols_[k]) of the _l_th matrix in _out_[k+l*_nb_cols_] for 0<=k<_nb_cols_,
+    i.e. _out_ is a _nb_cols_ x _nm_ matrix in column-major order.
+    The default implementation calls get_coefs for each coefficient, it can be overloaded to compute a whole row at once.
+    */
+    virtual void copy_row(const int& i, const int* const cols, const int& nb_cols, T* const out) const{
+        std::vector<T> coefs(nm);
+        for (int k=0; k<nb_cols; k++){
+            coefs=this->get_coefs(i, cols[k]);
+            for (int l=0; l<this->nm; l++){
+                out[k+l*nb_cols] = coefs[l];
+            }
+        }
+    }
+
+    //! ### Coefficients of a column
+    /*!
+    Puts the coefficients (_rows_[k],_j_) of the _l_th matrix in _out_[k+l*_nb_rows_] for 0<=k<_nb_rows_,
+    i.e. _out_ is a _nb_rows_ x _nm_ matrix in column-major order.
+    The default implementation calls get_coefs for each coefficient, it can be overloaded to compute a whole column at once.
+    */
+    virtual void copy_col(const int& j, const int* const rows, const int& nb_rows, T* const out) const{
+        std::vector<T> coefs(nm);
+        for (int k=0; k<nb_rows; k++){
+            coefs=this->get_coefs(rows[k], j);
+            for (int l=0; l<this->nm; l++){
+                out[k+l*nb_rows] = coefs[l];
+            }
+        }
+    }
+
 
     //! ### Access to number of rows
     /*!
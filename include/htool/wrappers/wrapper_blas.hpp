@@ -22,6 +22,8 @@ void    HTOOL_BLAS_F77(C ## symv)(const char*, const int*, const T*, const T*, c
 void    HTOOL_BLAS_F77(C ## symm)(const char*, const char*, const int*, const int*,                         \
                              const T*, const T*, const int*, const T*, const int*,                          \
                              const T*, T*, const int*);                                                     \
+void    HTOOL_BLAS_F77(C ## trsm)(const char*, const char*, const char*, const char*, const int*,           \
+                             const int*, const T*, const T*, const int*, T*, const int*);                   \
 
 #define HTOOL_GENERATE_EXTERN_BLAS_COMPLEX(C, T, B, U)\
 HTOOL_GENERATE_EXTERN_BLAS(B, U)                      \
@@ -77,6 +79,10 @@ struct Blas {
      *  Computes a symmetric scalar-matrix-matrix product. */
     static void symm(const char* const, const char* const, const int* const, const int* const, const K* const, const K* const,
                      const int* const, const K* const, const int* const, const K* const, K* const, const int* const);
+    /* Function: trsm
+     *  Solves a triangular system with multiple right-hand sides. */
+    static void trsm(const char* const, const char* const, const char* const, const char* const, const int* const, const int* const,
+                     const K* const, const K* const, const int* const, K* const, const int* const);
 
 };
 
@@ -124,6 +130,12 @@ inline void Blas<T>::symm(const char* const side, const char* const uplo, const
                           T* const c, const int* const ldc) {                                                \
     HTOOL_BLAS_F77(C ## symm)(side, uplo, m, n, alpha, a, lda, b, ldb, beta, c, ldc);                             \
 }                                                                                                            \
+template<>                                                                                                   \
+inline void Blas<T>::trsm(const char* const side, const char* const uplo, const char* const transa,          \
+                          const char* const diag, const int* const m, const int* const n, const T* const alpha, \
+                          const T* const a, const int* const lda, T* const b, const int* const ldb) {        \
+    HTOOL_BLAS_F77(C ## trsm)(side, uplo, transa, diag, m, n, alpha, a, lda, b, ldb);                          \
+}                                                                                                            \
 
 # define HTOOL_GENERATE_BLAS_COMPLEX(C, T, B,U)      \
 HTOOL_GENERATE_BLAS(C,T)                             \
@@ -14,6 +14,18 @@ namespace htool {
     };
     template<class T>
     using underlying_type = typename underlying_type_spec<T>::type;
+
+    // Scalar type of the same kind in single precision
+    template<class T>
+    struct single_precision_type_spec {
+        typedef float type;
+    };
+    template<class T>
+    struct single_precision_type_spec<std::complex<T>> {
+        typedef std::complex<float> type;
+    };
+    template<class T>
+    using single_precision_type = typename single_precision_type_spec<T>::type;
 }
 
 
@@ -28,7 +40,19 @@ namespace htool {
 void HTOOL_LAPACK_F77(B ## gesvd)(const char*, const char*, const int*, const int*, U*, const int*, U*, U*,         \
                           const int*, U*, const int*, U*, const int*, int*);                                 \
 void HTOOL_LAPACK_F77(C ## gesvd)(const char*, const char*, const int*, const int*, T*, const int*, U*, T*,         \
-                          const int*, T*, const int*, T*, const int*, U*, int*);     
+                          const int*, T*, const int*, T*, const int*, U*, int*);                             \
+void HTOOL_LAPACK_F77(B ## gesdd)(const char*, const int*, const int*, U*, const int*, U*, U*, const int*, U*,    \
+                          const int*, U*, const int*, int*, int*);                                           \
+void HTOOL_LAPACK_F77(C ## gesdd)(const char*, const int*, const int*, T*, const int*, U*, T*, const int*, T*,    \
+                          const int*, T*, const int*, U*, int*, int*);                                       \
+void HTOOL_LAPACK_F77(B ## geqrf)(const int*, const int*, U*, const int*, U*, U*, const int*, int*);           \
+void HTOOL_LAPACK_F77(C ## geqrf)(const int*, const int*, T*, const int*, T*, T*, const int*, int*);           \
+void HTOOL_LAPACK_F77(B ## orgqr)(const int*, const int*, const int*, U*, const int*, const U*, U*,           \
+                          const int*, int*);                                                                 \
+void HTOOL_LAPACK_F77(C ## ungqr)(const int*, const int*, const int*, T*, const int*, const T*, T*,           \
+                          const int*, int*);                                                                 \
+void HTOOL_LAPACK_F77(B ## getrf)(const int*, const int*, U*, const int*, int*, int*);                        \
+void HTOOL_LAPACK_F77(C ## getrf)(const int*, const int*, T*, const int*, int*, int*);
 
 #ifndef _MKL_H_
 # ifdef __cplusplus
@@ -55,6 +79,18 @@ struct Lapack {
     /* Function: gesvd
      *  computes the singular value decomposition (SVD). */
     static void gesvd(const char*, const char*, const int*, const int*, K*, const int*, underlying_type<K>*, K*, const int*, K*, const int*, K*, const int*, underlying_type<K>*, int*);
+    /* Function: gesdd
+     *  computes the singular value decomposition (SVD) with a divide and conquer algorithm. */
+    static void gesdd(const char*, const int*, const int*, K*, const int*, underlying_type<K>*, K*, const int*, K*, const int*, K*, const int*, underlying_type<K>*, int*, int*);
+    /* Function: geqrf
+     *  computes a QR factorization of a general rectangular matrix. */
+    static void geqrf(const int*, const int*, K*, const int*, K*, K*, const int*, int*);
+    /* Function: orgqr
+     *  generates the explicit unitary factor Q of a QR factorization computed by geqrf. */
+    static void orgqr(const int*, const int*, const int*, K*, const int*, const K*, K*, const int*, int*);
+    /* Function: getrf
+     *  computes an LU factorization of a general matrix with partial pivoting. */
+    static void getrf(const int*, const int*, K*, const int*, int*, int*);
 };
 
 
@@ -71,6 +107,46 @@ inline void Lapack<T>::gesvd(const char* jobu, const char* jobvt, const int* m,
                             T* work, const int* lwork, U* rwork, int* info) {                                \
     HTOOL_LAPACK_F77(C ## gesvd)(jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, rwork, info);  \
 }                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<U>::gesdd(const char* jobz, const int* m, const int* n, U* a, const int* lda, U* s,        \
+                            U* u, const int* ldu, U* vt, const int* ldvt, U* work, const int* lwork, U*,     \
+                            int* iwork, int* info) {                                                         \
+    HTOOL_LAPACK_F77(B ## gesdd)(jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, iwork, info);         \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<T>::gesdd(const char* jobz, const int* m, const int* n, T* a, const int* lda, U* s,        \
+                            T* u, const int* ldu, T* vt, const int* ldvt, T* work, const int* lwork,         \
+                            U* rwork, int* iwork, int* info) {                                               \
+    HTOOL_LAPACK_F77(C ## gesdd)(jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, rwork, iwork, info);  \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<U>::geqrf(const int* m, const int* n, U* a, const int* lda, U* tau, U* work,              \
+                            const int* lwork, int* info) {                                                   \
+    HTOOL_LAPACK_F77(B ## geqrf)(m, n, a, lda, tau, work, lwork, info);                                      \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<T>::geqrf(const int* m, const int* n, T* a, const int* lda, T* tau, T* work,              \
+                            const int* lwork, int* info) {                                                   \
+    HTOOL_LAPACK_F77(C ## geqrf)(m, n, a, lda, tau, work, lwork, info);                                      \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<U>::orgqr(const int* m, const int* n, const int* k, U* a, const int* lda, const U* tau,   \
+                            U* work, const int* lwork, int* info) {                                          \
+    HTOOL_LAPACK_F77(B ## orgqr)(m, n, k, a, lda, tau, work, lwork, info);                                   \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<T>::orgqr(const int* m, const int* n, const int* k, T* a, const int* lda, const T* tau,   \
+                            T* work, const int* lwork, int* info) {                                          \
+    HTOOL_LAPACK_F77(C ## ungqr)(m, n, k, a, lda, tau, work, lwork, info);                                   \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<U>::getrf(const int* m, const int* n, U* a, const int* lda, int* ipiv, int* info) {       \
+    HTOOL_LAPACK_F77(B ## getrf)(m, n, a, lda, ipiv, info);                                                  \
+}                                                                                                            \
+template<>                                                                                                   \
+inline void Lapack<T>::getrf(const int* m, const int* n, T* a, const int* lda, int* ipiv, int* info) {       \
+    HTOOL_LAPACK_F77(C ## getrf)(m, n, a, lda, ipiv, info);                                                  \
+}                                                                                                            \
 
 
 HTOOL_GENERATE_LAPACK_COMPLEX(c, std::complex<float>, s, float)
@@ -0,0 +1,101 @@
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+template<typename Cluster_type>
+bool test_distributed_cluster(const vector<R3>& p, const vector<double>& r, const vector<int>& tab, const vector<double>& g, int nb_sons){
+    bool test = 0;
+
+    Cluster_type t;
+    SetDistributedClustering(false);
+    t.build(p,r,tab,g,nb_sons);
+
+    Cluster_type t_distributed;
+    SetDistributedClustering(true);
+    t_distributed.build(p,r,tab,g,nb_sons);
+    SetDistributedClustering(false);
+
+    // Same tree
+    std::stack<Cluster_type const *> s_1;
+    std::stack<Cluster_type const *> s_2;
+    s_1.push(&t);
+    s_2.push(&t_distributed);
+    int nb_nodes = 0;
+    while (!s_1.empty()){
+        Cluster_type const * curr_1 = s_1.top();
+        Cluster_type const * curr_2 = s_2.top();
+        s_1.pop();
+        s_2.pop();
+        nb_nodes++;
+
+        test = test || !(curr_1->get_offset()==curr_2->get_offset());
+        test = test || !(curr_1->get_size()==curr_2->get_size());
+        test = test || !(curr_1->get_rank()==curr_2->get_rank());
+        test = test || !(curr_1->get_depth()==curr_2->get_depth());
+        test = test || !(curr_1->get_counter()==curr_2->get_counter());
+        test = test || !(std::abs(curr_1->get_rad()-curr_2->get_rad())<1e-10);
+        test = test || !(norm2(curr_1->get_ctr()-curr_2->get_ctr())<1e-10);
+        test = test || !(curr_1->get_nb_sons()==curr_2->get_nb_sons());
+
+        if (!test){
+            for (int l=0;l<curr_1->get_nb_sons();l++){
+                s_1.push(&(curr_1->get_son(l)));
+                s_2.push(&(curr_2->get_son(l)));
+            }
+        }
+    }
+
+    // Same permutation and local clusters
+    test = test || !(t.get_perm()==t_distributed.get_perm());
+    test = test || !(t.get_local_offset()==t_distributed.get_local_offset());
+    test = test || !(t.get_local_size()==t_distributed.get_local_size());
+    test = test || !(t.get_masteroffset()==t_distributed.get_masteroffset());
+    test = test || !(t.get_max_depth()==t_distributed.get_max_depth());
+    test = test || !(t.get_min_depth()==t_distributed.get_min_depth());
+
+    int rankWorld;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+    if (rankWorld==0){
+        cout << "Number of sons : "<<nb_sons<<", number of nodes : "<<nb_nodes<<", max depth : "<<t_distributed.get_max_depth()<<endl;
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc,&argv);
+
+    int rankWorld;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    SetMinClusterSize(10);
+    srand (1);
+    bool test = 0;
+
+    int size = 2000;
+    double z = 1;
+    vector<R3>     p(size);
+    vector<double> r(size,0);
+    vector<double> g(size,1);
+    vector<int>    tab(size);
+    for(int j=0; j<size; j++){
+        double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+        double theta = ((double) rand() / (double)(RAND_MAX));
+        p[j][0] = sqrt(rho)*cos(2*M_PI*theta); p[j][1] = sqrt(rho)*sin(2*M_PI*theta); p[j][2] = z+0.1*rho;
+        tab[j]=j;
+    }
+
+    std::vector<int> nb_sons_test {2,-1};
+    for (auto & nb_sons : nb_sons_test){
+        test = test || test_distributed_cluster<GeometricClustering>(p,r,tab,g,nb_sons);
+        test = test || test_distributed_cluster<RegularClustering>(p,r,tab,g,nb_sons);
+    }
+
+    if (rankWorld==0){
+        std::cout << "test "<< test << std::endl;
+    }
+
+    MPI_Finalize();
+    return test;
+}
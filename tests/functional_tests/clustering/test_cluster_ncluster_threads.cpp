@@ -0,0 +1,147 @@
+#include <htool/clustering/ncluster.hpp>
+
+#if _OPENMP
+#  include <omp.h>
+#endif
+
+using namespace std;
+using namespace htool;
+
+// Returns true if the trees of t_1 and t_2 differ
+template<typename Cluster_type>
+bool compare_trees(const Cluster_type& t_1, const Cluster_type& t_2){
+    bool test = 0;
+    std::stack<Cluster_type const *> s_1;
+    std::stack<Cluster_type const *> s_2;
+    s_1.push(&t_1);
+    s_2.push(&t_2);
+    while (!s_1.empty() && !test){
+        Cluster_type const * curr_1 = s_1.top();
+        Cluster_type const * curr_2 = s_2.top();
+        s_1.pop();
+        s_2.pop();
+
+        test = test || !(curr_1->get_offset()==curr_2->get_offset());
+        test = test || !(curr_1->get_size()==curr_2->get_size());
+        test = test || !(curr_1->get_rank()==curr_2->get_rank());
+        test = test || !(curr_1->get_depth()==curr_2->get_depth());
+        test = test || !(curr_1->get_nb_sons()==curr_2->get_nb_sons());
+
+        if (!test){
+            for (int l=0;l<curr_1->get_nb_sons();l++){
+                s_1.push(&(curr_1->get_son(l)));
+                s_2.push(&(curr_2->get_son(l)));
+            }
+        }
+    }
+    test = test || !(t_1.get_perm()==t_2.get_perm());
+    test = test || !(t_1.get_local_offset()==t_2.get_local_offset());
+    test = test || !(t_1.get_local_size()==t_2.get_local_size());
+    test = test || !(t_1.get_masteroffset()==t_2.get_masteroffset());
+    return test;
+}
+
+// Returns true if the permutation of t is not a bijection of [0,size)
+template<typename Cluster_type>
+bool check_permutation(const Cluster_type& t, int size){
+    const std::vector<int>& perm = t.get_perm();
+    if (perm.size()!=size){
+        return true;
+    }
+    std::vector<bool> found(size,false);
+    for (int i=0;i<size;i++){
+        if (perm[i]<0 || perm[i]>=size || found[perm[i]]){
+            return true;
+        }
+        found[perm[i]]=true;
+    }
+    return false;
+}
+
+// Trees built with and without threads, and with and without distributed clustering, are compared to the
+// sequential and non distributed one
+template<typename Cluster_type>
+bool test_threads_cluster(const vector<R3>& p, const vector<double>& r, const vector<int>& tab, const vector<double>& g, int nb_sons, int nb_threads){
+    bool test = 0;
+    int rankWorld;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    #if _OPENMP
+    omp_set_num_threads(1);
+    #endif
+    Cluster_type t_ref;
+    SetDistributedClustering(false);
+    t_ref.build(p,r,tab,g,nb_sons);
+    test = test || check_permutation(t_ref,p.size());
+
+    for (int threads : {1,nb_threads}){
+        for (bool distributed : {false,true}){
+            #if _OPENMP
+            omp_set_num_threads(threads);
+            #endif
+            Cluster_type t;
+            SetDistributedClustering(distributed);
+            t.build(p,r,tab,g,nb_sons);
+            SetDistributedClustering(false);
+
+            bool test_t = check_permutation(t,p.size()) || compare_trees(t_ref,t);
+            if (rankWorld==0){
+                cout << "Number of sons : "<<nb_sons<<", threads : "<<threads<<", distributed : "<<distributed<<", max depth : "<<t.get_max_depth()<<", test : "<<test_t<<endl;
+            }
+            test = test || test_t;
+        }
+    }
+    #if _OPENMP
+    omp_set_num_threads(nb_threads);
+    #endif
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc,&argv);
+
+    int rankWorld, sizeWorld;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+    MPI_Comm_size(MPI_COMM_WORLD, &sizeWorld);
+
+    SetMinClusterSize(10);
+    srand (1);
+    bool test = 0;
+
+    // Large enough for subtrees to be built in separate tasks
+    int size = 3*NCluster_task_min_size;
+    double z = 1;
+    vector<R3>     p(size);
+    vector<double> r(size,0);
+    vector<double> g(size,1);
+    vector<int>    tab(size);
+    for(int j=0; j<size; j++){
+        double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+        double theta = ((double) rand() / (double)(RAND_MAX));
+        p[j][0] = sqrt(rho)*cos(2*M_PI*theta); p[j][1] = sqrt(rho)*sin(2*M_PI*theta); p[j][2] = z+0.1*rho;
+        tab[j]=j;
+    }
+
+    // At least two threads, even if only one is available
+    int nb_threads = 1;
+    #if _OPENMP
+    nb_threads = std::max(2,omp_get_max_threads());
+    #endif
+
+    std::vector<int> nb_sons_test {-1};
+    if (sizeWorld%2==0){
+        nb_sons_test.push_back(2);
+    }
+    for (auto & nb_sons : nb_sons_test){
+        test = test_threads_cluster<GeometricClustering>(p,r,tab,g,nb_sons,nb_threads) || test;
+        test = test_threads_cluster<RegularClustering>(p,r,tab,g,nb_sons,nb_threads) || test;
+    }
+
+    if (rankWorld==0){
+        std::cout << "test "<< test << std::endl;
+    }
+
+    MPI_Finalize();
+    return test;
+}
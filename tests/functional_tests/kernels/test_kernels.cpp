@@ -0,0 +1,185 @@
+#include <htool/kernels/laplace.hpp>
+#include <htool/kernels/helmholtz.hpp>
+#include <htool/clustering/ncluster.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Kernels with the scalar formulas, as in user code
+class ScalarLaplaceDoubleLayer: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+	const vector<R3>& n2;
+
+public:
+	ScalarLaplaceDoubleLayer(const vector<R3>& p10,const vector<R3>& p20,const vector<R3>& n20):IMatrix<double>(p10.size(),p20.size()),p1(p10),p2(p20),n2(n20) {}
+
+	double get_coef(const int& i, const int& j)const {
+		R3 d = p1[i]-p2[j];
+		double r = norm2(d);
+		return (r>0) ? (d,n2[j])/(4*M_PI*r*r*r) : 0.;
+	}
+};
+
+class ScalarHelmholtzSingleLayer: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+	double k;
+
+public:
+	ScalarHelmholtzSingleLayer(const vector<R3>& p10,const vector<R3>& p20,double k0):IMatrix<complex<double>>(p10.size(),p20.size()),p1(p10),p2(p20),k(k0) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p2[j]);
+		return (r>0) ? exp(complex<double>(0,k*r))/(4*M_PI*r) : 0.;
+	}
+};
+
+class ScalarLaplaceSingleLayer: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	ScalarLaplaceSingleLayer(const vector<R3>& p10,const vector<R3>& p20):IMatrix<double>(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p2[j]);
+		return (r>0) ? 1./(4*M_PI*r) : 0.;
+	}
+};
+
+// Coefficients, rows, columns and sub-blocks against the scalar formulas
+template<typename T>
+bool test_kernel(const IMatrix<T>& A, const IMatrix<T>& ref, const string& name){
+	int nr = A.nb_rows();
+	int nc = A.nb_cols();
+	vector<int> rows(nr/3), cols(nc/3);
+	for (int i=0;i<rows.size();i++){
+		rows[i] = (7*i+1)%nr;
+	}
+	for (int j=0;j<cols.size();j++){
+		cols[j] = (5*j+2)%nc;
+	}
+
+	double error = 0, norm = 0;
+	vector<T> out(max(nr,nc));
+	for (int i=0;i<rows.size();i++){
+		A.copy_row(rows[i],cols.data(),cols.size(),out.data());
+		for (int j=0;j<cols.size();j++){
+			error = max(error,abs(out[j]-ref.get_coef(rows[i],cols[j])));
+			error = max(error,abs(A.get_coef(rows[i],cols[j])-ref.get_coef(rows[i],cols[j])));
+			norm  = max(norm,abs(ref.get_coef(rows[i],cols[j])));
+		}
+	}
+	for (int j=0;j<cols.size();j++){
+		A.copy_col(cols[j],rows.data(),rows.size(),out.data());
+		for (int i=0;i<rows.size();i++){
+			error = max(error,abs(out[i]-ref.get_coef(rows[i],cols[j])));
+		}
+	}
+	SubMatrix<T> submat = A.get_submatrix(rows,cols);
+	for (int i=0;i<rows.size();i++){
+		for (int j=0;j<cols.size();j++){
+			error = max(error,abs(submat(i,j)-ref.get_coef(rows[i],cols[j])));
+		}
+	}
+
+	int rankWorld;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+	if (rankWorld==0){
+		cout << name << " : relative error on coefficients = "<<error/norm<<endl;
+	}
+	return !(error/norm<1e-14);
+}
+
+// Compression of the kernel compared to the dense product
+template<typename T>
+bool test_hmatrix(IMatrix<T>& A, const vector<R3>& p1, const vector<R3>& p2, const string& name){
+	int nr = A.nb_rows();
+	int nc = A.nb_cols();
+	HMatrix<T,partialACA,GeometricClustering> HA(A,p1,p2);
+
+	vector<T> x(nc,1), f(nr,0), f_dense(nr,0);
+	HA.mvprod_global(x.data(),f.data());
+	vector<int> rows(nr), cols(nc);
+	iota(rows.begin(),rows.end(),0);
+	iota(cols.begin(),cols.end(),0);
+	vector<T> row(nc);
+	for (int i=0;i<nr;i++){
+		A.copy_row(i,cols.data(),nc,row.data());
+		for (int j=0;j<nc;j++){
+			f_dense[i] += row[j]*x[j];
+		}
+	}
+	double error = norm2(f-f_dense)/norm2(f_dense);
+	double compression = HA.compression();
+
+	int rankWorld;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+	if (rankWorld==0){
+		cout << name << " : compression = "<<compression<<", error on mvprod_global = "<<error<<endl;
+	}
+	return !(error<GetEpsilon()*10);
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	SetEpsilon(1e-6);
+	SetEta(10);
+	SetMinClusterSize(10);
+
+	// Two disks, points of the first one are also in the second one
+	srand (1);
+	int nr = 2000;
+	int nc = 1500;
+	vector<R3> p1(nr), p2(nc), n2(nc);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX));
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = 1;
+	}
+	for(int j=0; j<nc; j++){
+		if (j%10==0){
+			p2[j] = p1[j];
+		}
+		else{
+			double rho = ((double) rand() / (double)(RAND_MAX));
+			double theta = ((double) rand() / (double)(RAND_MAX));
+			p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = 1.5+0.1*rho;
+		}
+		double alpha = 0.1*j;
+		n2[j][0] = 0; n2[j][1] = sin(alpha); n2[j][2] = cos(alpha);
+	}
+
+	bool test = 0;
+
+	LaplaceSingleLayer SL(p1,p2);
+	ScalarLaplaceSingleLayer SL_ref(p1,p2);
+	test = test || test_kernel(SL,SL_ref,"Laplace single layer");
+	test = test || test_hmatrix(SL,p1,p2,"Laplace single layer");
+
+	LaplaceDoubleLayer DL(p1,p2,n2);
+	ScalarLaplaceDoubleLayer DL_ref(p1,p2,n2);
+	test = test || test_kernel(DL,DL_ref,"Laplace double layer");
+	test = test || test_hmatrix(DL,p1,p2,"Laplace double layer");
+
+	HelmholtzSingleLayer HSL(p1,p2,5);
+	ScalarHelmholtzSingleLayer HSL_ref(p1,p2,5);
+	test = test || test_kernel(HSL,HSL_ref,"Helmholtz single layer");
+	test = test || test_hmatrix(HSL,p1,p2,"Helmholtz single layer");
+
+	int rankWorld;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+	if (rankWorld==0){
+		cout << "test "<< test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <complex>
+#include <vector>
+
+
+#include <htool/clustering/ncluster.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include "test_lrmat.hpp"
+
+
+using namespace std;
+using namespace htool;
+
+// Same coefficients as MyMatrix, rows and columns are computed at once
+class MyBatchedMatrix: public MyMatrix{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	mutable int nb_get_coef;
+	mutable int nb_copy;
+
+	MyBatchedMatrix(const vector<R3>& p10,const vector<R3>& p20 ):MyMatrix(p10,p20),p1(p10),p2(p20),nb_get_coef(0),nb_copy(0) {}
+
+	double get_coef(const int& i, const int& j)const {nb_get_coef++; return MyMatrix::get_coef(i,j);}
+
+	void copy_row(const int& i, const int* const cols, const int& nb_cols, double* const out) const{
+		nb_copy++;
+		for (int k=0;k<nb_cols;k++){
+			out[k]=1./(4*M_PI*norm2(p1[i]-p2[cols[k]]));
+		}
+	}
+
+	void copy_col(const int& j, const int* const rows, const int& nb_rows, double* const out) const{
+		nb_copy++;
+		for (int k=0;k<nb_rows;k++){
+			out[k]=1./(4*M_PI*norm2(p1[rows[k]]-p2[j]));
+		}
+	}
+};
+
+template<class LowRankMatrix>
+bool test_copy_row_col(const MyMatrix& A, const MyBatchedMatrix& B, LowRankMatrix& A_lrmat, LowRankMatrix& B_lrmat, const GeometricClustering& t, const vector<R3>& xt, const vector<int>& tabt, const GeometricClustering& s, const vector<R3>& xs, const vector<int>& tabs){
+	bool test = 0;
+	B.nb_get_coef = 0;
+	B.nb_copy     = 0;
+	A_lrmat.build(A,t,xt,tabt,s,xs,tabs);
+	B_lrmat.build(B,t,xt,tabt,s,xs,tabs);
+
+	// Same approximation without any call to get_coef
+	test = test || !(A_lrmat.rank_of()==B_lrmat.rank_of());
+	test = test || !(B.nb_get_coef==0);
+	test = test || !(B.nb_copy>0);
+	for (int k=0;k<A_lrmat.rank_of() && !test;k++){
+		for (int i=0;i<A_lrmat.nb_rows();i++){
+			test = test || !(A_lrmat.get_U(i,k)==B_lrmat.get_U(i,k));
+		}
+		for (int j=0;j<A_lrmat.nb_cols();j++){
+			test = test || !(A_lrmat.get_V(k,j)==B_lrmat.get_V(k,j));
+		}
+	}
+	cout << "rank : "<<B_lrmat.rank_of()<<", calls to copy_row and copy_col : "<<B.nb_copy<<endl;
+	return test;
+}
+
+int main(int argc, char *argv[]){
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	SetNdofPerElt(1);
+	SetEpsilon(0.0001);
+
+	int nr=500;
+	int nc=100;
+	std::vector<R3> xt(nr);
+	std::vector<R3> xs(nc);
+	std::vector<int> tabt(nr);
+	std::vector<int> tabs(nc);
+	bool test =0;
+
+	create_geometry(20,xt,tabt,xs,tabs);
+
+	GeometricClustering t,s;
+	t.build(xt,std::vector<double>(xt.size(),0),tabt,std::vector<double>(xt.size(),1));
+	s.build(xs,std::vector<double>(xs.size(),0),tabs,std::vector<double>(xs.size(),1));
+
+	MyMatrix A(xt,xs);
+	MyBatchedMatrix B(xt,xs);
+
+	// partialACA
+	partialACA<double,GeometricClustering> A_partialACA(t.get_perm(),s.get_perm()), B_partialACA(t.get_perm(),s.get_perm());
+	test = test || test_copy_row_col(A,B,A_partialACA,B_partialACA,t,xt,tabt,s,xs,tabs);
+
+	// sympartialACA, with the rows first and with the columns first
+	sympartialACA<double,GeometricClustering> A_sympartialACA(t.get_perm(),s.get_perm(),1,0), B_sympartialACA(t.get_perm(),s.get_perm(),1,0);
+	test = test || test_copy_row_col(A,B,A_sympartialACA,B_sympartialACA,t,xt,tabt,s,xs,tabs);
+	sympartialACA<double,GeometricClustering> A_sympartialACA_T(t.get_perm(),s.get_perm(),0,1), B_sympartialACA_T(t.get_perm(),s.get_perm(),0,1);
+	test = test || test_copy_row_col(A,B,A_sympartialACA_T,B_sympartialACA_T,t,xt,tabt,s,xs,tabs);
+
+	cout << "test : "<<test<<endl;
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+
+	return test;
+}
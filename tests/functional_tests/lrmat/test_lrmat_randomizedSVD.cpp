@@ -0,0 +1,104 @@
+#include <iostream>
+#include <complex>
+#include <vector>
+
+#include <htool/clustering/ncluster.hpp>
+#include <htool/lrmat/SVD.hpp>
+#include <htool/lrmat/randomizedSVD.hpp>
+#include "test_lrmat.hpp"
+
+
+using namespace std;
+using namespace htool;
+
+class MyZeroMatrix: public IMatrix<double>{
+public:
+	MyZeroMatrix(int nr, int nc):IMatrix<double>(nr,nc) {}
+
+	double get_coef(const int&, const int&)const {return 0;}
+};
+
+int main(int argc, char *argv[]){
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	const int ndistance = 4;
+	double distance[ndistance];
+	distance[0] = 15; distance[1] = 20; distance[2] = 30; distance[3] = 40;
+
+	SetNdofPerElt(1);
+	SetEpsilon(0.0001);
+
+	int nr=500;
+	int nc=100;
+	std::vector<R3> xt(nr);
+	std::vector<R3> xs(nc);
+	std::vector<int> tabt(500);
+	std::vector<int> tabs(100);
+	bool test =0;
+	for(int idist=0; idist<ndistance; idist++)
+	{
+		
+		create_geometry(distance[idist],xt,tabt,xs,tabs);
+
+		GeometricClustering t,s; 
+
+		std::vector<int> tabt(xt.size()),tabs(xs.size());
+		std::iota(tabt.begin(),tabt.end(),int(0));
+		std::iota(tabs.begin(),tabs.end(),int(0));
+		t.build(xt,std::vector<double>(xt.size(),0),tabt,std::vector<double>(xt.size(),1));
+		s.build(xs,std::vector<double>(xs.size(),0),tabs,std::vector<double>(xs.size(),1));
+
+		MyMatrix A(xt,xs);
+
+		// Randomized SVD fixed rank
+		int reqrank_max = 10;
+		randomizedSVD<double,GeometricClustering> A_randomizedSVD_fixed(t.get_perm(),s.get_perm(),reqrank_max);
+		A_randomizedSVD_fixed.build(A);
+
+		// Comparison of the singular values with the ones of the full SVD
+		SVD<double,GeometricClustering> A_SVD_fixed(t.get_perm(),s.get_perm(),reqrank_max);
+		A_SVD_fixed.build(A);
+		std::vector<double> singular_values_errors(reqrank_max,0);
+		for (int k = 0 ; k < reqrank_max ; k++){
+			singular_values_errors[k]=std::abs(A_randomizedSVD_fixed.get_singular_value(k)-A_SVD_fixed.get_singular_value(k))/A_SVD_fixed.get_singular_value(0);
+		}
+		cout << "Comparison with the singular values of the full SVD" << endl;
+		test = test || !(norm2(singular_values_errors)<1e-10);
+		cout << "> Relative errors on the singular values : "<<singular_values_errors<<endl;
+
+		// Randomized SVD automatic building
+		randomizedSVD<double,GeometricClustering> A_randomizedSVD(t.get_perm(),s.get_perm());
+		A_randomizedSVD.build(A);
+		test = test || !(Frobenius_relative_error(A_randomizedSVD,A)<GetEpsilon());
+		cout << "> Relative error with automatic rank "<<A_randomizedSVD.rank_of()<<" : "<<Frobenius_relative_error(A_randomizedSVD,A)<<endl;
+
+		std::pair<double,double> fixed_compression_interval(0.87,0.89);
+		std::pair<double,double> auto_compression_interval(0.95,0.97);
+		test = test || test_lrmat(A,A_randomizedSVD_fixed,A_randomizedSVD,t.get_perm(),s.get_perm(),fixed_compression_interval,auto_compression_interval,false,3);
+	}
+
+	// Zero block, with fixed and automatic rank
+	create_geometry(distance[0],xt,tabt,xs,tabs);
+	GeometricClustering t,s;
+	t.build(xt,std::vector<double>(xt.size(),0),tabt,std::vector<double>(xt.size(),1));
+	s.build(xs,std::vector<double>(xs.size(),0),tabs,std::vector<double>(xs.size(),1));
+	MyZeroMatrix Z(nr,nc);
+	randomizedSVD<double,GeometricClustering> Z_randomizedSVD_fixed(t.get_perm(),s.get_perm(),5);
+	Z_randomizedSVD_fixed.build(Z);
+	randomizedSVD<double,GeometricClustering> Z_randomizedSVD(t.get_perm(),s.get_perm());
+	Z_randomizedSVD.build(Z);
+	std::vector<double> x(nc,1), y(nr,1);
+	Z_randomizedSVD.add_mvprod_row_major(x.data(),y.data(),1);
+	cout << "> Zero block: ranks "<<Z_randomizedSVD_fixed.rank_of()<<" and "<<Z_randomizedSVD.rank_of()<<", norm of the product "<<norm2(y-std::vector<double>(nr,1))<<endl;
+	test = test || !(Z_randomizedSVD_fixed.rank_of()==0);
+	test = test || !(Z_randomizedSVD.rank_of()==0);
+	test = test || !(norm2(y-std::vector<double>(nr,1))==0);
+
+	cout << "test : "<<test<<endl;
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
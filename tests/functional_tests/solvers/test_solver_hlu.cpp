@@ -0,0 +1,203 @@
+#include <htool/types/point.hpp>
+#include <htool/solvers/hlu.hpp>
+#include <htool/lrmat/fullACA.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/types/hmatrix.hpp>
+#include <htool/input_output/geometry.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+
+public:
+	MyMatrix(const vector<R3>& p10):IMatrix(p10.size(),p10.size()),p1(p10) {}
+
+	double get_coef(const int& i, const int& j)const {return exp(-norm2(p1[i]-p1[j]))+(i==j ? 1e-1 : 0);}
+};
+
+// Complex symmetric, but not hermitian
+class MyComplexMatrix: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+
+public:
+	MyComplexMatrix(const vector<R3>& p10):IMatrix(p10.size(),p10.size()),p1(p10) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {return exp(complex<double>(-1,2)*norm2(p1[i]-p1[j]))+(i==j ? 1e-1 : 0);}
+};
+
+int main(int argc, char *argv[]){
+
+	// Input file
+	if ( argc < 2 ){ // argc should be 5 or more for correct execution
+		// We print argv[0] assuming it is the program name
+		cout<<"usage: "<< argv[0] <<" datapath\n";
+		return 1;
+	}
+	string datapath=argv[1];
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the number of processes
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test =0;
+	double tol = 1e-6;
+	int mu = 2;
+
+	// HTOOL
+	SetNdofPerElt(1);
+	SetEpsilon(tol);
+	SetEta(0.1);
+	SetMinClusterSize(1);
+
+	//// LU factorization
+
+	// Matrix
+	Matrix<complex<double>> A;
+	A.bytes_to_matrix(datapath+"matrix.bin");
+	int n = A.nb_rows();
+
+	// Right-hand sides
+	Matrix<complex<double>> f_global(n,mu);
+	std::vector<complex<double>> temp(n);
+	bytes_to_vector(temp,datapath+"rhs.bin");
+	for (int i=0;i<mu;i++){
+		f_global.set_col(i,temp);
+	}
+	for (int j=0;j<n;j++){
+		f_global(j,1) *= complex<double>(1,j%2);
+	}
+
+	// Mesh
+	std::vector<R3> p;
+	Load_GMSH_nodes(p,datapath+"mesh.msh");
+
+	// Clustering
+	std::shared_ptr<htool::GeometricClustering> t=std::make_shared<htool::GeometricClustering>();
+	(*t).read_cluster(datapath+"cluster_"+NbrToStr(size)+"_permutation.csv",datapath+"cluster_"+NbrToStr(size)+"_tree.csv");
+
+	// Hmatrix
+	HMatrix<complex<double>,fullACA,GeometricClustering> HA(A,t,p);
+
+	// Solve
+	HLU<complex<double>,fullACA,GeometricClustering> hlu(HA);
+	hlu.print_infos();
+	Matrix<complex<double>> x_global(n,mu);
+	hlu.solve(f_global.data(),x_global.data(),mu);
+	double error = normFrob(f_global-A*x_global)/normFrob(f_global);
+
+	std::vector<complex<double>> f(f_global.data(),f_global.data()+n), x(n);
+	x = hlu*f;
+	std::vector<complex<double>> x_first(x_global.data(),x_global.data()+n);
+	double error_one_rhs = norm2(x-x_first)/norm2(x_first);
+	if (rank==0){
+		cout <<"LU: error = "<<error<<", difference with one right-hand side = "<<error_one_rhs<< endl;
+	}
+	test = test || !(hlu.get_infos("HLU_factorization_type")=="LU");
+	test = test || !(error<10*tol);
+	test = test || !(error_one_rhs<1e-14);
+
+	//// LDLt factorization
+
+	// Geometry
+	srand(1);
+	int nb = 1000;
+	vector<R3> q(nb);
+	for(int j=0; j<nb; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		q[j][0] = sqrt(rho)*cos(2*M_PI*theta); q[j][1] = sqrt(rho)*sin(2*M_PI*theta); q[j][2] = 0;
+	}
+
+	// Symmetric Hmatrix
+	MyMatrix B(q);
+	SetEta(1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,q,true);
+
+	// Solve
+	HLU<double,partialACA,GeometricClustering> hldlt(HB);
+	hldlt.print_infos();
+	std::vector<double> y(nb*mu), g(nb*mu,0), y_test(nb*mu), g_test(nb*mu,0);
+	for (int i=0;i<nb*mu;i++){
+		y[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(y.data(),nb*mu,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int i=0;i<nb;i++){
+		for (int j=0;j<nb;j++){
+			for (int p=0;p<mu;p++){
+				g[i+p*nb] += B.get_coef(i,j)*y[j+p*nb];
+			}
+		}
+	}
+	hldlt.solve(g.data(),y_test.data(),mu);
+	for (int i=0;i<nb;i++){
+		for (int j=0;j<nb;j++){
+			for (int p=0;p<mu;p++){
+				g_test[i+p*nb] += B.get_coef(i,j)*y_test[j+p*nb];
+			}
+		}
+	}
+	error = norm2(g-g_test)/norm2(g);
+	if (rank==0){
+		cout <<"LDLt: error = "<<error<< endl;
+	}
+	test = test || !(hldlt.get_infos("HLU_factorization_type")=="LDLh");
+	test = test || !(error<10*tol);
+
+	//// Complex symmetric matrix, factorized with LU
+
+	// Symmetric Hmatrix
+	MyComplexMatrix C(q);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HC(C,q,true);
+
+	// Solve
+	HLU<complex<double>,partialACA,GeometricClustering> hlu_sym(HC);
+	hlu_sym.print_infos();
+	std::vector<complex<double>> z(nb*mu), h(nb*mu,0), z_test(nb*mu), h_test(nb*mu,0);
+	for (int i=0;i<nb*mu;i++){
+		z[i]=complex<double>((double) rand() / (double)(RAND_MAX),(double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(z.data(),nb*mu,MPI_DOUBLE_COMPLEX,0,MPI_COMM_WORLD);
+	for (int i=0;i<nb;i++){
+		for (int j=0;j<nb;j++){
+			for (int p=0;p<mu;p++){
+				h[i+p*nb] += C.get_coef(i,j)*z[j+p*nb];
+			}
+		}
+	}
+	hlu_sym.solve(h.data(),z_test.data(),mu);
+	for (int i=0;i<nb;i++){
+		for (int j=0;j<nb;j++){
+			for (int p=0;p<mu;p++){
+				h_test[i+p*nb] += C.get_coef(i,j)*z_test[j+p*nb];
+			}
+		}
+	}
+	error = norm2(h-h_test)/norm2(h);
+	if (rank==0){
+		cout <<"Complex symmetric: error = "<<error<< endl;
+	}
+	test = test || !(hlu_sym.get_infos("HLU_factorization_type")=="LU");
+	test = test || !(error<10*tol);
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	//Finalize the MPI environment.
+	MPI_Finalize();
+
+	return test;
+}
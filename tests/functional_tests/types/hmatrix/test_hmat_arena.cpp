@@ -0,0 +1,120 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_arena(const HMatrixType& HA, const HMatrixType& HB, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+	int mu = 3;
+
+	// Same blocks
+	test = test || !(HB.get_nlrmat()==HA.get_nlrmat() && HB.get_ndmat()==HA.get_ndmat());
+	test = test || !(std::abs(HB.compression()-HA.compression())<1e-14);
+
+	// Blocks of HB are sorted and packed in one buffer
+	const auto& lrmats = HB.get_MyFarFieldMats();
+	const auto& dmats = HB.get_MyNearFieldMats();
+	for (int b=1;b<lrmats.size();b++){
+		test = test || !(lrmats[b-1]->get_offset_i()<lrmats[b]->get_offset_i() || (lrmats[b-1]->get_offset_i()==lrmats[b]->get_offset_i() && lrmats[b-1]->get_offset_j()<lrmats[b]->get_offset_j()));
+		test = test || !(lrmats[b-1]->get_V().data()<lrmats[b]->get_U().data());
+	}
+	for (int b=1;b<dmats.size();b++){
+		test = test || !(dmats[b]->is_view() && dmats[b-1]->data()<dmats[b]->data());
+	}
+
+	// Products
+	std::vector<double> x(nc*mu), fa(nr*mu), fb(nr*mu);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	HA.mvprod_global(x.data(),fa.data());
+	HB.mvprod_global(x.data(),fb.data());
+	double error_global = norm2(fa-fb)/norm2(fa);
+
+	HA.mvprod_global(x.data(),fa.data(),mu);
+	HB.mvprod_global(x.data(),fb.data(),mu);
+	double error_global_mu = norm2(fa-fb)/norm2(fa);
+
+	if (rank==0){
+		cout << name <<" : error on mvprod_global = "<<error_global<<", with mu = "<<mu<<" : "<<error_global_mu<<endl;
+	}
+	test = test || !(error_global<1e-14 && error_global_mu<1e-14);
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 2;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	SetBlockArena(false);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetBlockArena(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_arena(A,p1,p2);
+	test = test || test_arena(HA,HA_arena,"hmat");
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	SetBlockArena(false);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetBlockArena(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_arena(B,p1,true);
+	test = test || test_arena(HB,HB_arena,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,162 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+	double k;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20, double k0=1):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20),k(k0) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+k*1e-1);}
+};
+
+// out = A in
+void prod(const MyMatrix& A, const std::vector<double>& in, std::vector<double>& out){
+	std::fill(out.begin(),out.end(),0);
+	for (int i=0;i<A.nb_rows();i++){
+		for (int j=0;j<A.nb_cols();j++){
+			out[i] += A.get_coef(i,j)*in[j];
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	double tol = 1e-6;
+	SetNdofPerElt(1);
+	SetEpsilon(tol);
+	SetEta(1);
+	srand (1);
+
+	int nr = 600;
+	int nc = 500;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+	vector<double> r1(nr,0), g1(nr,1), r2(nc,0), g2(nc,1);
+	vector<int> tab1(nr), tab2(nc);
+	std::iota(tab1.begin(),tab1.end(),0);
+	std::iota(tab2.begin(),tab2.end(),0);
+
+	// Clusters shared by all matrices
+	std::shared_ptr<GeometricClustering> t=make_shared<GeometricClustering>();
+	std::shared_ptr<GeometricClustering> s=make_shared<GeometricClustering>();
+	t->build(p1,r1,tab1,g1);
+	s->build(p2,r2,tab2,g2);
+
+	MyMatrix A(p1,p1), A_sym(p1,p1,2), B(p1,p2), B2(p1,p2,3);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,t,p1);
+	HMatrix<double,partialACA,GeometricClustering> HA_sym(A_sym,t,p1,true);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,t,p1,s,p2);
+	HMatrix<double,partialACA,GeometricClustering> HB2(B2,t,p1,s,p2);
+
+	// Vectors
+	std::vector<double> x(nc), y(nr), f(nr), g(nr), h(nr);
+	for (int i=0;i<nc;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nc,MPI_DOUBLE,0,MPI_COMM_WORLD);
+
+	// Product: C = A B, then C = C - 0.5 A_sym B
+	HMatrix<double,partialACA,GeometricClustering> HC(B2,t,p1,s,p2);
+	HC.add_product(1,HA,HB,0);
+	prod(B,x,y);
+	prod(A,y,f);
+	HC.mvprod_global(x.data(),h.data());
+	double error_product = norm2(f-h)/norm2(f);
+	HC.add_product(-0.5,HA_sym,HB);
+	prod(A_sym,y,g);
+	f = f-g/2.;
+	HC.mvprod_global(x.data(),h.data());
+	double error_product_sym = norm2(f-h)/norm2(f);
+
+	// Sum: A = A + 2 A_sym
+	std::vector<double> xr(nr);
+	for (int i=0;i<nr;i++){
+		xr[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(xr.data(),nr,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	HA.add(2,HA_sym);
+	prod(A,xr,f);
+	prod(A_sym,xr,g);
+	f = f+g+g;
+	HA.mvprod_global(xr.data(),h.data());
+	double error_sum = norm2(f-h)/norm2(f);
+
+	// Sum of symmetric matrices: A_sym = A_sym - A_sym
+	HA_sym.add(-1,HA_sym);
+	HA_sym.mvprod_global(xr.data(),h.data());
+	double norm_sum_sym = norm2(h)/norm2(g);
+
+	// Low-rank update: B2 = B2 + 3 U V
+	int k = 3;
+	std::vector<double> U(nr*k), V(k*nc), Vx(k);
+	for (int i=0;i<nr*k;i++){
+		U[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	for (int i=0;i<k*nc;i++){
+		V[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(U.data(),nr*k,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	MPI_Bcast(V.data(),k*nc,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	HB2.add_lowrank(3,k,U.data(),V.data());
+	prod(B2,x,f);
+	for (int l=0;l<k;l++){
+		for (int j=0;j<nc;j++){
+			Vx[l] += V[l+j*k]*x[j];
+		}
+	}
+	for (int i=0;i<nr;i++){
+		for (int l=0;l<k;l++){
+			f[i] += 3*U[i+l*nr]*Vx[l];
+		}
+	}
+	HB2.mvprod_global(x.data(),h.data());
+	double error_lowrank = norm2(f-h)/norm2(f);
+
+	if (rank==0){
+		cout << "error on A B = "<<error_product<<", on A B - 0.5 A_sym B = "<<error_product_sym<<endl;
+		cout << "error on A + 2 A_sym = "<<error_sum<<", norm of A_sym - A_sym = "<<norm_sum_sym<<endl;
+		cout << "error on B + 3 U V = "<<error_lowrank<<endl;
+	}
+	test = test || !(error_product<10*tol);
+	test = test || !(error_product_sym<10*tol);
+	test = test || !(error_sum<10*tol);
+	test = test || !(norm_sum_sym<1e-14);
+	test = test || !(error_lowrank<10*tol);
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,8 @@
+#include "test_hmat_auto.hpp"
+
+
+int main(int argc, char *argv[]) {
+
+
+	return test_hmat_auto<GeometricClustering,randomizedSVD>(argc,argv);
+}
@@ -0,0 +1,152 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_checkpoint(const HMatrixType& HA, const std::string& name, bool memory_mapped){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+	int mu = 3;
+
+	// Checkpoint, read with other global parameters
+	HA.save(name);
+	MPI_Barrier(MPI_COMM_WORLD);
+	double epsilon = GetEpsilon(), eta = GetEta();
+	SetEpsilon(10*epsilon);
+	SetEta(10*eta);
+	HMatrixType HB(name,MPI_COMM_WORLD,memory_mapped);
+	SetEpsilon(epsilon);
+	SetEta(eta);
+	test = test || !(HB.get_epsilon()==HA.get_epsilon() && HB.get_eta()==HA.get_eta());
+
+	// Structure
+	test = test || !(HB.nb_rows()==nr && HB.nb_cols()==nc);
+	test = test || !(HB.get_local_size()==HA.get_local_size() && HB.get_local_offset()==HA.get_local_offset());
+	test = test || !(HB.get_nlrmat()==HA.get_nlrmat() && HB.get_ndmat()==HA.get_ndmat());
+	test = test || !(HB.get_permt()==HA.get_permt() && HB.get_perms()==HA.get_perms());
+	test = test || !(HB.get_MasterOffset_t()==HA.get_MasterOffset_t());
+	test = test || !(std::abs(HB.compression()-HA.compression())<1e-14);
+	test = test || !(HB.get_infos("Compression")==HA.get_infos("Compression"));
+
+	// Block indices are views of the cluster permutations
+	for (auto lrmat : HB.get_MyFarFieldMats()){
+		test = test || !(lrmat->get_ir()==HB.get_permt().data()+lrmat->get_offset_i() && lrmat->get_ic()==HB.get_perms().data()+lrmat->get_offset_j());
+	}
+	for (auto submat : HB.get_MyNearFieldMats()){
+		test = test || !(submat->get_ir()==HB.get_permt().data()+submat->get_offset_i() && submat->get_ic()==HB.get_perms().data()+submat->get_offset_j());
+	}
+
+	// Global products
+	std::vector<double> x(nc*mu), fa(nr*mu), fb(nr*mu);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	HA.mvprod_global(x.data(),fa.data());
+	HB.mvprod_global(x.data(),fb.data());
+	double error_global = norm2(fa-fb)/norm2(fa);
+
+	HA.mvprod_global(x.data(),fa.data(),mu);
+	HB.mvprod_global(x.data(),fb.data(),mu);
+	double error_global_mu = norm2(fa-fb)/norm2(fa);
+
+	// Local product (square matrices only)
+	double error_local = 0;
+	if (nr==nc){
+		int local_size = HA.get_local_size();
+		std::vector<double> x_local(local_size,1), work(nc), fa_local(local_size), fb_local(local_size);
+		HA.mvprod_local(x_local.data(),fa_local.data(),work.data(),1);
+		HB.mvprod_local(x_local.data(),fb_local.data(),work.data(),1);
+		error_local = norm2(fa_local-fb_local)/norm2(fa_local);
+	}
+
+	if (rank==0){
+		cout << name <<(memory_mapped ? " (mapped)" : "")<<" : error on mvprod_global = "<<error_global<<", with mu = "<<mu<<" : "<<error_global_mu<<", on mvprod_local = "<<error_local<<endl;
+	}
+	test = test || !(error_global<1e-14 && error_global_mu<1e-14 && error_local<1e-14);
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 2;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	test = test || test_checkpoint(HA,"checkpoint_hmat",false);
+	test = test || test_checkpoint(HA,"checkpoint_hmat",true);
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	test = test || test_checkpoint(HB,"checkpoint_hmat_sym",false);
+	test = test || test_checkpoint(HB,"checkpoint_hmat_sym",true);
+
+	// Missing checkpoint
+	bool thrown = false;
+	try{
+		HMatrix<double,partialACA,GeometricClustering> HC("checkpoint_hmat_missing");
+	}
+	catch (const std::string& error){
+		thrown = true;
+		if (rank==0){
+			cout << error << endl;
+		}
+	}
+	test = test || !thrown;
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -6,6 +6,7 @@
 #include <htool/clustering/cluster.hpp>
 #include <htool/clustering/ncluster.hpp>
 #include <htool/lrmat/SVD.hpp>
+#include <htool/lrmat/randomizedSVD.hpp>
 #include <htool/lrmat/fullACA.hpp>
 #include <htool/lrmat/partialACA.hpp>
 #include <htool/lrmat/sympartialACA.hpp>
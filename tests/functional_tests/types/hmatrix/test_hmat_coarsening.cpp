@@ -0,0 +1,120 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_coarsening(const MyMatrix& A, const HMatrixType& HA, const HMatrixType& HA_coarsened, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+
+	// Fewer blocks, using less memory
+	int nblocks = HA.get_nlrmat()+HA.get_ndmat();
+	int nblocks_coarsened = HA_coarsened.get_nlrmat()+HA_coarsened.get_ndmat();
+	double compression = HA.compression();
+	double compression_coarsened = HA_coarsened.compression();
+	int nb_merged_blocks = StrToNbr<int>(HA_coarsened.get_infos("Number_of_merged_blocks"));
+	int nb_agglomerated_blocks = StrToNbr<int>(HA_coarsened.get_infos("Number_of_agglomerated_blocks"));
+	test = test || !(nb_merged_blocks>0 && nblocks_coarsened==nblocks-nb_merged_blocks+nb_agglomerated_blocks);
+	test = test || !(compression_coarsened>compression);
+
+	// Products
+	std::vector<double> x(nc), f(nr), fa(nr), fb(nr);
+	for (int i=0;i<nc;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nc,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int i=0;i<nr;i++){
+		for (int j=0;j<nc;j++){
+			f[i] += A.get_coef(i,j)*x[j];
+		}
+	}
+	HA.mvprod_global(x.data(),fa.data());
+	HA_coarsened.mvprod_global(x.data(),fb.data());
+	double error = norm2(f-fa)/norm2(f);
+	double error_coarsened = norm2(f-fb)/norm2(f);
+
+	if (rank==0){
+		cout << name <<" : number of blocks = "<<nblocks<<" -> "<<nblocks_coarsened<<" ("<<nb_merged_blocks<<" blocks merged in "<<nb_agglomerated_blocks<<")"<<endl;
+		cout << name <<" : compression = "<<compression<<" -> "<<compression_coarsened<<endl;
+		cout << name <<" : error on mvprod_global = "<<error<<" -> "<<error_coarsened<<endl;
+	}
+	test = test || !(error_coarsened<2*GetEpsilon());
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	SetCoarsening(false);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetCoarsening(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_coarsened(A,p1,p2);
+	test = test || test_coarsening(A,HA,HA_coarsened,"hmat");
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	SetCoarsening(false);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetCoarsening(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_coarsened(B,p1,true);
+	SetCoarsening(false);
+	test = test || test_coarsening(B,HB,HB_coarsened,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
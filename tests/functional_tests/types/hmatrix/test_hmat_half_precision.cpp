@@ -0,0 +1,134 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_half_precision(const MyMatrix& A, const HMatrixType& HA, const HMatrixType& HA_reduced, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+
+	// Same blocks, some of them in single precision
+	int nlrmat = HA.get_nlrmat();
+	int ndmat = HA.get_ndmat();
+	int nlrmat_reduced = HA_reduced.get_nlrmat();
+	int ndmat_reduced = HA_reduced.get_ndmat();
+	double compression = HA.compression();
+	double compression_reduced = HA_reduced.compression();
+	int nb_single_precision_blocks = StrToNbr<int>(HA_reduced.get_infos("Number_of_single_precision_blocks"));
+	int nb_half_precision_blocks = StrToNbr<int>(HA_reduced.get_infos("Number_of_half_precision_blocks"));
+	test = test || !(nlrmat_reduced==nlrmat && ndmat_reduced==ndmat);
+	test = test || !(compression_reduced==compression);
+	test = test || !(nb_half_precision_blocks>0);
+
+	// Products with one and several vectors
+	int mu = 2;
+	std::vector<double> x(nc*mu), f(nr*mu), fa(nr*mu), fb(nr*mu);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nc*mu,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int i=0;i<nr;i++){
+		for (int j=0;j<nc;j++){
+			for (int p=0;p<mu;p++){
+				f[i+p*nr] += A.get_coef(i,j)*x[j+p*nc];
+			}
+		}
+	}
+	HA.mvprod_global(x.data(),fa.data(),mu);
+	HA_reduced.mvprod_global(x.data(),fb.data(),mu);
+	double error = norm2(f-fa)/norm2(f);
+	double error_reduced = norm2(f-fb)/norm2(f);
+
+	std::vector<double> y(x.begin(),x.begin()+nc), g(f.begin(),f.begin()+nr), gb(nr);
+	HA_reduced.mvprod_global(y.data(),gb.data());
+	double error_reduced_one_vector = norm2(g-gb)/norm2(g);
+
+	if (rank==0){
+		cout << name <<" : "<<nb_half_precision_blocks<<" low-rank blocks in half precision and "<<nb_single_precision_blocks<<" in single precision out of "<<nlrmat<<endl;
+		cout << name <<" : error on mvprod_global = "<<error<<" -> "<<error_reduced<<" ("<<error_reduced_one_vector<<" with one vector)"<<endl;
+	}
+	test = test || !(error_reduced<2*GetEpsilon());
+	test = test || !(error_reduced_one_vector<2*GetEpsilon());
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-3);
+	SetEta(1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	SetMixedPrecision(false);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetMixedPrecision(true);
+	SetHalfPrecision(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_reduced(A,p1,p2);
+	test = test || test_half_precision(A,HA,HA_reduced,"hmat");
+
+	// One cluster tree, symmetric storage, blocks in one buffer
+	SetBlockArena(true);
+	MyMatrix B(p1,p1);
+	SetMixedPrecision(false);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetMixedPrecision(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_reduced(B,p1,true);
+	SetMixedPrecision(false);
+	SetHalfPrecision(false);
+	SetBlockArena(false);
+	test = test || test_half_precision(B,HB,HB_reduced,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
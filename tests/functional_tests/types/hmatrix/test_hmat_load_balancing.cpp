@@ -0,0 +1,123 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_load_balancing(const HMatrixType& HA, const HMatrixType& HB, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+	int mu = 3;
+
+	// Same blocks
+	test = test || !(HB.get_nlrmat()==HA.get_nlrmat() && HB.get_ndmat()==HA.get_ndmat());
+	test = test || !(std::abs(HB.compression()-HA.compression())<1e-14);
+
+	// Blocks of HB are back on the process owning their rows
+	int local_offset = HB.get_local_offset();
+	int local_size = HB.get_local_size();
+	for (auto lrmat : HB.get_MyFarFieldMats()){
+		test = test || !(local_offset<=lrmat->get_offset_i() && lrmat->get_offset_i()<local_offset+local_size);
+	}
+	for (auto dmat : HB.get_MyNearFieldMats()){
+		test = test || !(local_offset<=dmat->get_offset_i() && dmat->get_offset_i()<local_offset+local_size);
+	}
+
+	// Products
+	std::vector<double> x(nc*mu), fa(nr*mu), fb(nr*mu);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	HA.mvprod_global(x.data(),fa.data());
+	HB.mvprod_global(x.data(),fb.data());
+	double error_global = norm2(fa-fb)/norm2(fa);
+
+	HA.mvprod_global(x.data(),fa.data(),mu);
+	HB.mvprod_global(x.data(),fb.data(),mu);
+	double error_global_mu = norm2(fa-fb)/norm2(fa);
+
+	if (rank==0){
+		cout << name <<" : moved blocks = "<<HB.get_infos("Number_of_moved_blocks")<<endl;
+		cout << name <<" : error on mvprod_global = "<<error_global<<", with mu = "<<mu<<" : "<<error_global_mu<<endl;
+	}
+	test = test || !(error_global<1e-14 && error_global_mu<1e-14);
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	// Disk shifted from the first one in the same plane, so that only some rows see a near field
+	double z2 = 1;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = 1+sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees, received blocks packed with the others
+	MyMatrix A(p1,p2);
+	SetLoadBalancing(false);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetLoadBalancing(true);
+	SetBlockArena(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_balanced(A,p1,p2);
+	SetBlockArena(false);
+	test = test || test_load_balancing(HA,HA_balanced,"hmat");
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	SetLoadBalancing(false);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetLoadBalancing(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_balanced(B,p1,true);
+	test = test || test_load_balancing(HB,HB_balanced,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
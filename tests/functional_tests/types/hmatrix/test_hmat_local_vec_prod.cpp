@@ -0,0 +1,100 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+
+public:
+	MyMatrix(const vector<R3>& p10):IMatrix(p10.size(),p10.size()),p1(p10) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p1[j]);
+		return exp(complex<double>(0,2*r))/(4*M_PI*r+1e-1);
+	}
+};
+
+// Distributed product compared with the global one, in the numbering of the cluster tree
+template<typename HMatrixType>
+double test_mvprod_local(const HMatrixType& HA, int mu){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	int n = HA.nb_rows();
+	int local_size = HA.get_local_size(), local_offset = HA.get_local_offset();
+
+	std::vector<complex<double>> x(n*mu), f(n*mu), x_local(local_size*mu), f_local(local_size*mu), work(n*mu);
+	for (int i=0;i<n*mu;i++){
+		x[i]=complex<double>((double) rand() / (double)(RAND_MAX),(double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),n*mu,wrapper_mpi<complex<double>>::mpi_type(),0,MPI_COMM_WORLD);
+	HA.mvprod_global(x.data(),f.data(),mu);
+	for (int p=0;p<mu;p++){
+		for (int i=0;i<local_size;i++){
+			x_local[p+i*mu] = x[HA.get_permt(local_offset+i)+p*n];
+		}
+	}
+
+	// Twice, to check that requests are reused
+	HA.mvprod_local(x_local.data(),f_local.data(),work.data(),mu);
+	HA.mvprod_local(x_local.data(),f_local.data(),work.data(),mu);
+	double error = 0, norm = 0;
+	for (int p=0;p<mu;p++){
+		for (int i=0;i<local_size;i++){
+			error += pow(abs(f_local[p+i*mu]-f[HA.get_permt(local_offset+i)+p*n]),2);
+			norm  += pow(abs(f[HA.get_permt(local_offset+i)+p*n]),2);
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE,&error,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE,&norm,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+	return sqrt(error/norm);
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.5);
+	srand (1);
+
+	int n = 1000;
+	vector<R3> p(n);
+	for(int j=0; j<n; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p[j][0] = sqrt(rho)*cos(2*M_PI*theta); p[j][1] = sqrt(rho)*sin(2*M_PI*theta); p[j][2] = 0;
+	}
+
+	MyMatrix A(p);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HA(A,p);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HA_sym(A,p,true);
+	for (int mu=1;mu<=3;mu+=2){
+		double error     = test_mvprod_local(HA,mu);
+		double error_sym = test_mvprod_local(HA_sym,mu);
+		if (rank==0){
+			cout << "difference between mvprod_local and mvprod_global with mu = "<<mu<<" : "<<error<<", symmetric storage : "<<error_sym<<endl;
+		}
+		test = test || !(error<1e-10);
+		test = test || !(error_sym<1e-10);
+	}
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,163 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_near_field_compression(const MyMatrix& A, const HMatrixType& HA, const HMatrixType& HA_compressed, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+
+	// Same blocks, some dense blocks in reduced precision
+	int nlrmat = HA.get_nlrmat();
+	int ndmat = HA.get_ndmat();
+	int nlrmat_compressed = HA_compressed.get_nlrmat();
+	int ndmat_compressed = HA_compressed.get_ndmat();
+	int nb_single_precision_blocks = StrToNbr<int>(HA_compressed.get_infos("Number_of_single_precision_dense_blocks"));
+	int nb_half_precision_blocks = StrToNbr<int>(HA_compressed.get_infos("Number_of_half_precision_dense_blocks"));
+	test = test || !(nlrmat_compressed==nlrmat && ndmat_compressed==ndmat);
+	test = test || !(nb_half_precision_blocks>0);
+
+	// Products with one and several vectors
+	int mu = 2;
+	std::vector<double> x(nc*mu), f(nr*mu), fa(nr*mu), fb(nr*mu);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nc*mu,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int i=0;i<nr;i++){
+		for (int j=0;j<nc;j++){
+			for (int p=0;p<mu;p++){
+				f[i+p*nr] += A.get_coef(i,j)*x[j+p*nc];
+			}
+		}
+	}
+	HA.mvprod_global(x.data(),fa.data(),mu);
+	HA_compressed.mvprod_global(x.data(),fb.data(),mu);
+	double error = norm2(f-fa)/norm2(f);
+	double error_compressed = norm2(f-fb)/norm2(f);
+
+	std::vector<double> y(x.begin(),x.begin()+nc), g(f.begin(),f.begin()+nr), gb(nr);
+	HA_compressed.mvprod_global(y.data(),gb.data());
+	double error_compressed_one_vector = norm2(g-gb)/norm2(g);
+
+	if (rank==0){
+		cout << name <<" : "<<nb_half_precision_blocks<<" dense blocks in half precision and "<<nb_single_precision_blocks<<" in single precision out of "<<ndmat<<endl;
+		cout << name <<" : error on mvprod_global = "<<error<<" -> "<<error_compressed<<" ("<<error_compressed_one_vector<<" with one vector)"<<endl;
+	}
+	test = test || !(error_compressed<2*GetEpsilon());
+	test = test || !(error_compressed_one_vector<2*GetEpsilon());
+
+	// Entries of compressed blocks, matched by offsets
+	std::map<std::pair<int,int>,const SubMatrix<double>*> blocks;
+	for (const SubMatrix<double>* block : HA.get_MyNearFieldMats()){
+		blocks[std::make_pair(block->get_offset_i(),block->get_offset_j())] = block;
+	}
+	double error_blocks = 0, norm_blocks = 0;
+	bool test_decoding = 0;
+	for (const SubMatrix<double>* block_compressed : HA_compressed.get_MyNearFieldMats()){
+		const SubMatrix<double>& block = *(blocks.at(std::make_pair(block_compressed->get_offset_i(),block_compressed->get_offset_j())));
+		// Decoding in a larger array, as DDM solvers do
+		int ld = block.nb_rows()+1;
+		std::vector<double> decoded(ld*block.nb_cols(),0);
+		block_compressed->get_whole_matrix(decoded.data(),ld);
+		for (int j=0;j<block.nb_rows();j++){
+			for (int k=0;k<block.nb_cols();k++){
+				error_blocks += std::pow(std::abs(block.get_coef(j,k)-block_compressed->get_coef(j,k)),2);
+				norm_blocks += std::pow(std::abs(block.get_coef(j,k)),2);
+				test_decoding = test_decoding || !(decoded[j+k*ld]==block_compressed->get_coef(j,k));
+			}
+		}
+	}
+	test = test || !(std::sqrt(error_blocks)<=GetEpsilon()*std::sqrt(norm_blocks));
+	test = test || test_decoding;
+
+	// Dense local blocks with decoded entries
+	Matrix<double> dense_compressed = HA_compressed.to_dense_perm();
+	Matrix<double> dense = HA.to_dense_perm();
+	double error_dense = 0;
+	for (int i=0;i<dense.nb_rows();i++){
+		for (int j=0;j<dense.nb_cols();j++){
+			error_dense += std::pow(std::abs(dense(i,j)-dense_compressed(i,j)),2);
+		}
+	}
+	test = test || !(std::sqrt(error_dense)<=GetEpsilon()*normFrob(dense));
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-3);
+	SetEta(0.5);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetNearFieldCompression(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_compressed(A,p1,p2);
+	SetNearFieldCompression(false);
+	test = test || test_near_field_compression(A,HA,HA_compressed,"hmat");
+
+	// One cluster tree, symmetric storage, blocks in one buffer
+	SetBlockArena(true);
+	MyMatrix B(p1,p1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetNearFieldCompression(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_compressed(B,p1,true);
+	SetNearFieldCompression(false);
+	SetBlockArena(false);
+	test = test || test_near_field_compression(B,HB,HB_compressed,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,85 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p2[j]);
+		return exp(complex<double>(0,2*r))/(4*M_PI*r);
+	}
+};
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.5);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Same matrix with phased and pipelined products
+	MyMatrix A(p1,p2);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetPipelinedMvprod(true);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HA_pipelined(A,p1,p2);
+	SetPipelinedMvprod(false);
+
+	for (int mu=1;mu<=3;mu+=2){
+		std::vector<complex<double>> x(nc*mu), f(nr*mu), f_pipelined(nr*mu);
+		for (int i=0;i<nc*mu;i++){
+			x[i]=complex<double>((double) rand() / (double)(RAND_MAX),(double) rand() / (double)(RAND_MAX));
+		}
+		MPI_Bcast(x.data(),nc*mu,wrapper_mpi<complex<double>>::mpi_type(),0,MPI_COMM_WORLD);
+		HA.mvprod_global(x.data(),f.data(),mu);
+		HA_pipelined.mvprod_global(x.data(),f_pipelined.data(),mu);
+		HA_pipelined.mvprod_global(x.data(),f_pipelined.data(),mu);
+		double error = norm2(f-f_pipelined)/norm2(f);
+		if (rank==0){
+			cout << "difference between phased and pipelined products with mu = "<<mu<<" : "<<error<<endl;
+		}
+		test = test || !(error<1e-14);
+	}
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
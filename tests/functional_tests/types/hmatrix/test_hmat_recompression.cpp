@@ -0,0 +1,125 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_recompression(const MyMatrix& A, const HMatrixType& HA, const HMatrixType& HA_recompressed, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	bool test = 0;
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+
+	// Same blocks, with lower ranks (statistics of ComputeInfos are only reduced on rank 0)
+	int nlrmat = HA.get_nlrmat();
+	int ndmat = HA.get_ndmat();
+	int nlrmat_recompressed = HA_recompressed.get_nlrmat();
+	int ndmat_recompressed = HA_recompressed.get_ndmat();
+	double compression = HA.compression();
+	double compression_recompressed = HA_recompressed.compression();
+	test = test || !(nlrmat_recompressed==nlrmat && ndmat_recompressed==ndmat);
+	test = test || !(compression_recompressed>compression);
+	test = test || !(StrToNbr<double>(HA_recompressed.get_infos("Rank_after_recompression_mean"))<StrToNbr<double>(HA_recompressed.get_infos("Rank_before_recompression_mean")));
+	if (rank==0){
+		test = test || !(HA_recompressed.get_infos("Rank_before_recompression_mean")==HA.get_infos("Rank_mean"));
+		test = test || !(HA_recompressed.get_infos("Rank_after_recompression_mean")==HA_recompressed.get_infos("Rank_mean"));
+	}
+
+	// Products
+	std::vector<double> x(nc), f(nr), fa(nr), fb(nr);
+	for (int i=0;i<nc;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nc,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int i=0;i<nr;i++){
+		for (int j=0;j<nc;j++){
+			f[i] += A.get_coef(i,j)*x[j];
+		}
+	}
+	HA.mvprod_global(x.data(),fa.data());
+	HA_recompressed.mvprod_global(x.data(),fb.data());
+	double error = norm2(f-fa)/norm2(f);
+	double error_recompressed = norm2(f-fb)/norm2(f);
+
+	if (rank==0){
+		cout << name <<" : mean rank = "<<HA_recompressed.get_infos("Rank_before_recompression_mean")<<" -> "<<HA_recompressed.get_infos("Rank_after_recompression_mean")<<", max rank = "<<HA_recompressed.get_infos("Rank_before_recompression_max")<<" -> "<<HA_recompressed.get_infos("Rank_after_recompression_max")<<endl;
+		cout << name <<" : compression = "<<compression<<" -> "<<compression_recompressed<<endl;
+		cout << name <<" : error on mvprod_global = "<<error<<" -> "<<error_recompressed<<endl;
+	}
+	test = test || !(error_recompressed<2*GetEpsilon());
+
+	return test;
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	SetRecompression(false);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	SetRecompression(true);
+	HMatrix<double,partialACA,GeometricClustering> HA_recompressed(A,p1,p2);
+	test = test || test_recompression(A,HA,HA_recompressed,"hmat");
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	SetRecompression(false);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	SetRecompression(true);
+	HMatrix<double,partialACA,GeometricClustering> HB_recompressed(B,p1,true);
+	SetRecompression(false);
+	test = test || test_recompression(B,HB,HB_recompressed,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
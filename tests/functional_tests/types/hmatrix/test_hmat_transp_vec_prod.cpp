@@ -0,0 +1,180 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p2[j]);
+		return exp(complex<double>(0,2*r+p1[i][0]))/(4*M_PI*r);
+	}
+};
+
+class MySymMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+
+public:
+	MySymMatrix(const vector<R3>& p10):IMatrix(p10.size(),p10.size()),p1(p10) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p1[j])+1e-1);}
+};
+
+// Complex symmetric, but not hermitian
+class MyComplexSymMatrix: public IMatrix<complex<double>>{
+	const vector<R3>& p1;
+
+public:
+	MyComplexSymMatrix(const vector<R3>& p10):IMatrix(p10.size(),p10.size()),p1(p10) {}
+
+	complex<double> get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p1[j]);
+		return exp(complex<double>(0,2*r))/(4*M_PI*r+1e-1);
+	}
+};
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	double tol = 1e-6;
+	int mu = 3;
+	SetNdofPerElt(1);
+	SetEpsilon(tol);
+	SetEta(0.5);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 1.5;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	MyMatrix A(p1,p2);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HA(A,p1,p2);
+
+	// Adjoint products with mu right-hand sides
+	std::vector<complex<double>> x(nr*mu), f(nc*mu,0), f_global(nc*mu), f_one(nc);
+	for (int i=0;i<nr*mu;i++){
+		x[i]=complex<double>((double) rand() / (double)(RAND_MAX),(double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),nr*mu,wrapper_mpi<complex<double>>::mpi_type(),0,MPI_COMM_WORLD);
+	for (int p=0;p<mu;p++){
+		for (int i=0;i<nr;i++){
+			for (int j=0;j<nc;j++){
+				f[j+p*nc] += conj(A.get_coef(i,j))*x[i+p*nr];
+			}
+		}
+	}
+	HA.mvprod_transp_global(x.data(),f_global.data(),mu);
+	HA.mvprod_transp_global(x.data(),f_one.data());
+	double error = norm2(f-f_global)/norm2(f);
+	double error_one = norm2(std::vector<complex<double>>(f.begin(),f.begin()+nc)-f_one)/norm2(f_one);
+
+	// Local product, in the numbering of the cluster trees
+	int local_size_t = HA.get_MasterOffset_t(rank).second, local_offset_t = HA.get_MasterOffset_t(rank).first;
+	int local_size_s = HA.get_MasterOffset_s(rank).second, local_offset_s = HA.get_MasterOffset_s(rank).first;
+	std::vector<complex<double>> x_perm(nr), x_local(local_size_t*mu), f_local(local_size_s*mu), work(nc*mu);
+	for (int p=0;p<mu;p++){
+		for (int i=0;i<nr;i++){
+			x_perm[i] = x[HA.get_permt(i)+p*nr];
+		}
+		for (int i=0;i<local_size_t;i++){
+			x_local[p+i*mu] = x_perm[local_offset_t+i];
+		}
+	}
+	HA.mvprod_transp_local(x_local.data(),f_local.data(),work.data(),mu);
+	double error_local = 0, norm_local = 0;
+	for (int p=0;p<mu;p++){
+		for (int j=0;j<local_size_s;j++){
+			error_local += pow(abs(f_local[p+j*mu]-f[HA.get_perms(local_offset_s+j)+p*nc]),2);
+			norm_local += pow(abs(f[HA.get_perms(local_offset_s+j)+p*nc]),2);
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE,&error_local,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE,&norm_local,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+	error_local = sqrt(error_local/norm_local);
+
+	// Symmetric matrices are their own adjoint
+	MySymMatrix B(p1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	std::vector<double> y(nr), g(nr), g_transp(nr);
+	for (int i=0;i<nr;i++){
+		y[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(y.data(),nr,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	HB.mvprod_global(y.data(),g.data());
+	HB.mvprod_transp_global(y.data(),g_transp.data());
+	double error_sym = norm2(g-g_transp)/norm2(g);
+
+	// Complex symmetric matrices (C^T = C): products with one and several vectors, and with C^H = conj(C)
+	MyComplexSymMatrix C(p1);
+	HMatrix<complex<double>,partialACA,GeometricClustering> HC(C,p1,true);
+	std::vector<complex<double>> z(nr*mu), h(nr*mu,0), h_adj(nr*mu,0), h_test(nr*mu), h_one(nr), h_adj_test(nr*mu);
+	for (int i=0;i<nr*mu;i++){
+		z[i]=complex<double>((double) rand() / (double)(RAND_MAX),(double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(z.data(),nr*mu,wrapper_mpi<complex<double>>::mpi_type(),0,MPI_COMM_WORLD);
+	for (int i=0;i<nr;i++){
+		for (int j=0;j<nr;j++){
+			for (int p=0;p<mu;p++){
+				h[i+p*nr] += C.get_coef(i,j)*z[j+p*nr];
+				h_adj[i+p*nr] += conj(C.get_coef(i,j))*z[j+p*nr];
+			}
+		}
+	}
+	HC.mvprod_global(z.data(),h_test.data(),mu);
+	HC.mvprod_global(z.data(),h_one.data());
+	HC.mvprod_transp_global(z.data(),h_adj_test.data(),mu);
+	double error_complex_sym = norm2(h-h_test)/norm2(h);
+	double error_complex_sym_one = norm2(std::vector<complex<double>>(h.begin(),h.begin()+nr)-h_one)/norm2(h_one);
+	double error_complex_sym_transp = norm2(h_adj-h_adj_test)/norm2(h_adj);
+
+	if (rank==0){
+		cout << "error on mvprod_transp_global = "<<error<<", with one right-hand side = "<<error_one<<endl;
+		cout << "error on mvprod_transp_local = "<<error_local<<endl;
+		cout << "difference between mvprod_global and mvprod_transp_global for a symmetric matrix = "<<error_sym<<endl;
+		cout << "complex symmetric matrix: error on mvprod_global = "<<error_complex_sym<<", with one right-hand side = "<<error_complex_sym_one<<", on mvprod_transp_global = "<<error_complex_sym_transp<<endl;
+	}
+	test = test || !(error<tol);
+	test = test || !(error_one<tol);
+	test = test || !(error_local<tol);
+	test = test || !(error_sym<1e-14);
+	test = test || !(error_complex_sym<tol);
+	test = test || !(error_complex_sym_one<tol);
+	test = test || !(error_complex_sym_transp<tol);
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
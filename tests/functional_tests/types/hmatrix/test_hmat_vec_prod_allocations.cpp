@@ -0,0 +1,135 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+#include <new>
+#include <cstdlib>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+// Count allocations made through operator new
+int nb_allocations = 0;
+
+void* operator new(std::size_t size){
+	nb_allocations++;
+	void* ptr = std::malloc(size==0 ? 1 : size);
+	if (ptr==nullptr){
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept{
+	std::free(ptr);
+}
+
+template<typename HMatrixType>
+bool test_mvprod_allocations(const HMatrixType& HA, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+	int mu = 3;
+	std::vector<double> x(nc*mu,1), f(nr*mu);
+	std::vector<double> x_local(HA.get_local_size()*mu,1), f_local(HA.get_local_size()*mu), work(nc*mu);
+	std::vector<double> y(nr*mu,1), g(nc*mu), g_local(HA.get_MasterOffset_s(rank).second*mu);
+	std::vector<double> f_sub(HA.get_local_size()*mu);
+	bool square = (nr==nc);
+
+	// First products with mu right-hand sides may enlarge the workspaces
+	HA.mvprod_global(x.data(),f.data(),mu);
+	HA.mvprod_transp_global(y.data(),g.data(),mu);
+
+	int nb_allocations_before = nb_allocations;
+	for (int i=0;i<10;i++){
+		HA.mvprod_global(x.data(),f.data());
+		HA.mvprod_global(x.data(),f.data(),mu);
+		HA.mvprod_transp_global(y.data(),g.data());
+		HA.mvprod_transp_global(y.data(),g.data(),mu);
+		HA.mvprod_transp_local(x_local.data(),g_local.data(),work.data(),mu);
+		if (square){
+			HA.mvprod_local(x_local.data(),f_local.data(),work.data(),1);
+		}
+		HA.mvprod_subrhs(x.data(),f_sub.data(),mu,0,nc,0);
+	}
+	int nb_allocations_mvprod = nb_allocations-nb_allocations_before;
+
+	// With all the columns, mvprod_subrhs is the product with the local blocks (the input being constant, permutations do not matter)
+	double error_subrhs = 0;
+	if (!HA.is_symmetric()){
+		HA.mvprod_global(x.data(),f.data(),mu);
+		for (int i=0;i<HA.get_local_size();i++){
+			for (int p=0;p<mu;p++){
+				error_subrhs = std::max(error_subrhs,std::abs(f_sub[i*mu+p]-f[HA.get_permt()[HA.get_local_offset()+i]+p*nr]));
+			}
+		}
+	}
+
+	if (rank==0){
+		cout << name <<" : allocations during products = "<<nb_allocations_mvprod<<", error on mvprod_subrhs = "<<error_subrhs<<endl;
+	}
+	return !(nb_allocations_mvprod==0 && error_subrhs<1e-10 && HA.get_infos("nb_mat_vec_prod")==NbrToStr(52+(square ? 10 : 0)+(HA.is_symmetric() ? 0 : 1)));
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 2;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	test = test || test_mvprod_allocations(HA,"hmat");
+
+	// One cluster tree, symmetric storage
+	MyMatrix B(p1,p1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1,true);
+	test = test || test_mvprod_allocations(HB,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,108 @@
+#include <htool/types/hmatrix.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/clustering/ncluster.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMatrix: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	MyMatrix(const vector<R3>& p10,const vector<R3>& p20 ):IMatrix(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {return 1./(4*M_PI*norm2(p1[i]-p2[j])+1e-1);}
+};
+
+template<typename HMatrixType>
+bool test_threads(const HMatrixType& HA, const IMatrix<double>& A, const std::string& name){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	int nr = HA.nb_rows();
+	int nc = HA.nb_cols();
+	int mu = 3;
+
+	// Reference with the dense matrix
+	std::vector<double> x(nc*mu), f(nr*mu), f_ref(nr*mu,0);
+	for (int i=0;i<nc*mu;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	for (int l=0;l<mu;l++){
+		for (int i=0;i<nr;i++){
+			for (int j=0;j<nc;j++){
+				f_ref[i+l*nr] += A.get_coef(i,j)*x[j+l*nc];
+			}
+		}
+	}
+
+	HA.mvprod_global(x.data(),f.data());
+	double error = norm2(std::vector<double>(f.begin(),f.begin()+nr)-std::vector<double>(f_ref.begin(),f_ref.begin()+nr))/norm2(std::vector<double>(f_ref.begin(),f_ref.begin()+nr));
+	HA.mvprod_global(x.data(),f.data(),mu);
+	double error_mu = norm2(f-f_ref)/norm2(f_ref);
+
+	if (rank==0){
+		cout << name <<" : error on mvprod_global = "<<error<<", with mu = "<<mu<<" : "<<error_mu<<endl;
+	}
+	return !(error<GetEpsilon()*10 && error_mu<GetEpsilon()*10);
+}
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.1);
+	srand (1);
+
+	int nr = 1000;
+	int nc = 800;
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+	}
+	double z2 = 2;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Several threads, even on a single core, so that rows are split in several ranges
+	#if _OPENMP
+	omp_set_num_threads(4);
+	#endif
+
+	// Two cluster trees
+	MyMatrix A(p1,p2);
+	HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+	test = test || test_threads(HA,A,"hmat");
+
+	// One cluster tree, without and with symmetric storage
+	MyMatrix B(p1,p1);
+	HMatrix<double,partialACA,GeometricClustering> HB(B,p1);
+	test = test || test_threads(HB,B,"hmat_square");
+	HMatrix<double,partialACA,GeometricClustering> HB_sym(B,p1,true);
+	test = test || test_threads(HB_sym,B,"hmat_sym");
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,83 @@
+#include <htool/clustering/ncluster.hpp>
+#include <htool/types/multihmatrix.hpp>
+#include <htool/multilrmat/multipartialACA.hpp>
+
+using namespace std;
+using namespace htool;
+
+
+class MyMultiMatrix: public MultiIMatrix<double>{
+	const vector<R3>& p1;
+
+public:
+	MyMultiMatrix(const vector<R3>& p10):MultiIMatrix(p10.size(),p10.size(),2),p1(p10) {}
+	std::vector<double> get_coefs(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p1[j]);
+		return std::vector<double> {1./(4*M_PI*r+1e-1), exp(-r)};
+	}
+};
+
+int main(int argc, char *argv[]) {
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	//
+	bool test = 0;
+	SetNdofPerElt(1);
+	SetEpsilon(1e-6);
+	SetEta(0.5);
+	srand (1);
+
+	int n = 800;
+	vector<R3> p(n);
+	for(int j=0; j<n; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p[j][0] = sqrt(rho)*cos(2*M_PI*theta); p[j][1] = sqrt(rho)*sin(2*M_PI*theta); p[j][2] = 0;
+	}
+
+	MyMultiMatrix A(p);
+	MultiHMatrix<double,MultipartialACA,GeometricClustering> MultiHA(A,p,p);
+
+	// Distributed products of each HMatrix compared with the global ones
+	std::vector<double> x(n), f(n);
+	for (int i=0;i<n;i++){
+		x[i]=((double) rand() / (double)(RAND_MAX));
+	}
+	MPI_Bcast(x.data(),n,MPI_DOUBLE,0,MPI_COMM_WORLD);
+	for (int l=0;l<A.nb_matrix();l++){
+		const HMatrix<double,bareLowRankMatrix,GeometricClustering>& HA = MultiHA[l];
+		int local_size = HA.get_local_size(), local_offset = HA.get_local_offset();
+		std::vector<double> x_local(local_size), f_local(local_size), work(n);
+		for (int i=0;i<local_size;i++){
+			x_local[i] = x[HA.get_permt(local_offset+i)];
+		}
+		HA.mvprod_global(x.data(),f.data());
+		HA.mvprod_local(x_local.data(),f_local.data(),work.data(),1);
+		double error = 0, norm = 0;
+		for (int i=0;i<local_size;i++){
+			error += pow(f_local[i]-f[HA.get_permt(local_offset+i)],2);
+			norm  += pow(f[HA.get_permt(local_offset+i)],2);
+		}
+		MPI_Allreduce(MPI_IN_PLACE,&error,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE,&norm,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+		error = sqrt(error/norm);
+		if (rank==0){
+			cout << "difference between mvprod_local and mvprod_global of HMatrix "<<l<<" : "<<error<<endl;
+		}
+		test = test || !(error<1e-10);
+	}
+
+	if (rank==0){
+		cout <<"test: "<<test << endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return test;
+}
@@ -0,0 +1,96 @@
+#include "hmat.hpp"
+
+// Strong scaling of the assembly with the number of OpenMP threads (1,2,4,...,maxthreads)
+int main(int argc, char *argv[]){
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// Check the number of parameters
+	if (argc < 10) {
+		// Tell the user how to run the program
+		cerr << "Usage: " << argv[0] << " distance \b outputfile \b outputpath \b epsilon \b eta \b minclustersize \b nr \b nc \b maxthreads" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+
+	double distance = StrToNbr<double>(argv[1]);
+	std::string outputfile  = argv[2];
+	std::string outputpath  = argv[3];
+	double epsilon = StrToNbr<double>(argv[4]);
+	double eta = StrToNbr<double>(argv[5]);
+	double minclustersize = StrToNbr<double>(argv[6]);
+	int nr = StrToNbr<int>(argv[7]);
+	int nc = StrToNbr<int>(argv[8]);
+	int maxthreads = StrToNbr<int>(argv[9]);
+
+	//
+	SetEpsilon(epsilon);
+	SetEta(eta);
+	SetMinClusterSize(minclustersize);
+
+	// Create points randomly
+	srand (1);
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+		// sqrt(rho) otherwise the points would be concentrated in the center of the disk
+	}
+	// p2: points in a unit disk of the plane z=z2
+	double z2 = 1+distance;
+	vector<R3> p2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+	}
+
+	// Matrix
+	MyMatrix A(p1,p2);
+
+	std::ofstream output;
+	if (rank==0){
+		output.open((outputpath+"/"+outputfile).c_str());
+		output.close();
+		std::cout << "threads block_tree blocks total speedup"<<std::endl;
+	}
+
+	double reference = 0;
+	for (int nb_threads=1;nb_threads<=maxthreads;nb_threads*=2){
+		#if _OPENMP
+		omp_set_num_threads(nb_threads);
+		#endif
+
+		MPI_Barrier(MPI_COMM_WORLD);
+		double mytime = MPI_Wtime();
+		HMatrix<double,partialACA,GeometricClustering> HA(A,p1,p2);
+		mytime = MPI_Wtime() - mytime;
+		double maxtime;
+		MPI_Reduce(&mytime, &maxtime, 1, MPI_DOUBLE, MPI_MAX, 0,HA.get_comm());
+
+		if (nb_threads==1){
+			reference = maxtime;
+		}
+		HA.add_info("Assembly_time_max",NbrToStr(maxtime));
+		HA.add_info("Assembly_speedup",NbrToStr(reference/maxtime));
+
+		if (rank==0){
+			output.open((outputpath+"/"+outputfile).c_str(),std::ios::app);
+			output<<"# Hmatrix"<<std::endl;
+			output.close();
+			std::cout << nb_threads << " " << HA.get_infos("Block_tree_max") << " " << HA.get_infos("Blocks_max") << " " << maxtime << " " << reference/maxtime << std::endl;
+		}
+		HA.save_infos((outputpath+"/"+outputfile).c_str(),std::ios::app,": ");
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <htool/htool.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Laplace single layer kernel with one virtual call to get_coef per coefficient
+class ScalarLaplaceSingleLayer: public IMatrix<double>{
+	const vector<R3>& p1;
+	const vector<R3>& p2;
+
+public:
+	ScalarLaplaceSingleLayer(const vector<R3>& p10,const vector<R3>& p20):IMatrix<double>(p10.size(),p20.size()),p1(p10),p2(p20) {}
+
+	double get_coef(const int& i, const int& j)const {
+		double r = norm2(p1[i]-p2[j]);
+		return (r>0) ? 1./(4*M_PI*r) : 0.;
+	}
+};
+
+// Assembly time with a scalar kernel and with the vectorized kernels of htool
+int main(int argc, char *argv[]){
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// Check the number of parameters
+	if (argc < 7) {
+		// Tell the user how to run the program
+		cerr << "Usage: " << argv[0] << " distance \b epsilon \b eta \b minclustersize \b nr \b nc" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+
+	double distance = StrToNbr<double>(argv[1]);
+	double epsilon = StrToNbr<double>(argv[2]);
+	double eta = StrToNbr<double>(argv[3]);
+	double minclustersize = StrToNbr<double>(argv[4]);
+	int nr = StrToNbr<int>(argv[5]);
+	int nc = StrToNbr<int>(argv[6]);
+
+	SetEpsilon(epsilon);
+	SetEta(eta);
+	SetMinClusterSize(minclustersize);
+
+	// Create points randomly
+	srand (1);
+	double z1 = 1;
+	vector<R3> p1(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p1[j][0] = sqrt(rho)*cos(2*M_PI*theta); p1[j][1] = sqrt(rho)*sin(2*M_PI*theta); p1[j][2] = z1;
+		// sqrt(rho) otherwise the points would be concentrated in the center of the disk
+	}
+	// p2: points in a unit disk of the plane z=z2, with normals along z
+	double z2 = 1+distance;
+	vector<R3> p2(nc), n2(nc);
+	for(int j=0; j<nc; j++){
+		double rho = ((double) rand() / (RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (RAND_MAX));
+		p2[j][0] = sqrt(rho)*cos(2*M_PI*theta); p2[j][1] = sqrt(rho)*sin(2*M_PI*theta); p2[j][2] = z2;
+		n2[j][0] = 0; n2[j][1] = 0; n2[j][2] = 1;
+	}
+
+	ScalarLaplaceSingleLayer A_scalar(p1,p2);
+	LaplaceSingleLayer A_laplace_SL(p1,p2);
+	LaplaceDoubleLayer A_laplace_DL(p1,p2,n2);
+	HelmholtzSingleLayer A_helmholtz_SL(p1,p2,1);
+
+	if (rank==0){
+		std::cout << "kernel assembly_time compression"<<std::endl;
+	}
+	std::vector<std::pair<std::string,IMatrix<double>*>> kernels;
+	kernels.emplace_back("scalar_laplace_single_layer",&A_scalar);
+	kernels.emplace_back("laplace_single_layer",&A_laplace_SL);
+	kernels.emplace_back("laplace_double_layer",&A_laplace_DL);
+	for (auto& kernel : kernels){
+		MPI_Barrier(MPI_COMM_WORLD);
+		double mytime = MPI_Wtime();
+		HMatrix<double,partialACA,GeometricClustering> HA(*(kernel.second),p1,p2);
+		mytime = MPI_Wtime() - mytime;
+		double maxtime;
+		MPI_Reduce(&mytime, &maxtime, 1, MPI_DOUBLE, MPI_MAX, 0,HA.get_comm());
+		double compression = HA.compression();
+		if (rank==0){
+			std::cout << kernel.first << " " << maxtime << " " << compression << std::endl;
+		}
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	double mytime = MPI_Wtime();
+	HMatrix<std::complex<double>,partialACA,GeometricClustering> HB(A_helmholtz_SL,p1,p2);
+	mytime = MPI_Wtime() - mytime;
+	double maxtime;
+	MPI_Reduce(&mytime, &maxtime, 1, MPI_DOUBLE, MPI_MAX, 0,HB.get_comm());
+	double compression = HB.compression();
+	if (rank==0){
+		std::cout << "helmholtz_single_layer " << maxtime << " " << compression << std::endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <htool/htool.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Time of mvprod_global with phased and pipelined products, and fraction of the communication hidden by the pipeline
+int main(int argc, char *argv[]){
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Get the number of processes
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	// Get the rank of the process
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// Check the number of parameters
+	if (argc < 6) {
+		// Tell the user how to run the program
+		cerr << "Usage: " << argv[0] << " epsilon \b eta \b minclustersize \b nr \b nb_products" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+
+	double epsilon = StrToNbr<double>(argv[1]);
+	double eta = StrToNbr<double>(argv[2]);
+	double minclustersize = StrToNbr<double>(argv[3]);
+	int nr = StrToNbr<int>(argv[4]);
+	int nb_products = StrToNbr<int>(argv[5]);
+
+	SetEpsilon(epsilon);
+	SetEta(eta);
+	SetMinClusterSize(minclustersize);
+
+	// Create points randomly
+	srand (1);
+	vector<R3> p(nr);
+	for(int j=0; j<nr; j++){
+		double rho = ((double) rand() / (double)(RAND_MAX)); // (double) otherwise integer division!
+		double theta = ((double) rand() / (double)(RAND_MAX));
+		p[j][0] = sqrt(rho)*cos(2*M_PI*theta); p[j][1] = sqrt(rho)*sin(2*M_PI*theta); p[j][2] = 0;
+		// sqrt(rho) otherwise the points would be concentrated in the center of the disk
+	}
+
+	// Same matrix with phased and pipelined products
+	HelmholtzSingleLayer A(p,p,1);
+	HMatrix<std::complex<double>,partialACA,GeometricClustering> HA(A,p);
+	SetPipelinedMvprod(true);
+	HMatrix<std::complex<double>,partialACA,GeometricClustering> HA_pipelined(A,p);
+	SetPipelinedMvprod(false);
+
+	std::vector<std::complex<double>> x(nr,1), y(nr), x_perm(nr), y_local(HA.get_local_size());
+	HA.mvprod_global(x.data(),y.data());
+	HA_pipelined.mvprod_global(x.data(),y.data());
+
+	// Maximum time over processes of nb_products products
+	auto time = [&](std::function<void()> product) -> double{
+		MPI_Barrier(MPI_COMM_WORLD);
+		double mytime = MPI_Wtime();
+		for (int i=0;i<nb_products;i++){
+			product();
+		}
+		mytime = MPI_Wtime() - mytime;
+		double maxtime;
+		MPI_Allreduce(&mytime, &maxtime, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		return maxtime;
+	};
+	double time_phased     = time([&](){HA.mvprod_global(x.data(),y.data());});
+	double time_pipelined  = time([&](){HA_pipelined.mvprod_global(x.data(),y.data());});
+	double time_local      = time([&](){HA.mymvprod_local(x_perm.data(),y_local.data(),1);});
+
+	// Communication time of phased products, and part of it hidden by pipelined products
+	double time_communication = time_phased-time_local;
+	double overlap_efficiency = (time_communication>0) ? (time_phased-time_pipelined)/time_communication : 0;
+
+	if (rank==0){
+		std::cout << "nb_procs time_phased time_pipelined time_local_product overlap_efficiency"<<std::endl;
+		std::cout << size << " " << time_phased << " " << time_pipelined << " " << time_local << " " << overlap_efficiency << std::endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include <htool/clustering/ncluster.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include "../functional_tests/lrmat/test_lrmat.hpp"
+
+// Previous implementation of partial ACA, with crosses stored in std::vector<std::vector<T>> and scalar residual updates
+template<typename T, typename ClusterImpl>
+class partialACA_reference: public LowRankMatrix<T,ClusterImpl>{
+
+public:
+	using LowRankMatrix<T,ClusterImpl>::LowRankMatrix;
+
+	void build(const IMatrix<T>& A, const Cluster<ClusterImpl>& t, const std::vector<R3>& xt,const std::vector<int>& tabt, const Cluster<ClusterImpl>&, const std::vector<R3>&, const std::vector<int>&){
+		if(this->rank == 0){
+			this->U.resize(this->nr,1);
+			this->V.resize(1,this->nc);
+		}
+		else{
+			std::vector<int> ir(this->get_ir(),this->get_ir()+this->nr), ic(this->get_ic(),this->get_ic()+this->nc);
+
+			//// Choice of the first row (see paragraph 3.4.3 page 151 Bebendorf)
+			double dist=1e30;
+			int I=0;
+			for (int i =0;i<int(this->nr/Parametres::ndofperelt);i++){
+				double aux_dist= norm2(xt[tabt[ir[i*Parametres::ndofperelt]]]-t.get_ctr());
+				if (dist>aux_dist){
+					dist=aux_dist;
+					I=i*Parametres::ndofperelt;
+				}
+			}
+			// Partial pivot
+			int J=0;
+			int q = 0;
+			int reqrank = this->rank;
+			std::vector<std::vector<T> > uu, vv;
+			std::vector<bool> visited_row(this->nr,false);
+			std::vector<bool> visited_col(this->nc,false);
+
+			double frob = 0;
+			double aux  = 0;
+			// Either we have a required rank
+			// Or it is negative and we have to check the relative error between two iterations.
+			//But to do that we need a least two iterations.
+			while (((reqrank > 0) && (q < std::min(reqrank,std::min(this->nr,this->nc))) ) ||
+			       ((reqrank < 0) && (q==0 || sqrt(aux/frob)>this->epsilon))) {
+
+				// Next current rank
+				q+=1;
+
+				if (q*(this->nr+this->nc) > (this->nr*this->nc)) { // the next current rank would not be advantageous
+                    q=-1;
+					break;
+				}
+				else{
+					std::vector<T> r(this->nc),c(this->nr);
+
+					// Compute the first cross
+					//==================//
+					// Look for a column
+					double pivot = 0.;
+					SubMatrix<T> row = A.get_submatrix(std::vector<int> {ir[I]},ic);
+					for(int k=0; k<this->nc; k++){
+						r[k] = row(0,k);//A.get_coef(this->ir[I],this->ic[k]);
+						for(int j=0; j<uu.size(); j++){
+							r[k] += -uu[j][I]*vv[j][k];
+						}
+						if( std::abs(r[k])>pivot && !visited_col[k] ){
+							J=k; pivot=std::abs(r[k]);}
+					}
+
+					visited_row[I] = true;
+					T gamma = T(1.)/r[J];
+					//==================//
+					// Look for a line
+					if( std::abs(r[J]) > 1e-15 ){
+						double cmax = 0.;
+						SubMatrix<T> col = A.get_submatrix(ir,std::vector<int> {ic[J]});
+						for(int j=0; j<this->nr; j++){
+							c[j] = col(j,0);//A.get_coef(this->ir[j],this->ic[J]);
+							for(int k=0; k<uu.size(); k++){
+								c[j] += -uu[k][j]*vv[k][J];
+							}
+							c[j] = gamma*c[j];
+							if( std::abs(c[j])>cmax && !visited_row[j] ){
+								I=j; cmax=std::abs(c[j]);}
+						}
+						visited_col[J] = true;
+						// Test if no given rank
+						if (reqrank<0){
+							// Error estimator
+							T frob_aux = 0.;
+							aux = std::abs(dprod(c,c)*dprod(r,r));
+							// aux: terme quadratiques du developpement du carre' de la norme de Frobenius de la matrice low rank
+							for(int j=0; j<uu.size(); j++){
+								frob_aux += dprod(r,vv[j])*dprod(c,uu[j]);
+							}
+							// frob_aux: termes croises du developpement du carre' de la norme de Frobenius de la matrice low rank
+							frob += aux + 2*std::real(frob_aux); // frob: Frobenius norm of the low rank matrix
+							//==================//
+						}
+						// Matrix<T> M=A.get_submatrix(this->ir,this->ic);
+						// uu.push_back(M.get_col(J));
+						// vv.push_back(M.get_row(I)/M(I,J));
+						// New cross added
+						uu.push_back(c);
+						vv.push_back(r);
+
+					}
+					else{
+						// std::cout << "There is a zero row in the starting submatrix and ACA didn't work" << std::endl;
+						q-=1;
+						break;
+					}
+				}
+			}
+			// Final rank
+			this->rank=q;
+			if (this->rank>0){
+				this->U.resize(this->nr,this->rank);
+				this->V.resize(this->rank,this->nc);
+				for (int k=0;k<this->rank;k++){
+					this->U.set_col(k,uu[k]);
+					this->V.set_row(k,vv[k]);
+				}
+			}
+		}
+	}
+};
+
+// Compares partial ACA with the previous implementation on the geometries of test_lrmat_partialACA
+int main(int argc, char *argv[]){
+
+	// Initialize the MPI environment
+	MPI_Init(&argc,&argv);
+
+	// Check the number of parameters
+	if (argc < 5) {
+		// Tell the user how to run the program
+		cerr << "Usage: " << argv[0] << " nr \b nc \b epsilon \b repetitions" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+
+	int nr = StrToNbr<int>(argv[1]);
+	int nc = StrToNbr<int>(argv[2]);
+	double epsilon = StrToNbr<double>(argv[3]);
+	int repetitions = StrToNbr<int>(argv[4]);
+
+	SetNdofPerElt(1);
+	SetEpsilon(epsilon);
+
+	const int ndistance = 4;
+	double distance[ndistance];
+	distance[0] = 15; distance[1] = 20; distance[2] = 30; distance[3] = 40;
+
+	std::vector<R3> xt(nr);
+	std::vector<R3> xs(nc);
+	std::vector<int> tabt(nr);
+	std::vector<int> tabs(nc);
+	std::cout << "distance rank time_reference time speedup error_reference error"<<std::endl;
+	for(int idist=0; idist<ndistance; idist++){
+		create_geometry(distance[idist],xt,tabt,xs,tabs);
+
+		GeometricClustering t,s;
+		t.build(xt,std::vector<double>(xt.size(),0),tabt,std::vector<double>(xt.size(),1));
+		s.build(xs,std::vector<double>(xs.size(),0),tabs,std::vector<double>(xs.size(),1));
+
+		MyMatrix A(xt,xs);
+
+		double time_reference = 0, time = 0, error_reference = 0, error = 0;
+		int rank = 0;
+		for (int i=0;i<repetitions;i++){
+			partialACA_reference<double,GeometricClustering> A_reference(t.get_perm(),s.get_perm());
+			double mytime = MPI_Wtime();
+			A_reference.build(A,t,xt,tabt,s,xs,tabs);
+			time_reference += MPI_Wtime()-mytime;
+
+			partialACA<double,GeometricClustering> A_partialACA(t.get_perm(),s.get_perm());
+			mytime = MPI_Wtime();
+			A_partialACA.build(A,t,xt,tabt,s,xs,tabs);
+			time += MPI_Wtime()-mytime;
+
+			if (i==0){
+				rank = A_partialACA.rank_of();
+				error_reference = Frobenius_absolute_error(A_reference,A);
+				error = Frobenius_absolute_error(A_partialACA,A);
+			}
+		}
+
+		std::cout << distance[idist] << " " << rank << " " << time_reference/repetitions << " " << time/repetitions << " " << time_reference/time << " " << error_reference << " " << error << std::endl;
+	}
+
+	// Finalize the MPI environment.
+	MPI_Finalize();
+	return 0;
+}